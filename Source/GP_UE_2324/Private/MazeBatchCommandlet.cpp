@@ -0,0 +1,299 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeBatchCommandlet.h"
+#include "MazeGeneration.h"
+#include "MazeSimulation.h"
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Modules/ModuleManager.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace MazeBatch
+{
+    struct FJob
+    {
+        FMazeSettings Settings;
+        FMazeMetrics Metrics;
+        FMazeSolveStats SolveStats;
+        double Seconds = 0.0;
+        double SimulationSeconds = 0.0;
+        bool bValid = false;
+    };
+
+    //Colors used for the previews, regions get evenly spread hues and the exit and key areas match the game
+    static TArray<FColor> MakePalette(int32 NumColors)
+    {
+        TArray<FColor> Palette;
+        for (int32 I = 0; I < NumColors; I++)
+        {
+            Palette.Add(FLinearColor::MakeFromHSV8((uint8)(I * 255 / NumColors), 160, 220).ToFColor(true));
+        }
+        return Palette;
+    }
+
+    static const FColor AreaExit = FColor::White;
+    static const FColor AreaKey = FColor(120, 72, 32);
+
+    //Two text lines per row of cells, walls as '+', '-' and '|', S, E and K mark the start, exit and key
+    static FString MakeAscii(const FMazeLayout& Layout)
+    {
+        const FMazeGrid& Grid = Layout.Grid;
+        FString Result;
+        Result.Reserve((Grid.Width * 2 + 2) * (Grid.Depth * 2 + 1));
+
+        for (int32 Y = Grid.Depth - 1; Y >= 0; Y--)
+        {
+            for (int32 X = 0; X < Grid.Width; X++)
+            {
+                Result += TEXT("+");
+                Result += Y + 1 < Grid.Depth && Grid.IsOpen(Grid.GetIndex(X, Y), EDirection::Top) ? TEXT(" ") : TEXT("-");
+            }
+            Result += TEXT("+\n|");
+            for (int32 X = 0; X < Grid.Width; X++)
+            {
+                const int32 CellIndex = Grid.GetIndex(X, Y);
+                if (CellIndex == Layout.StartIndex)
+                {
+                    Result += TEXT("S");
+                }
+                else if (CellIndex == Layout.ExitIndex)
+                {
+                    Result += TEXT("E");
+                }
+                else if (CellIndex == Layout.KeyIndex)
+                {
+                    Result += TEXT("K");
+                }
+                else
+                {
+                    Result += TEXT(" ");
+                }
+                Result += Grid.IsOpen(CellIndex, EDirection::Left) ? TEXT(" ") : TEXT("|");
+            }
+            Result += TEXT("\n");
+        }
+        for (int32 X = 0; X < Grid.Width; X++)
+        {
+            Result += TEXT("+-");
+        }
+        Result += TEXT("+\n");
+        return Result;
+    }
+
+    static bool SavePng(IImageWrapperModule& ImageWrapperModule, const FMazeLayout& Layout, TConstArrayView<FColor> Palette, const FString& FileName)
+    {
+        TArray<FColor> Pixels;
+        int32 ImageWidth;
+        int32 ImageHeight;
+        Layout.Rasterize(Palette, AreaExit, AreaKey, FColor::Black, Pixels, ImageWidth, ImageHeight);
+
+        TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::PNG);
+        if (!ImageWrapper.IsValid() || !ImageWrapper->SetRaw(Pixels.GetData(), Pixels.Num() * sizeof(FColor), ImageWidth, ImageHeight, ERGBFormat::BGRA, 8))
+        {
+            return false;
+        }
+        return FFileHelper::SaveArrayToFile(ImageWrapper->GetCompressed(), *FileName);
+    }
+}
+
+UMazeBatchCommandlet::UMazeBatchCommandlet()
+{
+    IsClient = false;
+    IsServer = false;
+    IsEditor = false;
+    LogToConsole = true;
+}
+
+int32 UMazeBatchCommandlet::Main(const FString& Params)
+{
+    TArray<FString> Tokens;
+    TArray<FString> Switches;
+    TMap<FString, FString> ParamsMap;
+    ParseCommandLine(*Params, Tokens, Switches, ParamsMap);
+
+    auto GetParam = [&ParamsMap](const TCHAR* Name, const FString& Default)
+        {
+            const FString* Value = ParamsMap.Find(Name);
+            return Value ? *Value : Default;
+        };
+
+    //Seeds as a single value or an inclusive range A-B
+    int32 FirstSeed = 1;
+    int32 LastSeed = 100;
+    const FString SeedsParam = GetParam(TEXT("Seeds"), TEXT("1-100"));
+    FString FirstSeedString;
+    FString LastSeedString;
+    if (SeedsParam.Split(TEXT("-"), &FirstSeedString, &LastSeedString))
+    {
+        FirstSeed = FCString::Atoi(*FirstSeedString);
+        LastSeed = FCString::Atoi(*LastSeedString);
+    }
+    else
+    {
+        FirstSeed = LastSeed = FCString::Atoi(*SeedsParam);
+    }
+    if (FirstSeed == 0 || LastSeed < FirstSeed)
+    {
+        UE_LOG(LogTemp, Error, TEXT("Invalid -Seeds=%s, seeds must be a range of non zero values like 1-100"), *SeedsParam);
+        return 1;
+    }
+
+    FMazeSettings BaseSettings;
+    BaseSettings.EllersMergeProb = FCString::Atof(*GetParam(TEXT("MergeProb"), TEXT("0.5")));
+    BaseSettings.BraidFactor = FCString::Atof(*GetParam(TEXT("Braid"), TEXT("0")));
+    BaseSettings.VoronoidCellSize = FCString::Atoi(*GetParam(TEXT("VoronoidCellSize"), TEXT("1")));
+    BaseSettings.NumColors = FCString::Atoi(*GetParam(TEXT("Colors"), TEXT("4")));
+    BaseSettings.bSolveElevation = !Switches.Contains(TEXT("NoElevation"));
+
+    //Sizes as a comma separated list of WidthxDepth
+    TArray<FIntPoint> Sizes;
+    TArray<FString> SizeStrings;
+    GetParam(TEXT("Sizes"), TEXT("20x20")).ParseIntoArray(SizeStrings, TEXT(","));
+    for (const FString& SizeString : SizeStrings)
+    {
+        FString WidthString;
+        FString DepthString;
+        if (SizeString.Split(TEXT("x"), &WidthString, &DepthString))
+        {
+            Sizes.Add(FIntPoint(FCString::Atoi(*WidthString), FCString::Atoi(*DepthString)));
+        }
+        else
+        {
+            UE_LOG(LogTemp, Error, TEXT("Invalid size %s, sizes must look like 20x20"), *SizeString);
+            return 1;
+        }
+    }
+
+    //Agent runs on every maze, off unless -Simulate sets the number of agents
+    FMazeSimulationSettings SimulationSettings;
+    SimulationSettings.NumAgents = FCString::Atoi(*GetParam(TEXT("Simulate"), TEXT("0")));
+    SimulationSettings.MaxSteps = FCString::Atoi(*GetParam(TEXT("MaxSteps"), TEXT("0")));
+    const FString PolicyParam = GetParam(TEXT("Policy"), TEXT("Explorer"));
+    const int64 Policy = StaticEnum<EMazeAgentPolicy>()->GetValueByNameString(PolicyParam);
+    if (Policy == INDEX_NONE)
+    {
+        UE_LOG(LogTemp, Error, TEXT("Invalid -Policy=%s, the policies are RandomWalk, WallFollower and Explorer"), *PolicyParam);
+        return 1;
+    }
+    SimulationSettings.Policy = (EMazeAgentPolicy)Policy;
+    const bool bSimulate = SimulationSettings.NumAgents > 0;
+
+    const FString OutputDir = GetParam(TEXT("Output"), FPaths::ProjectSavedDir() / TEXT("MazeBatch"));
+    const bool bWriteBinary = !Switches.Contains(TEXT("NoBinary"));
+    const bool bWritePng = Switches.Contains(TEXT("Png"));
+    const bool bWriteAscii = Switches.Contains(TEXT("Ascii"));
+    IFileManager::Get().MakeDirectory(*OutputDir, true);
+
+    TArray<MazeBatch::FJob> Jobs;
+    for (const FIntPoint& Size : Sizes)
+    {
+        for (int32 Seed = FirstSeed; Seed <= LastSeed; Seed++)
+        {
+            MazeBatch::FJob& Job = Jobs.AddDefaulted_GetRef();
+            Job.Settings = BaseSettings;
+            Job.Settings.Width = Size.X;
+            Job.Settings.Depth = Size.Y;
+            Job.Settings.Seed = Seed;
+            Job.Settings.Validate();
+        }
+    }
+
+    //The image module has to be loaded on the game thread before the workers use it
+    IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+    const TArray<FColor> Palette = MazeBatch::MakePalette(BaseSettings.NumColors);
+
+    UE_LOG(LogTemp, Display, TEXT("MazeBatch: generating %d mazes into %s"), Jobs.Num(), *OutputDir);
+
+    //The jobs already keep every worker busy, so each one generates and simulates its maze on its own worker. That way
+    //the time of a job is the time of one core and nothing fans out to the workers of other jobs
+    const double StartTime = FPlatformTime::Seconds();
+    ParallelFor(Jobs.Num(), [&](int32 JobIndex)
+        {
+            MazeBatch::FJob& Job = Jobs[JobIndex];
+            FMazeLayout Layout;
+
+            const double JobStart = FPlatformTime::Seconds();
+            MazeGeneration::BuildLayout(Job.Settings, Layout, nullptr, false);
+            MazeGeneration::ComputeMetrics(Layout, Job.Metrics);
+            Job.Seconds = FPlatformTime::Seconds() - JobStart;
+            Job.bValid = Layout.IsValid();
+
+            if (bSimulate)
+            {
+                const double SimulationStart = FPlatformTime::Seconds();
+                MazeSimulation::Simulate(Layout, SimulationSettings, Job.SolveStats, false);
+                Job.SimulationSeconds = FPlatformTime::Seconds() - SimulationStart;
+            }
+
+            const FString BaseName = OutputDir / FString::Printf(TEXT("Maze_%dx%d_%d"), Job.Settings.Width, Job.Settings.Depth, Job.Settings.Seed);
+            if (bWriteBinary)
+            {
+                TArray<uint8> Bytes;
+                FMemoryWriter Writer(Bytes);
+                Writer << Layout;
+                FFileHelper::SaveArrayToFile(Bytes, *(BaseName + TEXT(".maze")));
+            }
+            if (bWritePng && !MazeBatch::SavePng(ImageWrapperModule, Layout, Palette, BaseName + TEXT(".png")))
+            {
+                UE_LOG(LogTemp, Error, TEXT("MazeBatch: could not write %s.png"), *BaseName);
+            }
+            if (bWriteAscii)
+            {
+                FFileHelper::SaveStringToFile(MazeBatch::MakeAscii(Layout), *(BaseName + TEXT(".txt")));
+            }
+        });
+    const double WallSeconds = FPlatformTime::Seconds() - StartTime;
+
+    FString Csv = TEXT("Width,Depth,Seed,Cells,SolutionLength,DeadEnds,DeadEndRatio,KeyDistance,KeyExitDistance,Milliseconds");
+    Csv += bSimulate ? TEXT(",Agents,Solved,MeanSteps,P10Steps,MedianSteps,P90Steps,MaxSteps\n") : TEXT("\n");
+    double GenerationSeconds = 0.0;
+    double SimulationSeconds = 0.0;
+    int64 SimulationSteps = 0;
+    int32 NumInvalid = 0;
+    for (const MazeBatch::FJob& Job : Jobs)
+    {
+        GenerationSeconds += Job.Seconds;
+        SimulationSeconds += Job.SimulationSeconds;
+        SimulationSteps += Job.SolveStats.SimulatedSteps;
+        NumInvalid += Job.bValid ? 0 : 1;
+        Csv += FString::Printf(TEXT("%d,%d,%d,%d,%d,%d,%.4f,%d,%d,%.3f"), Job.Settings.Width, Job.Settings.Depth, Job.Settings.Seed,
+            Job.Metrics.NumCells, Job.Metrics.SolutionLength, Job.Metrics.DeadEnds, Job.Metrics.DeadEndRatio,
+            Job.Metrics.KeyDistance, Job.Metrics.KeyExitDistance, Job.Seconds * 1000.0);
+        if (bSimulate)
+        {
+            const FMazeSolveStats& Stats = Job.SolveStats;
+            Csv += FString::Printf(TEXT(",%d,%d,%.1f,%d,%d,%d,%d"), Stats.NumAgents, Stats.NumSolved, Stats.MeanSteps,
+                Stats.P10Steps, Stats.MedianSteps, Stats.P90Steps, Stats.MaxSteps);
+        }
+        Csv += TEXT("\n");
+    }
+    FFileHelper::SaveStringToFile(Csv, *(OutputDir / TEXT("metrics.csv")));
+
+    //Per core throughput only counts the time the jobs spent generating and analyzing on their worker, the wall time
+    //includes writing the files
+    const double MazesPerSecond = WallSeconds > 0.0 ? Jobs.Num() / WallSeconds : 0.0;
+    const double MazesPerSecondPerCore = GenerationSeconds > 0.0 ? Jobs.Num() / GenerationSeconds : 0.0;
+    UE_LOG(LogTemp, Display, TEXT("MazeBatch: %d mazes in %.3f s, %.1f mazes/s, %.1f mazes/s per core, %d workers"),
+        Jobs.Num(), WallSeconds, MazesPerSecond, MazesPerSecondPerCore, FTaskGraphInterface::Get().GetNumWorkerThreads() + 1);
+
+    //The agents of a maze run one after another on the worker of its job, so the steps per second are those of one core
+    if (bSimulate)
+    {
+        UE_LOG(LogTemp, Display, TEXT("MazeBatch: %d agents per maze took %lld steps in %.3f s, %.2f M steps/s per core"),
+            SimulationSettings.NumAgents, SimulationSteps, SimulationSeconds, SimulationSeconds > 0.0 ? SimulationSteps / SimulationSeconds / 1000000.0 : 0.0);
+    }
+
+    if (NumInvalid > 0)
+    {
+        UE_LOG(LogTemp, Error, TEXT("MazeBatch: %d mazes could not be generated"), NumInvalid);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,361 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeBitboard.h"
+#include "MazeScratch.h"
+#include "Algo/Unique.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MAZE_BITBOARD_AVX2 1
+#define MAZE_BITBOARD_SSE2 0
+#elif PLATFORM_ENABLE_VECTORINTRINSICS && PLATFORM_CPU_X86_FAMILY
+#include <emmintrin.h>
+#define MAZE_BITBOARD_AVX2 0
+#define MAZE_BITBOARD_SSE2 1
+#else
+#define MAZE_BITBOARD_AVX2 0
+#define MAZE_BITBOARD_SSE2 0
+#endif
+
+void FMazeBitboard::Build(const FMazeGrid& Grid)
+{
+    Width = Grid.Width;
+    Depth = Grid.Depth;
+    WordsPerRow = FMath::DivideAndRoundUp(Width, 64);
+
+    OpenX.Init(0, GetNumWords());
+    OpenY.Init(0, GetNumWords());
+    Frontier.Init(0, GetNumWords());
+    Next.Init(0, GetNumWords());
+    Visited.Init(0, GetNumWords());
+
+    for (int32 Y = 0; Y < Depth; Y++)
+    {
+        for (int32 X = 0; X < Width; X++)
+        {
+            const int32 CellIndex = Grid.GetIndex(X, Y);
+            const int32 Word = GetWordIndex(Y, X / 64);
+            const uint64 Bit = 1ull << (X % 64);
+            if (Grid.IsOpen(CellIndex, EDirection::Left))
+            {
+                OpenX[Word] |= Bit;
+            }
+            if (Grid.IsOpen(CellIndex, EDirection::Top))
+            {
+                OpenY[Word] |= Bit;
+            }
+        }
+    }
+}
+
+//Every wall is stored once, on the cell at its -X or -Y side
+void FMazeBitboard::SetWallOpen(int32 Index, EDirection Direction, bool bOpen)
+{
+    int32 X = Index % Width;
+    int32 Y = Index / Width;
+    if (Direction == EDirection::Right)
+    {
+        X--;
+    }
+    else if (Direction == EDirection::Bottom)
+    {
+        Y--;
+    }
+    if (X < 0 || Y < 0 || X >= Width || Y >= Depth)
+    {
+        return;
+    }
+
+    TArray<uint64>& Bits = Direction == EDirection::Left || Direction == EDirection::Right ? OpenX : OpenY;
+    const int32 Word = GetWordIndex(Y, X / 64);
+    const uint64 Bit = 1ull << (X % 64);
+    if (bOpen)
+    {
+        Bits[Word] |= Bit;
+    }
+    else
+    {
+        Bits[Word] &= ~Bit;
+    }
+}
+
+//Computes the next frontier of one row from the current frontier of that row and the rows next to it.
+//A cell is reached from the side when the cell beside it is in the frontier and the wall between them is open,
+//the carries between words work across rows too because the last cell of a row is never open towards +X
+uint64 FMazeBitboard::ExpandRow(const uint64* Frontier, const uint64* X, const uint64* Y, uint64* Visited, uint64* Next, int32 NumWords, int32 Stride)
+{
+    int32 Word = 0;
+    uint64 Any = 0;
+
+#if MAZE_BITBOARD_AVX2
+    __m256i AnyWide = _mm256_setzero_si256();
+    for (; Word + 4 <= NumWords; Word += 4)
+    {
+        const __m256i F = _mm256_loadu_si256((const __m256i*)(Frontier + Word));
+        const __m256i FPrev = _mm256_loadu_si256((const __m256i*)(Frontier + Word - 1));
+        const __m256i FNext = _mm256_loadu_si256((const __m256i*)(Frontier + Word + 1));
+        const __m256i FBelow = _mm256_loadu_si256((const __m256i*)(Frontier + Word - Stride));
+        const __m256i FAbove = _mm256_loadu_si256((const __m256i*)(Frontier + Word + Stride));
+        const __m256i Open = _mm256_loadu_si256((const __m256i*)(X + Word));
+        const __m256i OpenPrev = _mm256_loadu_si256((const __m256i*)(X + Word - 1));
+        const __m256i OpenBelow = _mm256_loadu_si256((const __m256i*)(Y + Word - Stride));
+        const __m256i OpenUp = _mm256_loadu_si256((const __m256i*)(Y + Word));
+        const __m256i Seen = _mm256_loadu_si256((const __m256i*)(Visited + Word));
+
+        const __m256i PlusX = _mm256_or_si256(_mm256_slli_epi64(_mm256_and_si256(F, Open), 1), _mm256_srli_epi64(_mm256_and_si256(FPrev, OpenPrev), 63));
+        const __m256i MinusX = _mm256_and_si256(_mm256_or_si256(_mm256_srli_epi64(F, 1), _mm256_slli_epi64(FNext, 63)), Open);
+        const __m256i PlusY = _mm256_and_si256(FBelow, OpenBelow);
+        const __m256i MinusY = _mm256_and_si256(FAbove, OpenUp);
+
+        const __m256i Reached = _mm256_andnot_si256(Seen, _mm256_or_si256(_mm256_or_si256(PlusX, MinusX), _mm256_or_si256(PlusY, MinusY)));
+        _mm256_storeu_si256((__m256i*)(Next + Word), Reached);
+        _mm256_storeu_si256((__m256i*)(Visited + Word), _mm256_or_si256(Seen, Reached));
+        AnyWide = _mm256_or_si256(AnyWide, Reached);
+    }
+    Any |= _mm256_testz_si256(AnyWide, AnyWide) ? 0 : 1;
+#elif MAZE_BITBOARD_SSE2
+    __m128i AnyWide = _mm_setzero_si128();
+    for (; Word + 2 <= NumWords; Word += 2)
+    {
+        const __m128i F = _mm_loadu_si128((const __m128i*)(Frontier + Word));
+        const __m128i FPrev = _mm_loadu_si128((const __m128i*)(Frontier + Word - 1));
+        const __m128i FNext = _mm_loadu_si128((const __m128i*)(Frontier + Word + 1));
+        const __m128i FBelow = _mm_loadu_si128((const __m128i*)(Frontier + Word - Stride));
+        const __m128i FAbove = _mm_loadu_si128((const __m128i*)(Frontier + Word + Stride));
+        const __m128i Open = _mm_loadu_si128((const __m128i*)(X + Word));
+        const __m128i OpenPrev = _mm_loadu_si128((const __m128i*)(X + Word - 1));
+        const __m128i OpenBelow = _mm_loadu_si128((const __m128i*)(Y + Word - Stride));
+        const __m128i OpenUp = _mm_loadu_si128((const __m128i*)(Y + Word));
+        const __m128i Seen = _mm_loadu_si128((const __m128i*)(Visited + Word));
+
+        const __m128i PlusX = _mm_or_si128(_mm_slli_epi64(_mm_and_si128(F, Open), 1), _mm_srli_epi64(_mm_and_si128(FPrev, OpenPrev), 63));
+        const __m128i MinusX = _mm_and_si128(_mm_or_si128(_mm_srli_epi64(F, 1), _mm_slli_epi64(FNext, 63)), Open);
+        const __m128i PlusY = _mm_and_si128(FBelow, OpenBelow);
+        const __m128i MinusY = _mm_and_si128(FAbove, OpenUp);
+
+        const __m128i Reached = _mm_andnot_si128(Seen, _mm_or_si128(_mm_or_si128(PlusX, MinusX), _mm_or_si128(PlusY, MinusY)));
+        _mm_storeu_si128((__m128i*)(Next + Word), Reached);
+        _mm_storeu_si128((__m128i*)(Visited + Word), _mm_or_si128(Seen, Reached));
+        AnyWide = _mm_or_si128(AnyWide, Reached);
+    }
+    Any |= _mm_movemask_epi8(_mm_cmpeq_epi8(AnyWide, _mm_setzero_si128())) == 0xFFFF ? 0 : 1;
+#endif
+
+    for (; Word < NumWords; Word++)
+    {
+        const uint64 F = Frontier[Word];
+        const uint64 PlusX = ((F & X[Word]) << 1) | ((Frontier[Word - 1] & X[Word - 1]) >> 63);
+        const uint64 MinusX = ((F >> 1) | (Frontier[Word + 1] << 63)) & X[Word];
+        const uint64 PlusY = Frontier[Word - Stride] & Y[Word - Stride];
+        const uint64 MinusY = Frontier[Word + Stride] & Y[Word];
+
+        const uint64 Reached = (PlusX | MinusX | PlusY | MinusY) & ~Visited[Word];
+        Next[Word] = Reached;
+        Visited[Word] |= Reached;
+        Any |= Reached;
+    }
+
+    return Any;
+}
+
+//Layered breadth search over the bitboard. The visitor is called with (Distance, Row, RowWords) for every row
+//that has cells in the new layer and returns false to stop the search
+template<typename VisitorType>
+int32 FMazeBitboard::Flood(TConstArrayView<int32> Sources, int32 MaxDistance, VisitorType&& Visitor) const
+{
+    if (!IsValid())
+    {
+        UE_LOG(LogTemp, Error, TEXT("Error in FMazeBitboard::Flood() the bitboard was not built"));
+        return 0;
+    }
+
+    //Rows with cells in the frontier, kept sorted so the rows to expand come out sorted too
+    FMazeScratchScope Scratch;
+    TMazeScratchArray<int32> ActiveRows;
+    TMazeScratchArray<int32> NextRows;
+    TMazeScratchArray<int32> Candidates;
+    ActiveRows.Reserve(Depth);
+    NextRows.Reserve(Depth);
+    Candidates.Reserve(Depth);
+
+    for (int32 Source : Sources)
+    {
+        if (Source < 0 || Source >= Width * Depth)
+        {
+            UE_LOG(LogTemp, Error, TEXT("Invalid source in FMazeBitboard::Flood(): %d"), Source);
+            continue;
+        }
+        const int32 Row = Source / Width;
+        const int32 Word = GetWordIndex(Row, (Source % Width) / 64);
+        const uint64 Bit = 1ull << ((Source % Width) % 64);
+        Frontier[Word] |= Bit;
+        Visited[Word] |= Bit;
+        ActiveRows.Add(Row);
+    }
+    ActiveRows.Sort();
+    ActiveRows.SetNum(Algo::Unique(ActiveRows), false);
+    if (ActiveRows.Num() == 0)
+    {
+        return 0;
+    }
+
+    //Every row the search reaches lies between these two, they bound what has to be cleared at the end
+    int32 MinRow = ActiveRows[0];
+    int32 MaxRow = ActiveRows.Last();
+
+    int32 Distance = 0;
+    int32 NumLayers = 0;
+    bool bStopped = false;
+    while (ActiveRows.Num() > 0 && !bStopped)
+    {
+        NumLayers++;
+        for (int32 Row : ActiveRows)
+        {
+            if (!Visitor(Distance, Row, Frontier.GetData() + GetWordIndex(Row, 0)))
+            {
+                bStopped = true;
+                break;
+            }
+        }
+        if (bStopped || Distance >= MaxDistance)
+        {
+            break;
+        }
+        Distance++;
+
+        //Rows next to the frontier, sorted and without repeats because the frontier is sorted
+        Candidates.Reset();
+        for (int32 Row : ActiveRows)
+        {
+            for (int32 Candidate = FMath::Max(Row - 1, 0); Candidate <= FMath::Min(Row + 1, Depth - 1); Candidate++)
+            {
+                if (Candidates.Num() == 0 || Candidate > Candidates.Last())
+                {
+                    Candidates.Add(Candidate);
+                }
+            }
+        }
+
+        //Each run of consecutive rows is one contiguous block of words, so it is expanded with a single call
+        //and the wide loops cover the whole run. The zero padding of the rows keeps them from reaching each other
+        NextRows.Reset();
+        for (int32 RunStart = 0; RunStart < Candidates.Num();)
+        {
+            int32 RunEnd = RunStart + 1;
+            while (RunEnd < Candidates.Num() && Candidates[RunEnd] == Candidates[RunEnd - 1] + 1)
+            {
+                RunEnd++;
+            }
+
+            const int32 FirstRow = Candidates[RunStart];
+            const int32 NumRows = RunEnd - RunStart;
+            const int32 Word = GetWordIndex(FirstRow, 0);
+            if (ExpandRow(Frontier.GetData() + Word, OpenX.GetData() + Word, OpenY.GetData() + Word, Visited.GetData() + Word, Next.GetData() + Word, NumRows * WordsPerRow, WordsPerRow))
+            {
+                for (int32 Row = FirstRow; Row < FirstRow + NumRows; Row++)
+                {
+                    const uint64* RowWords = Next.GetData() + GetWordIndex(Row, 0);
+                    for (int32 RowWord = 0; RowWord < WordsPerRow; RowWord++)
+                    {
+                        if (RowWords[RowWord])
+                        {
+                            NextRows.Add(Row);
+                            break;
+                        }
+                    }
+                }
+            }
+            RunStart = RunEnd;
+        }
+        if (NextRows.Num() > 0)
+        {
+            MinRow = FMath::Min(MinRow, NextRows[0]);
+            MaxRow = FMath::Max(MaxRow, NextRows.Last());
+        }
+
+        //Next always starts a layer empty, the old frontier rows are cleared before the buffers are swapped
+        for (int32 Row : ActiveRows)
+        {
+            FMemory::Memzero(Frontier.GetData() + GetWordIndex(Row, 0), WordsPerRow * sizeof(uint64));
+        }
+        Swap(Frontier, Next);
+        Swap(ActiveRows, NextRows);
+    }
+
+    //Leaves the buffers zeroed for the next query, Next is already empty here
+    for (int32 Row : ActiveRows)
+    {
+        FMemory::Memzero(Frontier.GetData() + GetWordIndex(Row, 0), WordsPerRow * sizeof(uint64));
+    }
+    FMemory::Memzero(Visited.GetData() + GetWordIndex(MinRow, 0), (MaxRow - MinRow + 1) * WordsPerRow * sizeof(uint64));
+
+    return NumLayers;
+}
+
+int32 FMazeBitboard::GetDistance(int32 From, int32 To, int32 MaxDistance) const
+{
+    if (To < 0 || To >= Width * Depth)
+    {
+        UE_LOG(LogTemp, Error, TEXT("Invalid target in FMazeBitboard::GetDistance(): %d"), To);
+        return INDEX_NONE;
+    }
+
+    const int32 TargetRow = To / Width;
+    const int32 TargetWord = (To % Width) / 64;
+    const uint64 TargetBit = 1ull << ((To % Width) % 64);
+    int32 Result = INDEX_NONE;
+
+    const int32 Sources[] = { From };
+    Flood(Sources, MaxDistance, [&](int32 Distance, int32 Row, const uint64* RowWords)
+        {
+            if (Row == TargetRow && (RowWords[TargetWord] & TargetBit))
+            {
+                Result = Distance;
+                return false;
+            }
+            return true;
+        });
+
+    return Result;
+}
+
+int32 FMazeBitboard::GetDistances(TConstArrayView<int32> Sources, TArray<int32>& OutDistances) const
+{
+    OutDistances.Init(INDEX_NONE, Width * Depth);
+
+    return Flood(Sources, MAX_int32, [&](int32 Distance, int32 Row, const uint64* RowWords)
+        {
+            for (int32 Word = 0; Word < WordsPerRow; Word++)
+            {
+                uint64 Bits = RowWords[Word];
+                while (Bits)
+                {
+                    const int32 X = Word * 64 + (int32)FMath::CountTrailingZeros64(Bits);
+                    OutDistances[Row * Width + X] = Distance;
+                    Bits &= Bits - 1;
+                }
+            }
+            return true;
+        });
+}
+
+void FMazeBitboard::GetReachable(TConstArrayView<int32> Sources, TBitArray<>& OutReachable, int32 MaxDistance) const
+{
+    OutReachable.Init(false, Width * Depth);
+
+    Flood(Sources, MaxDistance, [&](int32 Distance, int32 Row, const uint64* RowWords)
+        {
+            for (int32 Word = 0; Word < WordsPerRow; Word++)
+            {
+                uint64 Bits = RowWords[Word];
+                while (Bits)
+                {
+                    const int32 X = Word * 64 + (int32)FMath::CountTrailingZeros64(Bits);
+                    OutReachable[Row * Width + X] = true;
+                    Bits &= Bits - 1;
+                }
+            }
+            return true;
+        });
+}
@@ -0,0 +1,151 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeCache.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Guid.h"
+#include "Misc/Paths.h"
+#include "Misc/SecureHash.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+FString MazeCache::GetDirectory()
+{
+    return FPaths::ProjectSavedDir() / TEXT("MazeCache");
+}
+
+FString MazeCache::GetPath(const FString& Key)
+{
+    return GetDirectory() / Key + TEXT(".maze");
+}
+
+//Every input is written with a fixed size so different settings can't produce the same bytes. The colors of the palette
+//are only drawn, the regions only depend on how many there are
+FString MazeCache::MakeKey(const FMazeSettings& Settings)
+{
+    FMazeSettings Valid = Settings;
+    Valid.Validate();
+
+    int32 Version = FMazeLayout::Version;
+    int32 ElevationSeed = Valid.GetElevationSeed();
+    uint8 bSolveElevation = Valid.bSolveElevation ? 1 : 0;
+
+    TArray<uint8> Bytes;
+    FMemoryWriter Writer(Bytes);
+    Writer << Version;
+    Writer << Valid.Width;
+    Writer << Valid.Depth;
+    Writer << Valid.Seed;
+    Writer << Valid.EllersMergeProb;
+    Writer << Valid.BraidFactor;
+    Writer << Valid.VoronoidCellSize;
+    Writer << Valid.NumColors;
+    Writer << ElevationSeed;
+    Writer << bSolveElevation;
+    Writer << Valid.NumLayers;
+
+    FSHAHash Hash;
+    FSHA1::HashBuffer(Bytes.GetData(), Bytes.Num(), Hash.Hash);
+    return Hash.ToString();
+}
+
+bool MazeCache::Load(const FString& Key, const FMazeSettings& Settings, FMazeTower& OutTower)
+{
+    const FString Path = GetPath(Key);
+    TArray<uint8> Bytes;
+    if (!FFileHelper::LoadFileToArray(Bytes, *Path, FILEREAD_Silent))
+    {
+        return false;
+    }
+
+    OutTower = FMazeTower();
+    FMemoryReader Reader(Bytes);
+    Reader << OutTower;
+
+    bool bValid = !Reader.IsError() && OutTower.IsValid() && OutTower.NumLayers() == FMath::Max(Settings.NumLayers, 1);
+    for (const FMazeLayout& Layer : OutTower.Layers)
+    {
+        bValid = bValid && Layer.IsValid() && Layer.Grid.Width == Settings.Width && Layer.Grid.Depth == Settings.Depth
+            && Layer.Regions.Num() == Layer.Grid.Num() && Layer.Elevation.IsValid() == Settings.bSolveElevation;
+    }
+    if (!bValid)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("MazeCache: %s does not match its settings and was deleted"), *Path);
+        IFileManager::Get().Delete(*Path, false, true, true);
+        OutTower = FMazeTower();
+        return false;
+    }
+
+    //The modification time is the last use for the eviction
+    IFileManager::Get().SetTimeStamp(*Path, FDateTime::UtcNow());
+    return true;
+}
+
+//Written to a unique file first and moved in place, so another process reading the same key never sees half a file
+void MazeCache::Store(const FString& Key, const FMazeTower& Tower, int64 MaxBytes)
+{
+    TArray<uint8> Bytes;
+    FMemoryWriter Writer(Bytes);
+    Writer << const_cast<FMazeTower&>(Tower);
+
+    if (MaxBytes > 0 && Bytes.Num() > MaxBytes)
+    {
+        return;
+    }
+
+    const FString Path = GetPath(Key);
+    const FString TempPath = GetDirectory() / FGuid::NewGuid().ToString() + TEXT(".tmp");
+    IFileManager::Get().MakeDirectory(*GetDirectory(), true);
+    if (!FFileHelper::SaveArrayToFile(Bytes, *TempPath) || !IFileManager::Get().Move(*Path, *TempPath, true, true, false, true))
+    {
+        UE_LOG(LogTemp, Warning, TEXT("MazeCache: could not write %s"), *Path);
+        IFileManager::Get().Delete(*TempPath, false, true, true);
+        return;
+    }
+
+    if (MaxBytes > 0)
+    {
+        Evict(MaxBytes, Key);
+    }
+}
+
+void MazeCache::Evict(int64 MaxBytes, const FString& KeepKey)
+{
+    struct FCachedFile
+    {
+        FString Path;
+        FDateTime LastUse;
+        int64 Size = 0;
+    };
+
+    TArray<FCachedFile> Files;
+    int64 TotalBytes = 0;
+    IFileManager::Get().IterateDirectoryStat(*GetDirectory(), [&Files, &TotalBytes](const TCHAR* Path, const FFileStatData& Stat)
+        {
+            if (!Stat.bIsDirectory && FPaths::GetExtension(Path) == TEXT("maze"))
+            {
+                Files.Add({ Path, Stat.ModificationTime, Stat.FileSize });
+                TotalBytes += Stat.FileSize;
+            }
+            return true;
+        });
+
+    if (TotalBytes <= MaxBytes)
+    {
+        return;
+    }
+
+    Files.Sort([](const FCachedFile& A, const FCachedFile& B) { return A.LastUse < B.LastUse; });
+    for (const FCachedFile& File : Files)
+    {
+        if (TotalBytes <= MaxBytes)
+        {
+            break;
+        }
+        if (FPaths::GetBaseFilename(File.Path) != KeepKey && IFileManager::Get().Delete(*File.Path, false, true, true))
+        {
+            TotalBytes -= File.Size;
+        }
+    }
+}
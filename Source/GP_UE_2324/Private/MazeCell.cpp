@@ -2,6 +2,7 @@
 
 
 #include "MazeCell.h"
+#include "MazeMemory.h"
 
 // Sets default values
 AMazeCell::AMazeCell()
@@ -75,6 +76,54 @@ void AMazeCell::BreakBottomWall()
 	}
 }
 
+void AMazeCell::BreakWall(EDirection Direction)
+{
+	switch (Direction)
+	{
+	case EDirection::Left:
+		BreakLeftWall();
+		break;
+	case EDirection::Right:
+		BreakRightWall();
+		break;
+	case EDirection::Bottom:
+		BreakBottomWall();
+		break;
+	case EDirection::Top:
+		BreakTopWall();
+		break;
+	}
+}
+
+//Shows a broken wall again with the collision of the blueprint, used when a passage is closed at runtime
+void AMazeCell::RestoreWall(EDirection Direction)
+{
+	UStaticMeshComponent* Wall = GetWall(Direction);
+	const UStaticMeshComponent* DefaultWall = GetClass()->GetDefaultObject<AMazeCell>()->GetWall(Direction);
+	if (Wall)
+	{
+		Wall->SetVisibility(true);
+		Wall->SetCollisionEnabled(DefaultWall ? DefaultWall->GetCollisionEnabled() : ECollisionEnabled::QueryAndPhysics);
+	}
+}
+
+UStaticMeshComponent* AMazeCell::GetWall(EDirection Direction) const
+{
+	switch (Direction)
+	{
+	case EDirection::Left:
+		return LeftWall;
+	case EDirection::Right:
+		return RightWall;
+	case EDirection::Bottom:
+		return BottomWall;
+	case EDirection::Top:
+		return TopWall;
+	default:
+		return nullptr;
+	}
+}
+
 //Call when cell is visited
 void AMazeCell::Visit()
 {
@@ -116,6 +165,22 @@ void AMazeCell::GenerateMesh(float Elevation, EDirection Direction, const TArray
 		break;
 	}
 
+	UpdateFloorMesh();
+}
+
+//Sets the floor vertices directly from precomputed heights in EVert order, used when the elevation is solved for the whole maze at once
+void AMazeCell::GenerateMesh(TConstArrayView<float> CornerHeights, float CellSize)
+{
+	SetVert(EVert::LeftBot, FVector(CellSize, 0.f, CornerHeights[(int32)EVert::LeftBot]));
+	SetVert(EVert::RightBot, FVector(0.f, 0.f, CornerHeights[(int32)EVert::RightBot]));
+	SetVert(EVert::LeftTop, FVector(CellSize, CellSize, CornerHeights[(int32)EVert::LeftTop]));
+	SetVert(EVert::RightTop, FVector(0.f, CellSize, CornerHeights[(int32)EVert::RightTop]));
+
+	UpdateFloorMesh();
+}
+
+void AMazeCell::UpdateFloorMesh()
+{
 	//Set Triangles
 	CellTris = { (int32)EVert::LeftTop, (int32)EVert::LeftBot, (int32)EVert::RightTop, (int32)EVert::RightTop, (int32)EVert::LeftBot, (int32)EVert::RightBot };
 
@@ -154,6 +219,8 @@ void AMazeCell::SetVert(EVert Vert, FVector Pos)
 
 void AMazeCell::SetWallsColor(const FColor& NewColor)
 {
+	LLM_SCOPE_BYTAG(Maze_Materials);
+
 	// Helper function to set color of a wall
 	auto SetWallColor = [NewColor](UStaticMeshComponent* Wall)
 		{
@@ -222,6 +289,16 @@ void AMazeCell::AddNeighbour(AMazeCell* Neighbour)
 	}
 }
 
+void AMazeCell::RemoveNeighbour(AMazeCell* Neighbour)
+{
+	Neighbours.Remove(Neighbour);
+}
+
+SIZE_T AMazeCell::GetAllocatedSize() const
+{
+	return History.GetAllocatedSize() + Neighbours.GetAllocatedSize();
+}
+
 EDirection AMazeCell::GetOpenDirection()
 {
     if (TopWall && !TopWall->IsVisible())
@@ -0,0 +1,225 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeCollision.h"
+
+namespace
+{
+    void AddBoxHull(const FVector& Min, const FVector& Max, TArray<TArray<FVector>>& OutHulls)
+    {
+        TArray<FVector>& Hull = OutHulls.AddDefaulted_GetRef();
+        Hull.Reserve(8);
+        for (int32 Corner = 0; Corner < 8; Corner++)
+        {
+            Hull.Add(FVector((Corner & 1) ? Max.X : Min.X, (Corner & 2) ? Max.Y : Min.Y, (Corner & 4) ? Max.Z : Min.Z));
+        }
+    }
+
+    FVector GetCellBase(const FMazeLayout& Layout, int32 CellIndex, float CellSize, float HeightScale)
+    {
+        const FMazeGrid& Grid = Layout.Grid;
+        const float Z = Layout.Elevation.IsValid() ? Layout.Elevation.Heights[CellIndex] * HeightScale : 0.f;
+        return FVector(Grid.GetX(CellIndex) * CellSize, Grid.GetY(CellIndex) * CellSize, Z);
+    }
+
+    //Rectangle of flat floor cells at the same height
+    struct FFloorRect
+    {
+        int32 FirstX = 0;
+        int32 LastX = 0;
+        int32 FirstY = 0;
+        int32 LastY = 0;
+        float Z = 0.f;
+    };
+}
+
+void MazeCollision::BuildHulls(const FMazeLayout& Layout, float CellSize, float HeightScale, TConstArrayView<FBox> WallBoxes,
+    TArray<TArray<FVector>>& OutHulls)
+{
+    OutHulls.Reset();
+    for (int32 Line = 0; Line < GetNumWallLines(Layout.Grid); Line++)
+    {
+        BuildWallLine(Layout, CellSize, HeightScale, WallBoxes, Line, OutHulls);
+    }
+}
+
+int32 MazeCollision::GetWallLine(const FMazeGrid& Grid, int32 CellIndex, EDirection Direction)
+{
+    switch (Direction)
+    {
+    case EDirection::Left:
+        return Grid.GetX(CellIndex) + 1;
+    case EDirection::Right:
+        return Grid.GetX(CellIndex);
+    case EDirection::Top:
+        return Grid.Width + 1 + Grid.GetY(CellIndex) + 1;
+    default:
+        return Grid.Width + 1 + Grid.GetY(CellIndex);
+    }
+}
+
+//Both sides of a wall between two cells become one box, the walls between columns follow the columns and the
+//walls between rows follow the rows. A run of walls grows while the cells on both sides keep their heights
+void MazeCollision::BuildWallLine(const FMazeLayout& Layout, float CellSize, float HeightScale, TConstArrayView<FBox> WallBoxes,
+    int32 Line, TArray<TArray<FVector>>& OutHulls)
+{
+    const FMazeGrid& Grid = Layout.Grid;
+    if (Line < 0 || Line >= GetNumWallLines(Grid))
+    {
+        UE_LOG(LogTemp, Error, TEXT("Invalid line in MazeCollision::BuildWallLine(): %d"), Line);
+        return;
+    }
+
+    auto GetBase = [&](int32 CellIndex) { return GetCellBase(Layout, CellIndex, CellSize, HeightScale); };
+
+    const bool bAlongX = Line > Grid.Width;
+    const EDirection Positive = bAlongX ? EDirection::Top : EDirection::Left;
+    const EDirection Negative = FMazeGrid::GetOpposite(Positive);
+    const FBox& PositiveBox = WallBoxes.IsValidIndex((int32)Positive) ? WallBoxes[(int32)Positive] : FBox(ForceInit);
+    const FBox& NegativeBox = WallBoxes.IsValidIndex((int32)Negative) ? WallBoxes[(int32)Negative] : FBox(ForceInit);
+    if (!PositiveBox.IsValid && !NegativeBox.IsValid)
+    {
+        return;
+    }
+
+    const int32 NumAcross = bAlongX ? Grid.Depth : Grid.Width;
+    const int32 LineLength = bAlongX ? Grid.Width : Grid.Depth;
+    const int32 Boundary = bAlongX ? Line - (Grid.Width + 1) : Line;
+    auto GetCell = [&Grid, bAlongX](int32 Across, int32 Along) { return bAlongX ? Grid.GetIndex(Along, Across) : Grid.GetIndex(Across, Along); };
+
+    FBox Run(ForceInit);
+    FVector2D RunHeights = FVector2D::ZeroVector;
+    for (int32 Position = 0; Position <= LineLength; Position++)
+    {
+        FBox Segment(ForceInit);
+        FVector2D Heights = FVector2D::ZeroVector;
+        if (Position < LineLength)
+        {
+            const int32 Before = Boundary > 0 ? GetCell(Boundary - 1, Position) : INDEX_NONE;
+            const int32 After = Boundary < NumAcross ? GetCell(Boundary, Position) : INDEX_NONE;
+            const bool bClosed = Before != INDEX_NONE ? !Grid.IsOpen(Before, Positive) : !Grid.IsOpen(After, Negative);
+            if (bClosed && Before != INDEX_NONE && PositiveBox.IsValid)
+            {
+                const FVector Base = GetBase(Before);
+                Segment += PositiveBox.ShiftBy(Base);
+                Heights.X = Base.Z;
+            }
+            if (bClosed && After != INDEX_NONE && NegativeBox.IsValid)
+            {
+                const FVector Base = GetBase(After);
+                Segment += NegativeBox.ShiftBy(Base);
+                Heights.Y = Base.Z;
+            }
+        }
+
+        if (Run.IsValid && (!Segment.IsValid || Heights != RunHeights))
+        {
+            AddBoxHull(Run.Min, Run.Max, OutHulls);
+            Run = FBox(ForceInit);
+        }
+        if (Segment.IsValid)
+        {
+            Run += Segment;
+            RunHeights = Heights;
+        }
+    }
+}
+
+void MazeCollision::BuildFloorMesh(const FMazeLayout& Layout, float CellSize, float HeightScale, int32 MinY, int32 MaxY,
+    TArray<FVector>& OutVertices, TArray<int32>& OutTriangles)
+{
+    const FMazeGrid& Grid = Layout.Grid;
+    const FMazeElevation& Elevation = Layout.Elevation;
+    const bool bElevation = Elevation.IsValid();
+    const int32 CellTris[] = { (int32)EVert::LeftTop, (int32)EVert::LeftBot, (int32)EVert::RightTop, (int32)EVert::RightTop, (int32)EVert::LeftBot, (int32)EVert::RightBot };
+
+    auto GetBase = [&](int32 CellIndex) { return GetCellBase(Layout, CellIndex, CellSize, HeightScale); };
+
+    //Same vertex layout and triangles as AMazeCell::GenerateMesh, Min is the RightBot corner and Max the LeftTop one
+    auto AddQuad = [&](const FVector2D& Min, const FVector2D& Max, const float (&Corners)[4])
+        {
+            const int32 FirstVertex = OutVertices.Num();
+            OutVertices.Add(FVector(Max.X, Min.Y, Corners[(int32)EVert::LeftBot]));
+            OutVertices.Add(FVector(Min.X, Min.Y, Corners[(int32)EVert::RightBot]));
+            OutVertices.Add(FVector(Max.X, Max.Y, Corners[(int32)EVert::LeftTop]));
+            OutVertices.Add(FVector(Min.X, Max.Y, Corners[(int32)EVert::RightTop]));
+            for (int32 Vert : CellTris)
+            {
+                OutTriangles.Add(FirstVertex + Vert);
+            }
+        };
+
+    //Flat cells are joined into runs along each row, and a run continues the rectangle of the row below when it
+    //covers the same cells at the same height. Both lists stay sorted by their first cell
+    TArray<FFloorRect> Open;
+    TArray<FFloorRect> Row;
+    auto AddFloorRect = [&](const FFloorRect& Rect)
+        {
+            const float Corners[4] = { Rect.Z, Rect.Z, Rect.Z, Rect.Z };
+            AddQuad(FVector2D(Rect.FirstX * CellSize, Rect.FirstY * CellSize), FVector2D((Rect.LastX + 1) * CellSize, (Rect.LastY + 1) * CellSize), Corners);
+        };
+
+    for (int32 Y = FMath::Max(MinY, 0); Y < FMath::Min(MaxY, Grid.Depth); Y++)
+    {
+        Row.Reset();
+        for (int32 X = 0; X < Grid.Width; X++)
+        {
+            const int32 CellIndex = Grid.GetIndex(X, Y);
+            const FVector Base = GetBase(CellIndex);
+            float Corners[4] = { Base.Z, Base.Z, Base.Z, Base.Z };
+            if (bElevation)
+            {
+                for (int32 I = 0; I < 4; I++)
+                {
+                    Corners[I] += Elevation.GetCorners(CellIndex)[I] * HeightScale;
+                }
+            }
+
+            if (Corners[0] != Corners[1] || Corners[0] != Corners[2] || Corners[0] != Corners[3])
+            {
+                AddQuad(FVector2D(Base.X, Base.Y), FVector2D(Base.X + CellSize, Base.Y + CellSize), Corners);
+                continue;
+            }
+
+            const float Z = Corners[0];
+            if (Row.Num() > 0 && Row.Last().LastX == X - 1 && Row.Last().Z == Z)
+            {
+                Row.Last().LastX = X;
+            }
+            else
+            {
+                Row.Add({ X, X, Y, Y, Z });
+            }
+        }
+
+        int32 OpenIndex = 0;
+        for (FFloorRect& Rect : Row)
+        {
+            while (OpenIndex < Open.Num() && Open[OpenIndex].FirstX < Rect.FirstX)
+            {
+                AddFloorRect(Open[OpenIndex++]);
+            }
+            if (OpenIndex < Open.Num() && Open[OpenIndex].FirstX == Rect.FirstX)
+            {
+                const FFloorRect& Below = Open[OpenIndex++];
+                if (Below.LastX == Rect.LastX && Below.Z == Rect.Z)
+                {
+                    Rect.FirstY = Below.FirstY;
+                }
+                else
+                {
+                    AddFloorRect(Below);
+                }
+            }
+        }
+        while (OpenIndex < Open.Num())
+        {
+            AddFloorRect(Open[OpenIndex++]);
+        }
+        Swap(Open, Row);
+    }
+    for (const FFloorRect& Rect : Open)
+    {
+        AddFloorRect(Rect);
+    }
+}
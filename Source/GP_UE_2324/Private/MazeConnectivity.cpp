@@ -0,0 +1,458 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeConnectivity.h"
+#include "MazeScratch.h"
+
+namespace
+{
+    //Marks of FMazeDistanceField::Repair
+    constexpr uint8 CutFlag = 1;
+    constexpr uint8 ExpandedFlag = 2;
+    constexpr uint8 ChangedFlag = 4;
+
+    //Distance and label compared as one key, unreached cells are the farthest
+    bool IsCloser(int32 DistanceA, int32 LabelA, int32 DistanceB, int32 LabelB)
+    {
+        if (DistanceA == INDEX_NONE)
+        {
+            return false;
+        }
+        return DistanceB == INDEX_NONE || DistanceA < DistanceB || (DistanceA == DistanceB && LabelA < LabelB);
+    }
+
+    bool AreNeighboursOpen(const FMazeGrid& Grid, int32 A, int32 B)
+    {
+        for (int32 Dir = 0; Dir < FMazeGrid::NumDirections; Dir++)
+        {
+            if (Grid.GetNeighbourIndex(A, (EDirection)Dir) == B)
+            {
+                return Grid.IsOpen(A, (EDirection)Dir);
+            }
+        }
+        return false;
+    }
+}
+
+void FMazeConnectivity::Build(const FMazeGrid& Grid)
+{
+    Components.Init(INDEX_NONE, Grid.Num());
+    Sizes.Reset();
+    FreeComponents.Reset();
+    Marks.Init(0, Grid.Num());
+    Stamp = 0;
+
+    for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+    {
+        if (Components[CellIndex] == INDEX_NONE)
+        {
+            const int32 Component = AddComponent(0);
+            Relabel(Grid, CellIndex, INDEX_NONE, Component);
+        }
+    }
+}
+
+int32 FMazeConnectivity::AddComponent(int32 Size)
+{
+    if (FreeComponents.Num() > 0)
+    {
+        const int32 Component = FreeComponents.Pop(false);
+        Sizes[Component] = Size;
+        return Component;
+    }
+    return Sizes.Add(Size);
+}
+
+//Moves every cell of component From connected to Start into component To
+void FMazeConnectivity::Relabel(const FMazeGrid& Grid, int32 Start, int32 From, int32 To)
+{
+    SearchA.Reset();
+    SearchA.Add(Start);
+    Components[Start] = To;
+
+    for (int32 Head = 0; Head < SearchA.Num(); Head++)
+    {
+        Grid.ForEachOpenNeighbour(SearchA[Head], [&](int32 Neighbour, EDirection Direction)
+            {
+                if (Components[Neighbour] == From)
+                {
+                    Components[Neighbour] = To;
+                    SearchA.Add(Neighbour);
+                }
+            });
+    }
+
+    Sizes[To] += SearchA.Num();
+    if (From != INDEX_NONE)
+    {
+        Sizes[From] -= SearchA.Num();
+    }
+}
+
+bool FMazeConnectivity::OnWallChanged(const FMazeGrid& Grid, int32 A, int32 B, bool bOpened)
+{
+    if (!Components.IsValidIndex(A) || !Components.IsValidIndex(B))
+    {
+        UE_LOG(LogTemp, Error, TEXT("FMazeConnectivity::OnWallChanged invalid cells: %d, %d"), A, B);
+        return false;
+    }
+
+    const int32 ComponentA = Components[A];
+    const int32 ComponentB = Components[B];
+
+    if (bOpened)
+    {
+        if (ComponentA == ComponentB)
+        {
+            return false;
+        }
+
+        //The smaller component joins the bigger one
+        const bool bMoveA = Sizes[ComponentA] < Sizes[ComponentB];
+        const int32 From = bMoveA ? ComponentA : ComponentB;
+        const int32 To = bMoveA ? ComponentB : ComponentA;
+        Relabel(Grid, bMoveA ? A : B, From, To);
+        FreeComponents.Add(From);
+        return true;
+    }
+
+    //A closed wall can only split the component both cells were in
+    return ComponentA == ComponentB && SplitComponents(Grid, A, B);
+}
+
+//Searches from both sides of the closed wall one cell at a time. If the searches meet the component is still connected,
+//otherwise the side that runs out first is exactly the part that was cut off
+bool FMazeConnectivity::SplitComponents(const FMazeGrid& Grid, int32 A, int32 B)
+{
+    if (Stamp >= MAX_uint32 - 2)
+    {
+        FMemory::Memzero(Marks.GetData(), Marks.Num() * sizeof(uint32));
+        Stamp = 0;
+    }
+    Stamp += 2;
+    const uint32 MarkA = Stamp - 1;
+    const uint32 MarkB = Stamp;
+
+    SearchA.Reset();
+    SearchB.Reset();
+    SearchA.Add(A);
+    SearchB.Add(B);
+    Marks[A] = MarkA;
+    Marks[B] = MarkB;
+
+    //Expands one cell of a search, returns false when it reaches a cell of the other search
+    auto Step = [this, &Grid](TArray<int32>& Search, int32& Head, uint32 Mark, uint32 OtherMark)
+        {
+            bool bMet = false;
+            Grid.ForEachOpenNeighbour(Search[Head++], [&](int32 Neighbour, EDirection Direction)
+                {
+                    if (Marks[Neighbour] == OtherMark)
+                    {
+                        bMet = true;
+                    }
+                    else if (Marks[Neighbour] != Mark)
+                    {
+                        Marks[Neighbour] = Mark;
+                        Search.Add(Neighbour);
+                    }
+                });
+            return !bMet;
+        };
+
+    int32 HeadA = 0;
+    int32 HeadB = 0;
+    TArray<int32>* CutOff = nullptr;
+    while (!CutOff)
+    {
+        if (HeadA == SearchA.Num())
+        {
+            CutOff = &SearchA;
+        }
+        else if (!Step(SearchA, HeadA, MarkA, MarkB))
+        {
+            return false;
+        }
+        else if (HeadB == SearchB.Num())
+        {
+            CutOff = &SearchB;
+        }
+        else if (!Step(SearchB, HeadB, MarkB, MarkA))
+        {
+            return false;
+        }
+    }
+
+    const int32 OldComponent = Components[(*CutOff)[0]];
+    const int32 NewComponent = AddComponent(CutOff->Num());
+    Sizes[OldComponent] -= CutOff->Num();
+    for (int32 CellIndex : *CutOff)
+    {
+        Components[CellIndex] = NewComponent;
+    }
+    return true;
+}
+
+void FMazeDistanceField::SetSources(TConstArrayView<int32> NewSources)
+{
+    Sources.Reset(NewSources.Num());
+    Sources.Append(NewSources.GetData(), NewSources.Num());
+    bDirty = true;
+}
+
+bool FMazeDistanceField::Update(const FMazeGrid& Grid)
+{
+    if (bDirty || Distances.Num() != Grid.Num())
+    {
+        Search(Grid);
+        return true;
+    }
+    if (PendingWalls.Num() == 0)
+    {
+        ChangedCells.Reset();
+        return false;
+    }
+    Repair(Grid);
+    return ChangedCells.Num() > 0;
+}
+
+//Many changes before the next update are repaired together, so many that it would touch a good part of the maze
+//anyway are left to one full search
+void FMazeDistanceField::OnWallChanged(int32 A, int32 B)
+{
+    if (bDirty)
+    {
+        return;
+    }
+    if (!Distances.IsValidIndex(A) || !Distances.IsValidIndex(B) || PendingWalls.Num() >= Distances.Num() / 16 + 16)
+    {
+        MarkDirty();
+        return;
+    }
+    PendingWalls.Emplace(A, B);
+}
+
+//Multi-source breadth search, the sources are queued in order so ties go to the lowest source
+void FMazeDistanceField::Search(const FMazeGrid& Grid)
+{
+    FMazeScratchScope Scratch;
+    TMazeScratchArray<int32> Order;
+    Order.Reserve(Grid.Num());
+    Parents.Init(INDEX_NONE, Grid.Num());
+    Distances.Init(INDEX_NONE, Grid.Num());
+    Labels.Init(INDEX_NONE, Grid.Num());
+    Flags.Init(0, Grid.Num());
+    PendingWalls.Reset();
+
+    for (int32 Source = 0; Source < Sources.Num(); Source++)
+    {
+        const int32 CellIndex = Sources[Source];
+        if (Grid.IsValidIndex(CellIndex) && Distances[CellIndex] == INDEX_NONE)
+        {
+            Distances[CellIndex] = 0;
+            Labels[CellIndex] = Source;
+            Order.Add(CellIndex);
+        }
+    }
+
+    for (int32 Head = 0; Head < Order.Num(); Head++)
+    {
+        const int32 Current = Order[Head];
+        Grid.ForEachOpenNeighbour(Current, [&](int32 Neighbour, EDirection Direction)
+            {
+                if (Distances[Neighbour] == INDEX_NONE)
+                {
+                    Distances[Neighbour] = Distances[Current] + 1;
+                    Parents[Neighbour] = Current;
+                    Labels[Neighbour] = Labels[Current];
+                    Order.Add(Neighbour);
+                }
+            });
+    }
+
+    ChangedCells.Reset(Grid.Num());
+    for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+    {
+        ChangedCells.Add(CellIndex);
+    }
+    bDirty = false;
+}
+
+//Every cell keeps the closest (distance, label) of its open neighbours plus one step, which is what the breadth search
+//finds. A closed wall between a cell and its parent cuts off the cells reached through it, they forget their results
+//and start again from their neighbours outside the cut. An opened wall offers the cells at both ends a new key.
+//The new keys are then spread in increasing order, merging the sorted starting keys with a queue that stays sorted
+//because every step adds one to the distance, and a cell stops being improved the first time it is expanded
+void FMazeDistanceField::Repair(const FMazeGrid& Grid)
+{
+    FMazeScratchScope Scratch;
+    TMazeScratchArray<int32> Cut;
+    TMazeScratchArray<int32> OldDistances;
+    TMazeScratchArray<int32> OldLabels;
+    TMazeScratchArray<int32> Seeds;
+    TMazeScratchArray<int32> Work;
+    ChangedCells.Reset();
+
+    auto CutSubtree = [&](int32 Root)
+        {
+            if (Flags[Root] & CutFlag)
+            {
+                return;
+            }
+            const int32 First = Cut.Num();
+            Flags[Root] |= CutFlag;
+            Cut.Add(Root);
+            for (int32 Head = First; Head < Cut.Num(); Head++)
+            {
+                const int32 Current = Cut[Head];
+                for (int32 Dir = 0; Dir < FMazeGrid::NumDirections; Dir++)
+                {
+                    const int32 Child = Grid.GetNeighbourIndex(Current, (EDirection)Dir);
+                    if (Child != INDEX_NONE && Parents[Child] == Current && !(Flags[Child] & CutFlag))
+                    {
+                        Flags[Child] |= CutFlag;
+                        Cut.Add(Child);
+                    }
+                }
+            }
+        };
+
+    for (const TPair<int32, int32>& Wall : PendingWalls)
+    {
+        if (AreNeighboursOpen(Grid, Wall.Key, Wall.Value))
+        {
+            continue;
+        }
+        if (Parents[Wall.Value] == Wall.Key)
+        {
+            CutSubtree(Wall.Value);
+        }
+        else if (Parents[Wall.Key] == Wall.Value)
+        {
+            CutSubtree(Wall.Key);
+        }
+    }
+
+    OldDistances.Reserve(Cut.Num());
+    OldLabels.Reserve(Cut.Num());
+    for (int32 CellIndex : Cut)
+    {
+        OldDistances.Add(Distances[CellIndex]);
+        OldLabels.Add(Labels[CellIndex]);
+        Distances[CellIndex] = INDEX_NONE;
+        Labels[CellIndex] = INDEX_NONE;
+        Parents[CellIndex] = INDEX_NONE;
+    }
+
+    auto Offer = [&](int32 From, int32 To)
+        {
+            if (Distances[From] != INDEX_NONE && !(Flags[To] & ExpandedFlag) && IsCloser(Distances[From] + 1, Labels[From], Distances[To], Labels[To]))
+            {
+                Distances[To] = Distances[From] + 1;
+                Labels[To] = Labels[From];
+                Parents[To] = From;
+                return true;
+            }
+            return false;
+        };
+    auto MarkChanged = [&](int32 CellIndex)
+        {
+            if (!(Flags[CellIndex] & ChangedFlag))
+            {
+                Flags[CellIndex] |= ChangedFlag;
+                ChangedCells.Add(CellIndex);
+            }
+        };
+
+    //The cut cells start from their neighbours that kept their results
+    for (int32 CellIndex : Cut)
+    {
+        Grid.ForEachOpenNeighbour(CellIndex, [&](int32 Neighbour, EDirection Direction)
+            {
+                if (!(Flags[Neighbour] & CutFlag))
+                {
+                    Offer(Neighbour, CellIndex);
+                }
+            });
+        if (Distances[CellIndex] != INDEX_NONE)
+        {
+            Seeds.Add(CellIndex);
+        }
+    }
+    //An opened wall offers each end the key of the other
+    auto OfferSeed = [&](int32 From, int32 To)
+        {
+            if (Offer(From, To))
+            {
+                if (!(Flags[To] & CutFlag))
+                {
+                    MarkChanged(To);
+                }
+                Seeds.Add(To);
+            }
+        };
+    for (const TPair<int32, int32>& Wall : PendingWalls)
+    {
+        if (AreNeighboursOpen(Grid, Wall.Key, Wall.Value))
+        {
+            OfferSeed(Wall.Key, Wall.Value);
+            OfferSeed(Wall.Value, Wall.Key);
+        }
+    }
+    PendingWalls.Reset();
+
+    Seeds.Sort([this](int32 A, int32 B) { return IsCloser(Distances[A], Labels[A], Distances[B], Labels[B]); });
+
+    int32 SeedHead = 0;
+    int32 Head = 0;
+    while (SeedHead < Seeds.Num() || Head < Work.Num())
+    {
+        int32 Current;
+        if (Head < Work.Num() && (SeedHead == Seeds.Num() || !IsCloser(Distances[Seeds[SeedHead]], Labels[Seeds[SeedHead]], Distances[Work[Head]], Labels[Work[Head]])))
+        {
+            Current = Work[Head++];
+        }
+        else
+        {
+            Current = Seeds[SeedHead++];
+        }
+        if (Flags[Current] & ExpandedFlag)
+        {
+            continue;
+        }
+        Flags[Current] |= ExpandedFlag;
+
+        Grid.ForEachOpenNeighbour(Current, [&](int32 Neighbour, EDirection Direction)
+            {
+                if (Offer(Current, Neighbour))
+                {
+                    if (!(Flags[Neighbour] & CutFlag))
+                    {
+                        MarkChanged(Neighbour);
+                    }
+                    Work.Add(Neighbour);
+                }
+            });
+    }
+
+    for (int32 Index = 0; Index < Cut.Num(); Index++)
+    {
+        const int32 CellIndex = Cut[Index];
+        if (Distances[CellIndex] != OldDistances[Index] || Labels[CellIndex] != OldLabels[Index])
+        {
+            MarkChanged(CellIndex);
+        }
+    }
+
+    for (int32 CellIndex : Cut)
+    {
+        Flags[CellIndex] = 0;
+    }
+    for (int32 CellIndex : Seeds)
+    {
+        Flags[CellIndex] = 0;
+    }
+    for (int32 CellIndex : Work)
+    {
+        Flags[CellIndex] = 0;
+    }
+}
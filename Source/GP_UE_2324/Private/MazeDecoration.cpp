@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeDecoration.h"
+#include "Async/ParallelFor.h"
+
+namespace
+{
+    //Props of the chunk whose first cell is already set, from a stream of the seed and that cell
+    void ScatterChunk(const FMazeLayout& Layout, TConstArrayView<FMazeDecorationTheme> Themes, TConstArrayView<int32> ThemeOffsets,
+        int32 NumPropTypes, float CellSize, float ElevationScale, int32 ChunkSize, int32 Seed, FMazeDecorationChunk& Chunk)
+    {
+        const FMazeGrid& Grid = Layout.Grid;
+        Chunk.Instances.Reset();
+        Chunk.Instances.SetNum(NumPropTypes);
+        FRandomStream Stream(HashCombine(GetTypeHash(Seed), GetTypeHash(Chunk.FirstCell)));
+
+        for (int32 Y = Chunk.FirstCell.Y; Y < FMath::Min(Chunk.FirstCell.Y + ChunkSize, Grid.Depth); Y++)
+        {
+            for (int32 X = Chunk.FirstCell.X; X < FMath::Min(Chunk.FirstCell.X + ChunkSize, Grid.Width); X++)
+            {
+                const int32 CellIndex = Grid.GetIndex(X, Y);
+                const int32 Region = Layout.Regions[CellIndex];
+                if (CellIndex == Layout.StartIndex || CellIndex == Layout.ExitIndex || CellIndex == Layout.KeyIndex || !Layout.RegionColors.IsValidIndex(Region))
+                {
+                    continue;
+                }
+
+                const int32 Theme = Layout.RegionColors[Region] % Themes.Num();
+                const TArray<FMazePropType>& Props = Themes[Theme].Props;
+                for (int32 Prop = 0; Prop < Props.Num(); Prop++)
+                {
+                    const FMazePropType& PropType = Props[Prop];
+                    if (!PropType.Mesh || PropType.Density <= 0.f)
+                    {
+                        continue;
+                    }
+
+                    //The fraction of the density is the probability of one more prop
+                    const int32 WholeCount = FMath::FloorToInt(PropType.Density);
+                    const int32 Count = WholeCount + (Stream.FRand() < PropType.Density - WholeCount ? 1 : 0);
+                    const float Margin = FMath::Clamp(PropType.WallMargin, 0.f, 0.5f);
+                    TArray<FTransform>& Instances = Chunk.Instances[ThemeOffsets[Theme] + Prop];
+
+                    for (int32 I = 0; I < Count; I++)
+                    {
+                        const float U = Stream.FRandRange(Margin, 1.f - Margin);
+                        const float V = Stream.FRandRange(Margin, 1.f - Margin);
+                        const float Yaw = PropType.bRandomYaw ? Stream.FRandRange(0.f, 360.f) : 0.f;
+                        const float Scale = Stream.FRandRange(PropType.MinScale, PropType.MaxScale);
+                        const FVector Location((X + U) * CellSize, (Y + V) * CellSize, MazeDecoration::GetFloorHeight(Layout.Elevation, CellIndex, U, V) * ElevationScale);
+                        Instances.Add(FTransform(FRotator(0.f, Yaw, 0.f), Location, FVector(Scale)));
+                    }
+                }
+            }
+        }
+    }
+}
+
+int32 MazeDecoration::GetNumPropTypes(TConstArrayView<FMazeDecorationTheme> Themes)
+{
+    int32 NumPropTypes = 0;
+    for (const FMazeDecorationTheme& Theme : Themes)
+    {
+        NumPropTypes += Theme.Props.Num();
+    }
+    return NumPropTypes;
+}
+
+//U goes along X and V along Y. The floor of a cell is split on the diagonal from LeftBot to RightTop
+float MazeDecoration::GetFloorHeight(const FMazeElevation& Elevation, int32 CellIndex, float U, float V)
+{
+    if (!Elevation.IsValid())
+    {
+        return 0.f;
+    }
+
+    TConstArrayView<float> Corners = Elevation.GetCorners(CellIndex);
+    const float LeftBot = Corners[(int32)EVert::LeftBot];
+    const float RightBot = Corners[(int32)EVert::RightBot];
+    const float LeftTop = Corners[(int32)EVert::LeftTop];
+    const float RightTop = Corners[(int32)EVert::RightTop];
+
+    const float Floor = U + V <= 1.f
+        ? RightBot + U * (LeftBot - RightBot) + V * (RightTop - RightBot)
+        : LeftTop + (1.f - U) * (RightTop - LeftTop) + (1.f - V) * (LeftBot - LeftTop);
+    return Elevation.Heights[CellIndex] + Floor;
+}
+
+void MazeDecoration::Scatter(const FMazeLayout& Layout, TConstArrayView<FMazeDecorationTheme> Themes, float CellSize, float ElevationScale,
+    int32 ChunkSize, int32 Seed, TArray<FMazeDecorationChunk>& OutChunks)
+{
+    ChunkSize = FMath::Max(ChunkSize, 1);
+    TArray<int32> ChunkIndices;
+    ChunkIndices.SetNumUninitialized(FMath::DivideAndRoundUp(Layout.Grid.Width, ChunkSize) * FMath::DivideAndRoundUp(Layout.Grid.Depth, ChunkSize));
+    for (int32 ChunkIndex = 0; ChunkIndex < ChunkIndices.Num(); ChunkIndex++)
+    {
+        ChunkIndices[ChunkIndex] = ChunkIndex;
+    }
+    ScatterChunks(Layout, Themes, CellSize, ElevationScale, ChunkSize, Seed, ChunkIndices, OutChunks);
+}
+
+void MazeDecoration::ScatterChunks(const FMazeLayout& Layout, TConstArrayView<FMazeDecorationTheme> Themes, float CellSize, float ElevationScale,
+    int32 ChunkSize, int32 Seed, TConstArrayView<int32> ChunkIndices, TArray<FMazeDecorationChunk>& OutChunks)
+{
+    OutChunks.Reset();
+    const FMazeGrid& Grid = Layout.Grid;
+    if (!Layout.IsValid() || Themes.Num() == 0 || Layout.Regions.Num() != Grid.Num())
+    {
+        return;
+    }
+
+    //First prop type of every theme in the numbering of all of them
+    TArray<int32> ThemeOffsets;
+    ThemeOffsets.Reserve(Themes.Num());
+    int32 NumPropTypes = 0;
+    for (const FMazeDecorationTheme& Theme : Themes)
+    {
+        ThemeOffsets.Add(NumPropTypes);
+        NumPropTypes += Theme.Props.Num();
+    }
+
+    ChunkSize = FMath::Max(ChunkSize, 1);
+    const int32 ChunksX = FMath::DivideAndRoundUp(Grid.Width, ChunkSize);
+    OutChunks.SetNum(ChunkIndices.Num());
+
+    ParallelFor(OutChunks.Num(), [&](int32 Index)
+        {
+            FMazeDecorationChunk& Chunk = OutChunks[Index];
+            Chunk.FirstCell = FIntPoint((ChunkIndices[Index] % ChunksX) * ChunkSize, (ChunkIndices[Index] / ChunksX) * ChunkSize);
+            ScatterChunk(Layout, Themes, ThemeOffsets, NumPropTypes, CellSize, ElevationScale, ChunkSize, Seed, Chunk);
+        });
+}
@@ -0,0 +1,308 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeElevation.h"
+#include "MazeScratch.h"
+
+namespace
+{
+    //Unscaled height under which two corners are the same
+    constexpr float CornerTolerance = 0.01f;
+}
+
+//Breadth search from the start cell, every reached cell takes its elevation from the cell it was reached from.
+//The stream is only used by this pass so the terrain of a maze can be reproduced from its seed
+void FMazeElevation::Solve(const FMazeGrid& Grid, int32 StartIndex, int32 Seed)
+{
+    const int32 NumCells = Grid.Num();
+    Order.Reset(NumCells);
+    Parents.Init(INDEX_NONE, NumCells);
+    Levels.Init(EElevation::None, NumCells);
+    Heights.Init(0.f, NumCells);
+    Corners.Init(0.f, NumCells * 4);
+
+    if (!Grid.IsValidIndex(StartIndex))
+    {
+        UE_LOG(LogTemp, Error, TEXT("Invalid StartIndex in FMazeElevation::Solve(): %d"), StartIndex);
+        return;
+    }
+
+    FRandomStream Stream(Seed);
+    FMazeScratchScope Scratch;
+    FMazeScratchBitArray Visited(false, NumCells);
+
+    Visited[StartIndex] = true;
+    Order.Add(StartIndex);
+
+    for (int32 Head = 0; Head < Order.Num(); Head++)
+    {
+        const int32 Current = Order[Head];
+        Grid.ForEachOpenNeighbour(Current, [&](int32 Neighbour, EDirection Direction)
+            {
+                if (!Visited[Neighbour])
+                {
+                    Visited[Neighbour] = true;
+                    Parents[Neighbour] = Current;
+                    SolveCell(Current, Neighbour, Direction, Stream);
+                    Order.Add(Neighbour);
+                }
+            });
+    }
+
+    //The openings of a braided maze join cells whose heights come from different paths of the tree
+    TArray<int32> MovedCells;
+    JoinCorners(Grid, FIntRect(0, 0, Grid.Width, Grid.Depth), INDEX_NONE, MovedCells);
+}
+
+//Only the cells of the rectangle move, every other cell keeps its height and its floor. Every cell of the rectangle that
+//opens to a kept cell takes its elevation from it, which are the parent that leads to the start and the top cell of every
+//part of the maze that hangs from the rectangle, and the rest is reached inside the rectangle. The corners of the cells
+//of the rectangle are then joined to the kept ones
+void FMazeElevation::SolveRegion(const FMazeGrid& Grid, const FIntRect& Rect, int32 Seed, TArray<int32>& OutCells)
+{
+    OutCells.Reset();
+    if (!IsValid() || Parents.Num() != Grid.Num())
+    {
+        UE_LOG(LogTemp, Error, TEXT("Error in FMazeElevation::SolveRegion() the elevation does not match the maze"));
+        return;
+    }
+
+    //The start keeps its elevation, every height is relative to it
+    const int32 StartIndex = Order[0];
+    const FIntRect Clamped(FMath::Max(Rect.Min.X, 0), FMath::Max(Rect.Min.Y, 0), FMath::Min(Rect.Max.X, Grid.Width), FMath::Min(Rect.Max.Y, Grid.Depth));
+    auto IsSolved = [&Grid, &Clamped, StartIndex](int32 CellIndex)
+        {
+            const int32 X = Grid.GetX(CellIndex);
+            const int32 Y = Grid.GetY(CellIndex);
+            return CellIndex != StartIndex && X >= Clamped.Min.X && Y >= Clamped.Min.Y && X < Clamped.Max.X && Y < Clamped.Max.Y;
+        };
+
+    for (int32 Y = Clamped.Min.Y; Y < Clamped.Max.Y; Y++)
+    {
+        for (int32 X = Clamped.Min.X; X < Clamped.Max.X; X++)
+        {
+            const int32 CellIndex = Grid.GetIndex(X, Y);
+            if (CellIndex == StartIndex)
+            {
+                continue;
+            }
+            OutCells.Add(CellIndex);
+            Parents[CellIndex] = INDEX_NONE;
+            Levels[CellIndex] = EElevation::None;
+            Heights[CellIndex] = 0.f;
+            for (int32 I = 0; I < 4; I++)
+            {
+                Corners[CellIndex * 4 + I] = 0.f;
+            }
+        }
+    }
+
+    FRandomStream Stream(Seed);
+    FMazeScratchScope Scratch;
+    TMazeScratchArray<int32> Queue;
+    Queue.Reserve(OutCells.Num());
+    for (int32 CellIndex : OutCells)
+    {
+        Grid.ForEachOpenNeighbour(CellIndex, [&](int32 Neighbour, EDirection Direction)
+            {
+                if (Parents[CellIndex] == INDEX_NONE && !IsSolved(Neighbour))
+                {
+                    Parents[CellIndex] = Neighbour;
+                    SolveCell(Neighbour, CellIndex, FMazeGrid::GetOpposite(Direction), Stream);
+                    Queue.Add(CellIndex);
+                }
+            });
+    }
+
+    //A cell of the rectangle is solved once it has a parent
+    for (int32 Head = 0; Head < Queue.Num(); Head++)
+    {
+        const int32 Current = Queue[Head];
+        Grid.ForEachOpenNeighbour(Current, [&](int32 Neighbour, EDirection Direction)
+            {
+                if (Parents[Neighbour] == INDEX_NONE && IsSolved(Neighbour))
+                {
+                    Parents[Neighbour] = Current;
+                    SolveCell(Current, Neighbour, Direction, Stream);
+                    Queue.Add(Neighbour);
+                }
+            });
+    }
+
+    JoinCorners(Grid, Clamped, StartIndex, OutCells);
+}
+
+//Cells that open to each other share the two corners of that side. The tree of the solve joins them along its edges, the
+//other openings join cells whose heights come from different paths. Around every vertex of the cells of Rect the corners
+//joined by open sides take their mean height, or the height of the ones of cells outside Rect and of KeptIndex, which keep
+//theirs. Two kept cells that only meet at the vertex through a cell of Rect can disagree there, then their corners on it
+//move to the mean of them too and they are added to OutMovedCells
+void FMazeElevation::JoinCorners(const FMazeGrid& Grid, const FIntRect& Rect, int32 KeptIndex, TArray<int32>& OutMovedCells)
+{
+    //Cells around a vertex as X + 2 * Y from the one below and to the right of it, and the corner of each on the vertex
+    const int32 Verts[4] = { (int32)EVert::LeftTop, (int32)EVert::RightTop, (int32)EVert::LeftBot, (int32)EVert::RightBot };
+
+    for (int32 VY = FMath::Max(Rect.Min.Y, 0); VY <= FMath::Min(Rect.Max.Y, Grid.Depth); VY++)
+    {
+        for (int32 VX = FMath::Max(Rect.Min.X, 0); VX <= FMath::Min(Rect.Max.X, Grid.Width); VX++)
+        {
+            int32 Cells[4];
+            bool bKept[4];
+            int32 Groups[4] = { 0, 1, 2, 3 };
+            for (int32 I = 0; I < 4; I++)
+            {
+                const int32 X = VX - 1 + (I & 1);
+                const int32 Y = VY - 1 + (I >> 1);
+                const bool bInGrid = X >= 0 && Y >= 0 && X < Grid.Width && Y < Grid.Depth;
+                Cells[I] = bInGrid ? Grid.GetIndex(X, Y) : INDEX_NONE;
+                bKept[I] = X < Rect.Min.X || Y < Rect.Min.Y || X >= Rect.Max.X || Y >= Rect.Max.Y || (bInGrid && Cells[I] == KeptIndex);
+            }
+
+            auto Join = [&](int32 A, int32 B, EDirection Direction)
+                {
+                    if (Cells[A] != INDEX_NONE && Cells[B] != INDEX_NONE && Grid.IsOpen(Cells[A], Direction))
+                    {
+                        const int32 From = Groups[B];
+                        for (int32& Group : Groups)
+                        {
+                            Group = Group == From ? Groups[A] : Group;
+                        }
+                    }
+                };
+            Join(0, 1, EDirection::Left);
+            Join(2, 3, EDirection::Left);
+            Join(0, 2, EDirection::Top);
+            Join(1, 3, EDirection::Top);
+
+            for (int32 Group = 0; Group < 4; Group++)
+            {
+                float Sum = 0.f;
+                float KeptSum = 0.f;
+                float KeptMin = MAX_flt;
+                float KeptMax = -MAX_flt;
+                int32 Num = 0;
+                int32 NumKept = 0;
+                for (int32 I = 0; I < 4; I++)
+                {
+                    if (Groups[I] == Group && Cells[I] != INDEX_NONE)
+                    {
+                        const float Z = Heights[Cells[I]] + Corners[Cells[I] * 4 + Verts[I]];
+                        Sum += Z;
+                        Num++;
+                        if (bKept[I])
+                        {
+                            KeptSum += Z;
+                            KeptMin = FMath::Min(KeptMin, Z);
+                            KeptMax = FMath::Max(KeptMax, Z);
+                            NumKept++;
+                        }
+                    }
+                }
+                if (Num < 2 || NumKept == Num)
+                {
+                    continue;
+                }
+
+                //Kept corners that were joined before only differ by the rounding of their heights
+                const bool bKeptMeet = NumKept == 0 || KeptMax - KeptMin <= CornerTolerance;
+                const float Z = NumKept > 0 ? KeptSum / NumKept : Sum / Num;
+                for (int32 I = 0; I < 4; I++)
+                {
+                    if (Groups[I] == Group && Cells[I] != INDEX_NONE && (!bKept[I] || !bKeptMeet))
+                    {
+                        Corners[Cells[I] * 4 + Verts[I]] = Z - Heights[Cells[I]];
+                        if (bKept[I])
+                        {
+                            OutMovedCells.AddUnique(Cells[I]);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+//To generate some sense of terrain there is a 1/4 of probability staying the same elevation as the currentCell,
+//if elevation is None then it changes slightly, if its already slightly
+//is has a probality of 1/3 to change back to None, if not it will change drastically
+//and if its already changed drastically it will go to a slight change
+EElevation FMazeElevation::GetNextElevation(EElevation CurrentElev, FRandomStream& Stream)
+{
+    if (Stream.FRand() <= 0.25f)
+    {
+        return CurrentElev;
+    }
+
+    switch (CurrentElev)
+    {
+    case EElevation::MinusMax:
+        return EElevation::MinusMin;
+    case EElevation::MinusMin:
+        return Stream.FRand() < 1.f / 3.f ? EElevation::None : EElevation::MinusMax;
+    case EElevation::None:
+        return Stream.FRand() < 0.5f ? EElevation::PlusMin : EElevation::MinusMin;
+    case EElevation::PlusMin:
+        return Stream.FRand() < 1.f / 3.f ? EElevation::None : EElevation::PlusMax;
+    case EElevation::PlusMax:
+        return EElevation::PlusMin;
+    default:
+        UE_LOG(LogTemp, Error, TEXT("Error in FMazeElevation::GetNextElevation() switch CurrentElev"));
+        return CurrentElev;
+    }
+}
+
+float FMazeElevation::GetElevationOffset(EElevation Elevation, FRandomStream& Stream)
+{
+    switch (Elevation)
+    {
+    case EElevation::PlusMax:
+        return 75.f + Stream.FRandRange(-15.f, 10.f);
+    case EElevation::PlusMin:
+        return 25.f + Stream.FRandRange(-10.f, 30.f);
+    case EElevation::None:
+        return 0.f;
+    case EElevation::MinusMin:
+        return -25.f + Stream.FRandRange(-30.f, 10.f);
+    case EElevation::MinusMax:
+        return -75.f + Stream.FRandRange(-10.f, 15.f);
+    default:
+        UE_LOG(LogTemp, Error, TEXT("Error in FMazeElevation::GetElevationOffset() switch Elevation"));
+        return 0.f;
+    }
+}
+
+//Raises the next cell by the offset of its elevation and moves the floor vertices it shares with
+//the current cell down by the same amount, so both floors stay joined
+void FMazeElevation::SolveCell(int32 CurrentIndex, int32 NextIndex, EDirection Direction, FRandomStream& Stream)
+{
+    Levels[NextIndex] = GetNextElevation(Levels[CurrentIndex], Stream);
+    const float Elevation = GetElevationOffset(Levels[NextIndex], Stream);
+
+    Heights[NextIndex] = Heights[CurrentIndex] + Elevation;
+
+    const float* Prev = Corners.GetData() + CurrentIndex * 4;
+    float* Next = Corners.GetData() + NextIndex * 4;
+
+    switch (Direction)
+    {
+    case EDirection::Right:
+        Next[(int32)EVert::LeftBot] = Prev[(int32)EVert::RightBot] - Elevation;
+        Next[(int32)EVert::LeftTop] = Prev[(int32)EVert::RightTop] - Elevation;
+        break;
+    case EDirection::Left:
+        Next[(int32)EVert::RightBot] = Prev[(int32)EVert::LeftBot] - Elevation;
+        Next[(int32)EVert::RightTop] = Prev[(int32)EVert::LeftTop] - Elevation;
+        break;
+    case EDirection::Bottom:
+        Next[(int32)EVert::LeftTop] = Prev[(int32)EVert::LeftBot] - Elevation;
+        Next[(int32)EVert::RightTop] = Prev[(int32)EVert::RightBot] - Elevation;
+        break;
+    case EDirection::Top:
+        Next[(int32)EVert::LeftBot] = Prev[(int32)EVert::LeftTop] - Elevation;
+        Next[(int32)EVert::RightBot] = Prev[(int32)EVert::RightTop] - Elevation;
+        break;
+    default:
+        UE_LOG(LogTemp, Error, TEXT("Error in FMazeElevation::SolveCell()"));
+        break;
+    }
+}
@@ -0,0 +1,446 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeGeneration.h"
+#include "PathSearch.h"
+#include "MazePathfinder.h"
+#include "Async/ParallelFor.h"
+
+//The stream is copied after the start is drawn, so the regions draw the same numbers as when every stage ran in
+//order and the same seed still gives the same maze
+void MazeGeneration::BuildLayout(const FMazeSettings& Settings, FMazeLayout& OutLayout, FMazePipelineTimings* OutTimings, bool bParallel)
+{
+    FRandomStream Stream(Settings.Seed);
+    OutLayout = FMazeLayout();
+
+    FMazePipeline Pipeline;
+    Pipeline.AddStage(TEXT("Carve"), EMazeData::None, EMazeData::Grid | EMazeData::Start | EMazeData::Stream, [&Settings, &Stream, &OutLayout]()
+        {
+            OutLayout.Grid.Init(Settings.Width, Settings.Depth);
+            GenerateEllers(OutLayout.Grid, Stream, Settings.EllersMergeProb);
+            if (Settings.BraidFactor > 0.f)
+            {
+                Braid(OutLayout.Grid, Stream, Settings.BraidFactor);
+            }
+
+            // Randomly select a start position in the first row
+            OutLayout.StartIndex = Stream.RandRange(0, Settings.Width - 1);
+        });
+
+    Pipeline.AddStage(TEXT("ExitAndKey"), EMazeData::Grid | EMazeData::Start, EMazeData::ExitAndKey, [&OutLayout]()
+        {
+            TPair<int32, int32> ExitAndKey = PathSearch::GetExitAndKey(OutLayout.Grid, OutLayout.StartIndex);
+            OutLayout.ExitIndex = ExitAndKey.Key;
+            OutLayout.KeyIndex = ExitAndKey.Value;
+        });
+
+    Pipeline.AddStage(TEXT("Regions"), EMazeData::Grid | EMazeData::Stream, EMazeData::Regions, [&Settings, &Stream, &OutLayout]()
+        {
+            FRandomStream RegionStream = Stream;
+            SetVoronoidRegions(Settings, RegionStream, OutLayout);
+        });
+
+    if (Settings.bSolveElevation)
+    {
+        Pipeline.AddStage(TEXT("Elevation"), EMazeData::Grid | EMazeData::Start, EMazeData::Elevation, [&Settings, &OutLayout]()
+            {
+                OutLayout.Elevation.Solve(OutLayout.Grid, OutLayout.StartIndex, Settings.GetElevationSeed());
+            });
+    }
+
+    Pipeline.AddStage(TEXT("AreaRegions"), EMazeData::ExitAndKey | EMazeData::Regions, EMazeData::Regions, [&OutLayout]()
+        {
+            OutLayout.UpdateExitAndKeyRegions();
+        });
+
+    Pipeline.Run(OutTimings, bParallel);
+}
+
+//The layers only depend on each other through the stairs, so they are carved in parallel first. Then the stairs
+//are chained from the bottom, each one on the farthest cell from the stairs below, and the elevation of every
+//layer is solved in parallel from where the player arrives on it
+void MazeGeneration::BuildTower(const FMazeSettings& Settings, FMazeTower& OutTower)
+{
+    const int32 NumLayers = FMath::Max(Settings.NumLayers, 1);
+    OutTower = FMazeTower();
+    OutTower.Layers.SetNum(NumLayers);
+    OutTower.Links.Init(INDEX_NONE, NumLayers - 1);
+
+    ParallelFor(NumLayers, [&Settings, &OutTower](int32 Layer)
+        {
+            FMazeLayout& LayerLayout = OutTower.Layers[Layer];
+            FRandomStream Stream(HashCombine(GetTypeHash(Settings.Seed), GetTypeHash(Layer)));
+
+            LayerLayout.Grid.Init(Settings.Width, Settings.Depth);
+            GenerateEllers(LayerLayout.Grid, Stream, Settings.EllersMergeProb);
+            if (Settings.BraidFactor > 0.f)
+            {
+                Braid(LayerLayout.Grid, Stream, Settings.BraidFactor);
+            }
+            LayerLayout.StartIndex = Stream.RandRange(0, Settings.Width - 1);
+            SetVoronoidRegions(Settings, Stream, LayerLayout);
+        });
+
+    FMazeScratchScope Scratch;
+    TMazeScratchArray<int32> Order;
+    TMazeScratchArray<int32> Parents;
+    TMazeScratchArray<int32> Distances;
+    for (int32 Layer = 0; Layer < NumLayers; Layer++)
+    {
+        FMazeLayout& LayerLayout = OutTower.Layers[Layer];
+        if (Layer > 0)
+        {
+            LayerLayout.StartIndex = OutTower.Links[Layer - 1];
+        }
+
+        //Only the top layer has the real exit and the key
+        if (Layer + 1 < NumLayers)
+        {
+            PathSearch::BreadthSearch(LayerLayout.Grid, LayerLayout.StartIndex, Order, Parents, Distances);
+            LayerLayout.ExitIndex = Order.Num() > 0 ? Order.Last() : INDEX_NONE;
+            OutTower.Links[Layer] = LayerLayout.ExitIndex;
+        }
+        else
+        {
+            TPair<int32, int32> ExitAndKey = PathSearch::GetExitAndKey(LayerLayout.Grid, LayerLayout.StartIndex);
+            LayerLayout.ExitIndex = ExitAndKey.Key;
+            LayerLayout.KeyIndex = ExitAndKey.Value;
+        }
+
+        LayerLayout.UpdateExitAndKeyRegions();
+    }
+
+    if (Settings.bSolveElevation)
+    {
+        const int32 ElevationSeed = Settings.GetElevationSeed();
+        ParallelFor(NumLayers, [&OutTower, ElevationSeed](int32 Layer)
+            {
+                FMazeLayout& LayerLayout = OutTower.Layers[Layer];
+                LayerLayout.Elevation.Solve(LayerLayout.Grid, LayerLayout.StartIndex, (int32)HashCombine(GetTypeHash(ElevationSeed), GetTypeHash(Layer)));
+            });
+    }
+}
+
+//Generates Maze using Ellers algorithm for maze generation, one row at a time.
+//The sets of the current row are kept as labels in a small union find that is compacted after every row
+void MazeGeneration::GenerateEllers(FMazeGrid& Grid, FRandomStream& Stream, float MergeProb)
+{
+    const int32 Width = Grid.Width;
+    const int32 Depth = Grid.Depth;
+
+    FMazeScratchScope Scratch;
+    TMazeScratchArray<int32> Sets;
+    TMazeScratchArray<int32> Parents;
+    TMazeScratchArray<int32> Counts;
+    TMazeScratchArray<int32> Chosen;
+    TMazeScratchArray<int32> Remap;
+    Sets.SetNumUninitialized(Width);
+    Parents.SetNumUninitialized(Width);
+    Counts.SetNumUninitialized(Width);
+    Chosen.SetNumUninitialized(Width);
+    Remap.SetNumUninitialized(Width);
+
+    auto FindSet = [&Parents](int32 Set)
+        {
+            while (Parents[Set] != Set)
+            {
+                Parents[Set] = Parents[Parents[Set]];
+                Set = Parents[Set];
+            }
+            return Set;
+        };
+
+    for (int32 X = 0; X < Width; X++)
+    {
+        Sets[X] = X;
+    }
+
+    for (int32 Y = 0; Y < Depth; Y++)
+    {
+        for (int32 Set = 0; Set < Width; Set++)
+        {
+            Parents[Set] = Set;
+        }
+
+        //There is a probabily of joining different cells in different sets
+        //or if its the last row join the different cells in different sets to create perfect maze
+        for (int32 X = 1; X < Width; X++)
+        {
+            if (Stream.FRand() < MergeProb || Y == Depth - 1)
+            {
+                const int32 CurrentSet = FindSet(Sets[X]);
+                const int32 RightSet = FindSet(Sets[X - 1]);
+                if (CurrentSet != RightSet)
+                {
+                    Grid.OpenWall(Grid.GetIndex(X, Y), EDirection::Right);
+                    Parents[CurrentSet] = RightSet;
+                }
+            }
+        }
+
+        if (Y == Depth - 1)
+        {
+            break;
+        }
+
+        //For each set remaining join one random cell with the above row, picked uniformly while walking the row
+        for (int32 X = 0; X < Width; X++)
+        {
+            Sets[X] = FindSet(Sets[X]);
+            Counts[Sets[X]] = 0;
+        }
+        for (int32 X = 0; X < Width; X++)
+        {
+            const int32 Set = Sets[X];
+            Counts[Set]++;
+            if (Stream.RandRange(0, Counts[Set] - 1) == 0)
+            {
+                Chosen[Set] = X;
+            }
+        }
+
+        //Cells joined from below keep their set, the others start a new one
+        int32 NextSet = 0;
+        for (int32 Set = 0; Set < Width; Set++)
+        {
+            Remap[Set] = INDEX_NONE;
+        }
+        for (int32 X = 0; X < Width; X++)
+        {
+            const int32 Set = Sets[X];
+            if (Chosen[Set] == X)
+            {
+                Grid.OpenWall(Grid.GetIndex(X, Y), EDirection::Top);
+                if (Remap[Set] == INDEX_NONE)
+                {
+                    Remap[Set] = NextSet++;
+                }
+                Sets[X] = Remap[Set];
+            }
+            else
+            {
+                Sets[X] = INDEX_NONE;
+            }
+        }
+        for (int32 X = 0; X < Width; X++)
+        {
+            if (Sets[X] == INDEX_NONE)
+            {
+                Sets[X] = NextSet++;
+            }
+        }
+    }
+}
+
+//Removes dead ends in a random order by opening one of their walls until BraidFactor of them are gone, which adds
+//loops to the maze. A wall to another dead end is preferred because opening it removes both of them
+void MazeGeneration::Braid(FMazeGrid& Grid, FRandomStream& Stream, float BraidFactor)
+{
+    FMazeScratchScope Scratch;
+    TMazeScratchArray<int32> DeadEnds;
+    DeadEnds.Reserve(Grid.Num());
+    for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+    {
+        if (Grid.GetOpenCount(CellIndex) == 1)
+        {
+            DeadEnds.Add(CellIndex);
+        }
+    }
+
+    for (int32 I = DeadEnds.Num() - 1; I > 0; I--)
+    {
+        DeadEnds.Swap(I, Stream.RandRange(0, I));
+    }
+
+    const int32 NumToRemove = FMath::RoundToInt(FMath::Clamp(BraidFactor, 0.f, 1.f) * DeadEnds.Num());
+    int32 NumRemoved = 0;
+    for (int32 I = 0; I < DeadEnds.Num() && NumRemoved < NumToRemove; I++)
+    {
+        const int32 CellIndex = DeadEnds[I];
+        //Already opened from a neighbouring dead end
+        if (Grid.GetOpenCount(CellIndex) != 1)
+        {
+            continue;
+        }
+
+        EDirection Candidates[FMazeGrid::NumDirections];
+        int32 NumCandidates = 0;
+        bool bToDeadEnd = false;
+        for (int32 Dir = 0; Dir < FMazeGrid::NumDirections; Dir++)
+        {
+            const int32 Neighbour = Grid.GetNeighbourIndex(CellIndex, (EDirection)Dir);
+            if (Neighbour == INDEX_NONE || Grid.IsOpen(CellIndex, (EDirection)Dir))
+            {
+                continue;
+            }
+
+            const bool bNeighbourDeadEnd = Grid.GetOpenCount(Neighbour) == 1;
+            if (bNeighbourDeadEnd && !bToDeadEnd)
+            {
+                NumCandidates = 0;
+                bToDeadEnd = true;
+            }
+            if (bNeighbourDeadEnd == bToDeadEnd)
+            {
+                Candidates[NumCandidates++] = (EDirection)Dir;
+            }
+        }
+
+        if (NumCandidates > 0)
+        {
+            Grid.OpenWall(CellIndex, Candidates[Stream.RandRange(0, NumCandidates - 1)]);
+            NumRemoved += bToDeadEnd ? 2 : 1;
+        }
+    }
+}
+
+//Every part of the maze outside the rectangle either hangs from a cell of the rectangle, its top cell has its parent inside,
+//or holds the start. The parts that hang keep the opening to their parent and the part with the start keeps the opening of
+//the last cell of the rectangle on the way to the start, any other opening would close a loop with the new cells
+bool MazeGeneration::RegenerateRegion(FMazeGrid& Grid, TConstArrayView<int32> Parents, const FIntRect& Rect, int32 Seed, float MergeProb,
+    TArray<TPair<int32, EDirection>>& OutChangedWalls)
+{
+    OutChangedWalls.Reset();
+    const FIntPoint Min(FMath::Max(Rect.Min.X, 0), FMath::Max(Rect.Min.Y, 0));
+    const FIntPoint Max(FMath::Min(Rect.Max.X, Grid.Width), FMath::Min(Rect.Max.Y, Grid.Depth));
+    const int32 Width = Max.X - Min.X;
+    const int32 Depth = Max.Y - Min.Y;
+    if (Width <= 0 || Depth <= 0 || Parents.Num() != Grid.Num())
+    {
+        UE_LOG(LogTemp, Error, TEXT("Error in MazeGeneration::RegenerateRegion() the rectangle is empty or Parents does not match the maze"));
+        return false;
+    }
+
+    auto GetLocalIndex = [&Grid, Min, Max, Width](int32 CellIndex)
+        {
+            const int32 X = Grid.GetX(CellIndex);
+            const int32 Y = Grid.GetY(CellIndex);
+            return X >= Min.X && X < Max.X && Y >= Min.Y && Y < Max.Y ? (Y - Min.Y) * Width + X - Min.X : INDEX_NONE;
+        };
+
+    int32 Highest = INDEX_NONE;
+    for (int32 CellIndex = Grid.GetIndex(Min.X, Min.Y), Steps = 0; CellIndex != INDEX_NONE; CellIndex = Parents[CellIndex], Steps++)
+    {
+        if (Steps > Grid.Num())
+        {
+            UE_LOG(LogTemp, Error, TEXT("Error in MazeGeneration::RegenerateRegion() Parents is not a tree"));
+            return false;
+        }
+        if (GetLocalIndex(CellIndex) != INDEX_NONE)
+        {
+            Highest = CellIndex;
+        }
+    }
+
+    FMazeGrid Region;
+    Region.Init(Width, Depth);
+    FRandomStream Stream(Seed);
+    GenerateEllers(Region, Stream, MergeProb);
+
+    FMazeScratchScope Scratch;
+    TMazeScratchArray<uint8> OldCells;
+    OldCells.SetNumUninitialized(Region.Num());
+    for (int32 LocalIndex = 0; LocalIndex < Region.Num(); LocalIndex++)
+    {
+        const int32 CellIndex = Grid.GetIndex(Min.X + Region.GetX(LocalIndex), Min.Y + Region.GetY(LocalIndex));
+        OldCells[LocalIndex] = Grid.Cells[CellIndex];
+
+        for (int32 Dir = 0; Dir < FMazeGrid::NumDirections; Dir++)
+        {
+            const int32 Neighbour = Grid.GetNeighbourIndex(CellIndex, (EDirection)Dir);
+            if (Neighbour == INDEX_NONE)
+            {
+                continue;
+            }
+
+            const bool bOpen = GetLocalIndex(Neighbour) != INDEX_NONE ? Region.IsOpen(LocalIndex, (EDirection)Dir)
+                : Grid.IsOpen(CellIndex, (EDirection)Dir) && (Parents[Neighbour] == CellIndex || (CellIndex == Highest && Parents[CellIndex] == Neighbour));
+            if (bOpen)
+            {
+                Grid.OpenWall(CellIndex, (EDirection)Dir);
+            }
+            else
+            {
+                Grid.CloseWall(CellIndex, (EDirection)Dir);
+            }
+        }
+    }
+
+    for (int32 LocalIndex = 0; LocalIndex < Region.Num(); LocalIndex++)
+    {
+        const int32 CellIndex = Grid.GetIndex(Min.X + Region.GetX(LocalIndex), Min.Y + Region.GetY(LocalIndex));
+        const uint8 Changed = OldCells[LocalIndex] ^ Grid.Cells[CellIndex];
+        for (int32 Dir = 0; Dir < FMazeGrid::NumDirections; Dir++)
+        {
+            const int32 Neighbour = (Changed & (1 << Dir)) ? Grid.GetNeighbourIndex(CellIndex, (EDirection)Dir) : INDEX_NONE;
+            if (Neighbour != INDEX_NONE && (GetLocalIndex(Neighbour) == INDEX_NONE || Neighbour > CellIndex))
+            {
+                OutChangedWalls.Emplace(CellIndex, (EDirection)Dir);
+            }
+        }
+    }
+    return true;
+}
+
+//A voronoid grid is used to create areas with different colors in the maze, one random point in every
+//block of VoronoidCellSize cells and every cell belongs to the region of its closest point along the maze
+void MazeGeneration::SetVoronoidRegions(const FMazeSettings& Settings, FRandomStream& Stream, FMazeLayout& Layout)
+{
+    const FMazeGrid& Grid = Layout.Grid;
+    const int32 VoronoidGridWidth = Grid.Width / Settings.VoronoidCellSize;
+    const int32 VoronoidGridDepth = Grid.Depth / Settings.VoronoidCellSize;
+
+    Layout.VoronoidPoints.Reset(VoronoidGridWidth * VoronoidGridDepth);
+    Layout.RegionColors.Reset(VoronoidGridWidth * VoronoidGridDepth);
+
+    for (int32 I = 0; I < VoronoidGridDepth; I++)
+    {
+        for (int32 J = 0; J < VoronoidGridWidth; J++)
+        {
+            const int32 Y = Stream.RandRange(I * Settings.VoronoidCellSize, (I + 1) * Settings.VoronoidCellSize - 1);
+            const int32 X = Stream.RandRange(J * Settings.VoronoidCellSize, (J + 1) * Settings.VoronoidCellSize - 1);
+            Layout.VoronoidPoints.Add(Grid.GetIndex(X, Y));
+            Layout.RegionColors.Add(Stream.RandRange(0, Settings.NumColors - 1));
+        }
+    }
+
+    PathSearch::GetClosestVoronoids(Grid, Layout.VoronoidPoints, Layout.Regions);
+}
+
+void MazeGeneration::ComputeMetrics(const FMazeLayout& Layout, FMazeMetrics& OutMetrics)
+{
+    const FMazeGrid& Grid = Layout.Grid;
+    OutMetrics = FMazeMetrics();
+    OutMetrics.NumCells = Grid.Num();
+
+    for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+    {
+        if (Grid.GetOpenCount(CellIndex) == 1)
+        {
+            OutMetrics.DeadEnds++;
+        }
+    }
+    OutMetrics.DeadEndRatio = Grid.Num() > 0 ? (float)OutMetrics.DeadEnds / Grid.Num() : 0.f;
+
+    if (!Grid.IsValidIndex(Layout.ExitIndex))
+    {
+        return;
+    }
+
+    FMazeScratchScope Scratch;
+    TMazeScratchArray<int32> Order;
+    TMazeScratchArray<int32> Parents;
+    TMazeScratchArray<int32> Distances;
+    PathSearch::BreadthSearch(Grid, Layout.StartIndex, Order, Parents, Distances);
+
+    OutMetrics.SolutionLength = Distances[Layout.ExitIndex];
+    if (!Grid.IsValidIndex(Layout.KeyIndex))
+    {
+        return;
+    }
+    OutMetrics.KeyDistance = Distances[Layout.KeyIndex];
+
+    //The search tree only gives the distance between two cells when the maze has no loops
+    FMazePathfinder Pathfinder;
+    OutMetrics.KeyExitDistance = Pathfinder.GetPathCost(Grid, Layout.KeyIndex, Layout.ExitIndex);
+}
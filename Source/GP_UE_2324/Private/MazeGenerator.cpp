@@ -2,11 +2,40 @@
 
 
 #include "MazeGenerator.h"
+#include "MazeGeneration.h"
+#include "MazeDecoration.h"
+#include "MazeCache.h"
+#include "MazeCollision.h"
 #include "PathSearch.h"
+#include "TimerManager.h"
+#include "HAL/PlatformTime.h"
+#include "MazeMinimapSubsystem.h"
+#include "MazeQuerySubsystem.h"
+#include "MazeNavigationData.h"
+#include "NavigationSystem.h"
+#include "EngineUtils.h"
 #include "GameFramework/PlayerController.h"
 #include "GameFramework/Character.h"
-float AMazeGenerator::ElevationRatio;
-int AMazeGenerator::CellSize;
+#include "Materials/MaterialInstanceDynamic.h"
+#include "Engine/CollisionProfile.h"
+#include "Engine/StaticMesh.h"
+#include "HAL/IConsoleManager.h"
+
+namespace
+{
+    FAutoConsoleCommandWithWorld MazeMemoryCommand(
+        TEXT("Maze.Memory"),
+        TEXT("Logs the memory of every maze of the world by subsystem and per cell"),
+        FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+            {
+                for (TActorIterator<AMazeGenerator> It(World); It; ++It)
+                {
+                    FMazeMemoryStats Stats;
+                    It->GetMemoryStats(Stats);
+                    UE_LOG(LogTemp, Display, TEXT("Maze.Memory %s: %s, budget %d MB"), *It->GetName(), *Stats.ToString(), It->MemoryBudgetMB);
+                }
+            }));
+}
 
 // Sets default values
 AMazeGenerator::AMazeGenerator()
@@ -15,6 +44,34 @@ AMazeGenerator::AMazeGenerator()
 	PrimaryActorTick.bCanEverTick = false;
     RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("RootComponent"));
     Root = RootComponent;
+    Seed = 0;
+    BraidFactor = 0.f;
+    ElevationSeed = 0;
+    ElevationRatio = 8.f;
+    CellSize = 10;
+    StartCell = nullptr;
+    BakeChunkSize = 16;
+    DecorationChunkSize = 8;
+    DecorationCullDistance = 0.f;
+    bBaked = false;
+    bUpdateExitAndKeyOnWallChange = false;
+    bUseMazeNavigation = true;
+    SeedSearchCandidates = 20000;
+    bUseGenerationCache = true;
+    GenerationCacheSizeMB = 64;
+    MemoryBudgetMB = 0;
+    NavigationData = nullptr;
+    bServerCollisionOnly = true;
+    ServerCollision = nullptr;
+    ServerFloorCollision = nullptr;
+    bWallChangesPending = false;
+    NumLayers = 1;
+    LayerHeight = 500.f;
+    StreamedLayerRadius = 1;
+    LayerStreamingInterval = 0.25f;
+    LayerCellsPerFrame = 256;
+    CurrentLayer = 0;
+    bLayerCellsPending = false;
 }
 
 // Called when the game starts or when spawned
@@ -22,7 +79,97 @@ void AMazeGenerator::BeginPlay()
 {
 	Super::BeginPlay();
 
-	//Validate default values and set them
+    BuildMaze(ValidateSettings());
+
+    //The queries only see the maze once its layout exists
+    if (UMazeQuerySubsystem* Queries = GetWorld()->GetSubsystem<UMazeQuerySubsystem>())
+    {
+        Queries->RegisterMaze(this);
+    }
+}
+
+//Builds the maze of BeginPlay in the way its world needs: data and collision on servers, the saved components of a
+//baked maze, streamed layers for towers or one actor per cell
+void AMazeGenerator::BuildMaze(const FMazeSettings& Settings)
+{
+    //Nothing is drawn on a dedicated server, so the maze only gets its data and its collision. The components of a
+    //baked maze are dropped and its saved layout is used
+    if (IsServerMaze())
+    {
+        if (bBaked && Layout.IsValid())
+        {
+            DestroyBakedGeometry();
+            DestroyDecoration();
+        }
+        else
+        {
+            GenerateLayouts(Settings);
+        }
+        BuildServerCollision();
+        MovePlayerToStart();
+        PlaceExitAndKey();
+        PlaceObjects();
+        UpdateNavigation();
+        CheckMemoryBudget();
+        return;
+    }
+
+    //A baked maze already has its components and layout saved in the level
+    if (bBaked && Layout.IsValid())
+    {
+        MovePlayerToStart();
+        PlaceObjects();
+        UpdateMinimap();
+        UpdateNavigation();
+        CheckMemoryBudget();
+        return;
+    }
+
+    //A tower only spawns the layers around the player, the ground layer is also kept as the layout of the queries
+    if (Settings.NumLayers > 1)
+    {
+        GenerateLayouts(Settings);
+        LayerActors.SetNum(Tower.NumLayers());
+
+        MovePlayerToStart();
+        UpdateStreamedLayers();
+        //The layer of the player has to be there on the first frame
+        UpdateLayerCells(Tower.Layers[CurrentLayer].Grid.Num());
+        PlaceExitAndKey();
+        UpdateMinimap();
+        UpdateNavigation();
+        GetWorldTimerManager().SetTimer(LayerStreamingTimer, this, &AMazeGenerator::UpdateStreamedLayers, LayerStreamingInterval, true);
+        return;
+    }
+
+    //All the algorithms run on data first, the actors are only created and updated from the result
+    GenerateLayouts(Settings);
+
+    SpawnCells(Layout, MazeGrid, FVector::ZeroVector);
+    StartCell = MazeGrid.IsValidIndex(Layout.StartIndex) ? MazeGrid[Layout.StartIndex] : nullptr;
+    ApplyElevation(Layout, MazeGrid, FVector::ZeroVector);
+    BuildDecoration();
+    MovePlayerToStart();
+    PlaceExitAndKey();
+    PlaceObjects();
+    ApplyColors(Layout, MazeGrid);
+    UpdateMinimap();
+    UpdateNavigation();
+    CheckMemoryBudget();
+}
+
+void AMazeGenerator::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    if (UMazeQuerySubsystem* Queries = GetWorld()->GetSubsystem<UMazeQuerySubsystem>())
+    {
+        Queries->UnregisterMaze(this);
+    }
+    Super::EndPlay(EndPlayReason);
+}
+
+//Validate default values and set them
+FMazeSettings AMazeGenerator::ValidateSettings()
+{
     if (ElevationRatioIn <= 0.f) {
         UE_LOG(LogTemp, Error, TEXT("Invalid ElevationRatio: %f, ElevationRatio was set to 8.f"), ElevationRatioIn);
         ElevationRatio = 8.f;
@@ -39,46 +186,78 @@ void AMazeGenerator::BeginPlay()
     {
         CellSize = CellSizeIn;
     }
-    if (MazeWidth <= 0) {
-        UE_LOG(LogTemp, Error, TEXT("Invalid MazeWidth: %d, MazeWidth was set to 5"), MazeWidth);
-        MazeWidth = 5;
-    }
-    if (MazeDepth <= 0) {
-        UE_LOG(LogTemp, Error, TEXT("Invalid MazeDepth: %d, MazeDepth was set to 5"), MazeDepth);
-        MazeDepth = 5;
-    }
-    if (VoronoidCellSize <= 0) {
-        UE_LOG(LogTemp, Error, TEXT("Invalid VoronoidCellSize: %d, VoronoidCellSize was set to 1"), VoronoidCellSize);
-        VoronoidCellSize = 1;
-    }
-    if (MazeWidth % VoronoidCellSize != 0 || MazeDepth % VoronoidCellSize != 0)
-    {
-        UE_LOG(LogTemp, Error, TEXT("Invalid VoronoidCellSize: %d, VoronoidCellSize was set to 1"), VoronoidCellSize);
-        UE_LOG(LogTemp, Error, TEXT("VoronoidCellSize must be divisible by maze width and depth"));
-        VoronoidCellSize = 1;
-    }
     if (PossibleColors.Num() == 0) {
         UE_LOG(LogTemp, Error, TEXT("Invalid number of Possible Colors: 0, Black was added to the array"));
         PossibleColors.Add(FColor::Black);
     }
+    if (Seed == 0)
+    {
+        Seed = FMath::Rand();
+    }
+
+    FMazeSettings Settings;
+    Settings.Width = MazeWidth;
+    Settings.Depth = MazeDepth;
+    Settings.Seed = Seed;
+    Settings.EllersMergeProb = EllersMergeProb;
+    Settings.BraidFactor = BraidFactor;
+    Settings.VoronoidCellSize = VoronoidCellSize;
+    Settings.NumColors = PossibleColors.Num();
+    Settings.ElevationSeed = ElevationSeed;
+    Settings.NumLayers = NumLayers;
+    Settings.Validate();
+
+    MazeWidth = Settings.Width;
+    MazeDepth = Settings.Depth;
+    VoronoidCellSize = Settings.VoronoidCellSize;
+    NumLayers = Settings.NumLayers;
+    BraidFactor = Settings.BraidFactor;
+    if (LayerHeight <= 0.f) {
+        UE_LOG(LogTemp, Error, TEXT("Invalid LayerHeight: %f, LayerHeight was set to 500.f"), LayerHeight);
+        LayerHeight = 500.f;
+    }
+    return Settings;
+}
 
-	MazeGrid.Init(nullptr, MazeWidth * MazeDepth);
-	VoronoidGridWidth = MazeWidth / VoronoidCellSize;
-    VoronoidGridDepth = MazeDepth / VoronoidCellSize;
-	VoronoidGrid.Init(nullptr, VoronoidGridWidth * VoronoidGridDepth);
+//Fills Layout, and Tower for mazes of more than one layer. A cached maze skips every algorithm
+void AMazeGenerator::GenerateLayouts(const FMazeSettings& Settings)
+{
+    LLM_SCOPE_BYTAG(Maze_Topology);
+    const FString CacheKey = bUseGenerationCache ? MazeCache::MakeKey(Settings) : FString();
+    if (!bUseGenerationCache || !MazeCache::Load(CacheKey, Settings, Tower))
+    {
+        if (Settings.NumLayers > 1)
+        {
+            MazeGeneration::BuildTower(Settings, Tower);
+        }
+        else
+        {
+            Tower = FMazeTower();
+            FMazePipelineTimings Timings;
+            MazeGeneration::BuildLayout(Settings, Tower.Layers.AddDefaulted_GetRef(), &Timings);
+            UE_LOG(LogTemp, Log, TEXT("MazeGeneration: %dx%d maze in %s"), Settings.Width, Settings.Depth, *Timings.ToString());
+        }
 
-	GenerateMaze();
+        if (bUseGenerationCache)
+        {
+            MazeCache::Store(CacheKey, Tower, (int64)GenerationCacheSizeMB * 1024 * 1024);
+        }
+    }
 
-	// Randomly select a start position
-	int32 StartX = FMath::RandRange(0, MazeWidth - 1);
-	// Set the start cell
-	StartCell = MazeGrid[StartX];
-	if (StartCell)
-	{   
-		StartCell->SetElevation(EElevation::None);
-		StartCell->GenerateMesh(0.f, EDirection::Right, StartCell->GetCellVerts(), CellSize);
-	}
+    //A flat maze does not keep a tower
+    if (Tower.NumLayers() > 1)
+    {
+        Layout = Tower.Layers[0];
+    }
+    else
+    {
+        Layout = MoveTemp(Tower.Layers[0]);
+        Tower = FMazeTower();
+    }
+}
 
+void AMazeGenerator::MovePlayerToStart()
+{
     // Move the player
     APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
     if (PlayerController)
@@ -87,314 +266,385 @@ void AMazeGenerator::BeginPlay()
         ACharacter* PlayerCharacter = Cast<ACharacter>(PlayerPawn);
         if (PlayerCharacter)
         {
-            PlayerCharacter->SetActorLocation(FVector((StartX + 0.5f) * CellSize, CellSize / 2, 15.f));
+            PlayerCharacter->SetActorLocation(FVector((Layout.Grid.GetX(Layout.StartIndex) + 0.5f) * CellSize, CellSize / 2, 15.f));
         }
     }
-	SetExitAndKey();
-    SetColorVoronoid();
 }
 
-//Generates Maze using Ellers algorithm for maze generation
-void AMazeGenerator::GenerateMaze()
+//Instantiates the Prefabs for each cell and breaks the walls of every open side of the layout
+void AMazeGenerator::SpawnCells(const FMazeLayout& CellsLayout, TArray<AMazeCell*>& Cells, const FVector& Offset)
 {
-    for (int32 Y = 0; Y < MazeDepth; Y++)
-    {
-        for (int32 X = 0; X < MazeWidth; X++)
-        {
-            int32 CellIndex = Y * MazeWidth + X;
-            if (!ensure(MazeGrid.IsValidIndex(CellIndex)))
-            {
-                UE_LOG(LogTemp, Error, TEXT("Invalid CellIndex: %d"), CellIndex);
-                continue;
-            }
-            //Instantiates the Prefabs and set for each cell in the row
-            if (MazeGrid.IsValidIndex(CellIndex) && MazeGrid[CellIndex] == nullptr)
-            {
-                FVector Location(X * CellSize, Y * CellSize, 0.f);
-                if (BPMazeCell) {
-                    AMazeCell* NewCell = GetWorld()->SpawnActor<AMazeCell>(BPMazeCell, Location, FRotator::ZeroRotator);
-                    NewCell->AttachToComponent(Root, FAttachmentTransformRules::KeepRelativeTransform);
-                    MazeGrid[CellIndex] = NewCell;
-                }
-                else
-                {
-                    UE_LOG(LogTemp, Error, TEXT("Invalid BPMazeCell"));
-                }
-                CellSets.Add(CellIndex, { CellIndex });
-            }
+    LLM_SCOPE_BYTAG(Maze_Geometry);
+    const FMazeGrid& Grid = CellsLayout.Grid;
+    Cells.Init(nullptr, Grid.Num());
 
-            //There is a probabily of joining different cells in different sets
-            //or if its the last row join the different cells in different sets to create perfect maze
-            if (X != 0 && (FMath::RandRange(0.f, 1.f) < EllersMergeProb || Y == MazeDepth - 1))
-            {
-                int32 CurrentSet = FindSet(CellIndex);
-                int32 RightSet = FindSet(CellIndex - 1);
-                if (CurrentSet != RightSet)
-                {
-                    AMazeCell* CurrentCell = MazeGrid[CellIndex];
-                    AMazeCell* RightCell = MazeGrid[CellIndex - 1];
-
-                    CurrentCell->BreakRightWall();
-                    RightCell->BreakLeftWall();
-                    CurrentCell->AddNeighbour(RightCell);
-					RightCell->AddNeighbour(CurrentCell);
+    if (!BPMazeCell)
+    {
+        UE_LOG(LogTemp, Error, TEXT("Invalid BPMazeCell"));
+        return;
+    }
 
-                    MergeSets(CurrentSet, RightSet);
-                }
-            }
-        }
+    for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+    {
+        SpawnCell(CellsLayout, Cells, CellIndex, Offset);
+    }
+}
 
-        if (Y == MazeDepth - 1)
+//Cells are spawned in index order, so only the -X and -Y sides are checked and every passage is connected once
+void AMazeGenerator::SpawnCell(const FMazeLayout& CellsLayout, TArray<AMazeCell*>& Cells, int32 CellIndex, const FVector& Offset)
+{
+    const FMazeGrid& Grid = CellsLayout.Grid;
+    FVector Location(Grid.GetX(CellIndex) * CellSize, Grid.GetY(CellIndex) * CellSize, 0.f);
+    AMazeCell* NewCell = GetWorld()->SpawnActor<AMazeCell>(BPMazeCell, Location + Offset, FRotator::ZeroRotator);
+    if (!NewCell)
+    {
+        return;
+    }
+    NewCell->AttachToComponent(Root, FAttachmentTransformRules::KeepRelativeTransform);
+    if (bUseMazeNavigation)
+    {
+        TInlineComponentArray<UPrimitiveComponent*> Primitives(NewCell);
+        for (UPrimitiveComponent* Primitive : Primitives)
         {
-            continue;
+            Primitive->SetCanEverAffectNavigation(false);
         }
+    }
+    Cells[CellIndex] = NewCell;
 
-        //For each set remaining join one random cell with the above row
-        for (const TPair<int32, TArray<int32>>& Set : CellSets)
+    for (EDirection Direction : { EDirection::Right, EDirection::Bottom })
+    {
+        const int32 Neighbour = Grid.GetNeighbourIndex(CellIndex, Direction);
+        AMazeCell* NextCell = Neighbour != INDEX_NONE ? Cells[Neighbour] : nullptr;
+        if (NextCell && Grid.IsOpen(CellIndex, Direction))
         {
-            int32 CurrentCellIndex = Set.Value[FMath::RandRange(0, Set.Value.Num() - 1)];
-            int32 AboveCellIndex = CurrentCellIndex + MazeWidth;
-            AMazeCell* CurrentCell = MazeGrid[CurrentCellIndex];
-
-            if (MazeGrid.IsValidIndex(AboveCellIndex) && MazeGrid[AboveCellIndex] == nullptr)
-            {
-                FVector Location(AboveCellIndex % MazeWidth * CellSize, AboveCellIndex / MazeWidth * CellSize, 0.f);
-                if (BPMazeCell) {
-                    AMazeCell* NewCell = GetWorld()->SpawnActor<AMazeCell>(BPMazeCell, Location, FRotator::ZeroRotator);
-                    NewCell->AttachToComponent(Root, FAttachmentTransformRules::KeepRelativeTransform);
-                    MazeGrid[AboveCellIndex] = NewCell;
-                }
-                else
-                {
-                    UE_LOG(LogTemp, Error, TEXT("Invalid BPMazeCell"));
-                }
-            }
-
-            AMazeCell* AboveCell = MazeGrid[AboveCellIndex];
-
-            CurrentCell->BreakTopWall();
-            AboveCell->BreakBottomWall();
-            CurrentCell->AddNeighbour(AboveCell);
-            AboveCell->AddNeighbour(CurrentCell);
-
-            CellSets[Set.Key].Empty();
-            CellSets[Set.Key].Add(AboveCellIndex);
+            NewCell->BreakWall(Direction);
+            NextCell->BreakWall(FMazeGrid::GetOpposite(Direction));
+            NewCell->AddNeighbour(NextCell);
+            NextCell->AddNeighbour(NewCell);
         }
-
-        
     }
 }
 
-//Functions used for the maze generation
-int32 AMazeGenerator::FindSet(int32 CellIndex)
+//Moves every cell to its solved height and builds its floor
+void AMazeGenerator::ApplyElevation(const FMazeLayout& CellsLayout, const TArray<AMazeCell*>& Cells, const FVector& Offset)
 {
-	for (const TPair<int32, TArray<int32>>& Entry : CellSets)
-	{
-		if (Entry.Value.Contains(CellIndex))
-		{
-			return Entry.Key;
-		}
-	}
+    LLM_SCOPE_BYTAG(Maze_Geometry);
+    const FMazeElevation& Elevation = CellsLayout.Elevation;
+    if (!Elevation.IsValid())
+    {
+        UE_LOG(LogTemp, Error, TEXT("Error in ApplyElevation() the elevation was not solved"));
+        return;
+    }
 
-	UE_LOG(LogTemp, Error, TEXT("FindSet() Error with cell at index: %d"), CellIndex);
-	return -1;
+    for (int32 CellIndex : Elevation.Order)
+    {
+        if (AMazeCell* Cell = Cells[CellIndex])
+        {
+            ApplyCellElevation(CellsLayout, Cell, CellIndex, Offset);
+        }
+    }
 }
 
-void AMazeGenerator::MergeSets(int32 SetFrom, int32 SetTo)
+void AMazeGenerator::ApplyCellElevation(const FMazeLayout& CellsLayout, AMazeCell* Cell, int32 CellIndex, const FVector& Offset)
 {
-	for (int32 CellIndex : CellSets[SetFrom])
-	{
-		CellSets[SetTo].Add(CellIndex);
-	}
+    const FMazeElevation& Elevation = CellsLayout.Elevation;
+    const float Scale = 1.f / ElevationRatio;
+    float Corners[4];
+    TConstArrayView<float> SolvedCorners = Elevation.GetCorners(CellIndex);
+    for (int32 I = 0; I < 4; I++)
+    {
+        Corners[I] = SolvedCorners[I] * Scale;
+    }
 
-	CellSets.Remove(SetFrom);
+    Cell->SetElevation(Elevation.Levels[CellIndex]);
+    Cell->SetActorRelativeLocation(GetCellLocation(CellsLayout, CellIndex) + Offset);
+    Cell->GenerateMesh(Corners, CellSize);
 }
 
-//Determines nextCells Elevation and generates its mesh
-//To generate some sense of terrain there is a 1/4 of probability staying the same elevation as the currentCell, 
-//if elevation is None then it changes slightly, if its already slightly
-//is has a probality of 1/3 to change back to None, if not it will change drastically
-//and if its already changed drastically it will go to a slight change
-void AMazeGenerator::GenerateCellMesh(AMazeCell* CurrentCell, AMazeCell* NextCell)
+//Follows the cells whose elevation was solved again: the spawned cells move and build their floor, a baked maze builds
+//again the floor chunks they overlap and moves their walls, the server collision builds again their wall lines and
+//floor bands, and the props on them follow. The rest of the maze is left as it is
+void AMazeGenerator::UpdateRegionElevation(TConstArrayView<int32> Cells)
 {
-    float Elevation;
-    EElevation CurrentElev = CurrentCell->GetElevation();
-
-    if (FMath::FRand() > 0.25f) {
-        switch (CurrentElev)
+    LLM_SCOPE_BYTAG(Maze_Geometry);
+    const FMazeGrid& Grid = Layout.Grid;
+    const int32 ChunkSize = FMath::Max(BakeChunkSize, 1);
+    if (ServerCollision)
+    {
+        const int32 NumLines = MazeCollision::GetNumWallLines(Grid);
+        TBitArray<> DirtyHulls(false, NumLines + FMath::DivideAndRoundUp(Grid.Depth, ChunkSize));
+        for (int32 Hull : DirtyServerHulls)
         {
-        case EElevation::MinusMax:
-            NextCell->SetElevation(EElevation::MinusMin);
-            break;
-        case EElevation::MinusMin:
-            if (FMath::FRand() < 1.f / 3.f)
-            {
-                NextCell->SetElevation(EElevation::None);
-            }
-            else
+            DirtyHulls[Hull] = true;
+        }
+        for (int32 CellIndex : Cells)
+        {
+            for (int32 Dir = 0; Dir < FMazeGrid::NumDirections; Dir++)
             {
-                NextCell->SetElevation(EElevation::MinusMax);
-                
+                const int32 Line = MazeCollision::GetWallLine(Grid, CellIndex, (EDirection)Dir);
+                if (!DirtyHulls[Line])
+                {
+                    DirtyHulls[Line] = true;
+                    DirtyServerHulls.Add(Line);
+                }
             }
-            break;
-        case EElevation::None:
-            if (FMath::FRand() < 0.5f)
+            const int32 Band = NumLines + Grid.GetY(CellIndex) / ChunkSize;
+            if (DirtyHulls.IsValidIndex(Band) && !DirtyHulls[Band])
             {
-                NextCell->SetElevation(EElevation::PlusMin);
-                
+                DirtyHulls[Band] = true;
+                DirtyServerHulls.Add(Band);
             }
-            else
+        }
+    }
+    else if (bBaked)
+    {
+        const int32 ChunksX = FMath::DivideAndRoundUp(Grid.Width, ChunkSize);
+        TBitArray<> DirtyChunks(false, BakedFloors.Num());
+        for (int32 CellIndex : Cells)
+        {
+            const int32 ChunkIndex = (Grid.GetY(CellIndex) / ChunkSize) * ChunksX + Grid.GetX(CellIndex) / ChunkSize;
+            if (DirtyChunks.IsValidIndex(ChunkIndex) && !DirtyChunks[ChunkIndex] && BakedFloors[ChunkIndex])
             {
-                NextCell->SetElevation(EElevation::MinusMin);
+                DirtyChunks[ChunkIndex] = true;
+                BuildFloorChunk(ChunkIndex % ChunksX * ChunkSize, ChunkIndex / ChunksX * ChunkSize, BakedFloors[ChunkIndex]);
             }
-            break;
-        case EElevation::PlusMin:
-            if (FMath::FRand() < 1.f / 3.f)
+
+            const FColor Color = Layout.GetCellColor(CellIndex, PossibleColors, AreaEVA, AreaPlant);
+            for (int32 Dir = 0; Dir < FMazeGrid::NumDirections; Dir++)
             {
-                NextCell->SetElevation(EElevation::None);
+                if (!Grid.IsOpen(CellIndex, (EDirection)Dir))
+                {
+                    SetBakedWallOpen(CellIndex, (EDirection)Dir, false, Color);
+                }
             }
-            else
+        }
+    }
+    else
+    {
+        for (int32 CellIndex : Cells)
+        {
+            if (MazeGrid.IsValidIndex(CellIndex) && MazeGrid[CellIndex])
             {
-                NextCell->SetElevation(EElevation::PlusMax);
-                
+                ApplyCellElevation(Layout, MazeGrid[CellIndex], CellIndex, FVector::ZeroVector);
             }
-            break;
-        case EElevation::PlusMax:
-            NextCell->SetElevation(EElevation::PlusMin);
-            break;
-        default:
-            Elevation = 0.f;
-            NextCell->SetElevation(CurrentElev);
-            UE_LOG(LogTemp, Error, TEXT("Error in GenerateCellMesh() switch CurrentElev"));
-            break;
         }
     }
-    else
+
+    if (NavigationData)
+    {
+        TArray<float> CellHeights;
+        CellHeights.Reserve(Cells.Num());
+        for (int32 CellIndex : Cells)
+        {
+            CellHeights.Add(GetCellLocation(CellIndex).Z);
+        }
+        NavigationData->SetCellHeights(Cells, CellHeights);
+    }
+    UpdateRegionProps(Cells);
+    PlaceExitAndKey();
+}
+
+//Scatters again the decoration chunks of the cells and moves the placed actors that stand on them, the props of the
+//other chunks and the other placed actors stay where they are
+void AMazeGenerator::UpdateRegionProps(TConstArrayView<int32> Cells)
+{
+    const FMazeGrid& Grid = Layout.Grid;
+    TBitArray<> Moved(false, Grid.Num());
+    for (int32 CellIndex : Cells)
+    {
+        Moved[CellIndex] = true;
+    }
+    for (int32 Placed = 0; Placed < PlacedActors.Num(); Placed++)
+    {
+        if (IsValid(PlacedActors[Placed]) && Moved[PlacedActorCells[Placed]])
+        {
+            PlacedActors[Placed]->SetActorLocation(GetCellWorldLocation(PlacedActorCells[Placed]));
+        }
+    }
+
+    if (DecorationThemes.Num() == 0 || DecorationComponents.Num() == 0)
+    {
+        return;
+    }
+
+    //A baked maze saved before the components were kept by chunk is scattered again whole
+    const int32 ChunkSize = FMath::Max(DecorationChunkSize, 1);
+    const int32 ChunksX = FMath::DivideAndRoundUp(Grid.Width, ChunkSize);
+    const int32 NumChunks = ChunksX * FMath::DivideAndRoundUp(Grid.Depth, ChunkSize);
+    if (DecorationComponents.Num() != NumChunks * MazeDecoration::GetNumPropTypes(DecorationThemes))
     {
-        NextCell->SetElevation(CurrentElev);
+        BuildDecoration();
+        return;
     }
 
-    switch (NextCell->GetElevation())
+    TBitArray<> DirtyChunks(false, NumChunks);
+    TArray<int32> ChunkIndices;
+    for (int32 CellIndex : Cells)
     {
-        case EElevation::PlusMax:
-            Elevation = 75.f + FMath::RandRange(-15.f, 10.f); 
-            break;
-        case EElevation::PlusMin:
-            Elevation = 25.f + FMath::RandRange(-10.f, 30.f);
-            break;
-        case EElevation::None:
-            Elevation = 0.f;
-            break;
-        case EElevation::MinusMin:
-            Elevation = -25.f + FMath::RandRange(-30.f, 10.f);
-            break;
-        case EElevation::MinusMax:
-            Elevation = -75.f + FMath::RandRange(-10.f, 15.f);
-            break;
-        default:
-            Elevation = 0.f;
-            UE_LOG(LogTemp, Error, TEXT("Error in GenerateCellMesh() switch Next Elevation"));
-            break;
+        const int32 ChunkIndex = (Grid.GetY(CellIndex) / ChunkSize) * ChunksX + Grid.GetX(CellIndex) / ChunkSize;
+        if (!DirtyChunks[ChunkIndex])
+        {
+            DirtyChunks[ChunkIndex] = true;
+            ChunkIndices.Add(ChunkIndex);
+        }
     }
 
-    FVector NewPosition = NextCell->GetActorLocation();
-    NewPosition.Z += CurrentCell->GetActorLocation().Z + Elevation / ElevationRatio;
-    NextCell->SetActorLocation(NewPosition);
-    NextCell->GenerateMesh(-Elevation / ElevationRatio, GetDirection(CurrentCell, NextCell), CurrentCell->GetCellVerts(), CellSize);
+    TArray<FMazeDecorationChunk> Chunks;
+    const int32 DecorationSeed = (int32)HashCombine(GetTypeHash(Seed), GetTypeHash(TEXT("Decoration")));
+    MazeDecoration::ScatterChunks(Layout, DecorationThemes, CellSize, 1.f / ElevationRatio, ChunkSize, DecorationSeed, ChunkIndices, Chunks);
+    SetDecorationChunks(ChunkIndices, Chunks);
 }
 
-EDirection AMazeGenerator::GetDirection(const AMazeCell* CurrentCell, const AMazeCell* NextCell)
+void AMazeGenerator::RefreshElevation(bool bNewSeed)
 {
-    FVector CurrentPosition = CurrentCell->GetActorLocation();
-    FVector NextPosition = NextCell->GetActorLocation();
-    FVector Difference = NextPosition - CurrentPosition;
+    if (!Layout.IsValid())
+    {
+        UE_LOG(LogTemp, Error, TEXT("Error in RefreshElevation() the maze was not generated"));
+        return;
+    }
+    if (Tower.NumLayers() > 1)
+    {
+        UE_LOG(LogTemp, Error, TEXT("Error in RefreshElevation() mazes with layers are not supported"));
+        return;
+    }
 
-    if (FMath::Abs(Difference.X) > FMath::Abs(Difference.Y))
+    if (ElevationRatioIn > 0.f)
+    {
+        ElevationRatio = ElevationRatioIn;
+    }
+    if (bNewSeed || !Layout.Elevation.IsValid())
+    {
+        ElevationSeed = FMath::Rand();
+        Layout.Elevation.Solve(Layout.Grid, Layout.StartIndex, ElevationSeed);
+    }
+    if (ServerCollision)
+    {
+        BuildServerCollision();
+    }
+    else if (bBaked)
     {
-        return Difference.X > 0 ? EDirection::Left : EDirection::Right;
+        BuildBakedGeometry();
     }
     else
     {
-        return Difference.Y > 0 ? EDirection::Top : EDirection::Bottom;
+        ApplyElevation(Layout, MazeGrid, FVector::ZeroVector);
+        BuildDecoration();
     }
+    PlaceExitAndKey();
+    PlaceObjects();
+    UpdateNavigation();
 }
 
-void AMazeGenerator::SetExitAndKey()
+int32 AMazeGenerator::GetCellDistance(int32 FromIndex, int32 ToIndex)
 {
-    
-    TPair<AMazeCell*, AMazeCell*> EndAndKey = PathSearch::GetExitAndKey(MazeGrid, StartCell);
-    AMazeCell* ExitCell = EndAndKey.Key;
-    AMazeCell* KeyCell = EndAndKey.Value;
-    if (ExitCell && KeyCell) {
-        if (Exit && Key) {
-            Exit->SetActorLocation(FVector(ExitCell->GetActorLocation().X + CellSize / 2, ExitCell->GetActorLocation().Y + CellSize / 2, ExitCell->GetActorLocation().Z + CellSize / 2));
-            Key->SetActorLocation(FVector(KeyCell->GetActorLocation().X + CellSize / 2, KeyCell->GetActorLocation().Y + CellSize / 2, KeyCell->GetActorLocation().Z + CellSize / 2));
-        }
-        else {
-            UE_LOG(LogTemp, Error, TEXT("Error in SetExitAndKey Exit and Key"));
-        }
+    if (!Layout.Grid.IsValidIndex(FromIndex) || !Layout.Grid.IsValidIndex(ToIndex))
+    {
+        UE_LOG(LogTemp, Error, TEXT("Invalid cells in GetCellDistance(): %d, %d"), FromIndex, ToIndex);
+        return INDEX_NONE;
     }
-    else 
+    return GetBitboard().GetDistance(FromIndex, ToIndex);
+}
+
+const FMazeBitboard& AMazeGenerator::GetBitboard()
+{
+    LLM_SCOPE_BYTAG(Maze_Topology);
+    if (!Bitboard.IsValid() && Layout.IsValid())
     {
-        if (!ExitCell) {
-            UE_LOG(LogTemp, Error, TEXT("End Cell: %f, %f"), ExitCell->GetActorLocation().X, ExitCell->GetActorLocation().Y);
-        }
-        if (!KeyCell) {
-            UE_LOG(LogTemp, Error, TEXT("Key Cell: %f, %f"), KeyCell->GetActorLocation().X, KeyCell->GetActorLocation().Y);
-        }
-        UE_LOG(LogTemp, Error, TEXT("Error in SetExitAndKey()"));
+        Bitboard.Build(Layout.Grid);
+    }
+    return Bitboard;
+}
+
+#if WITH_EDITOR
+void AMazeGenerator::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+    Super::PostEditChangeProperty(PropertyChangedEvent);
+
+    //Lets the ratio be previewed while playing in editor
+    if (PropertyChangedEvent.GetPropertyName() == GET_MEMBER_NAME_CHECKED(AMazeGenerator, ElevationRatioIn) && Layout.Elevation.IsValid())
+    {
+        RefreshElevation(false);
+    }
+}
+#endif
+
+//Location of a cell relative to the generator, including its solved height
+FVector AMazeGenerator::GetCellLocation(int32 CellIndex) const
+{
+    return GetCellLocation(Layout, CellIndex);
+}
+
+FVector AMazeGenerator::GetCellLocation(const FMazeLayout& CellsLayout, int32 CellIndex) const
+{
+    const float Height = CellsLayout.Elevation.IsValid() ? CellsLayout.Elevation.Heights[CellIndex] / ElevationRatio : 0.f;
+    return FVector(CellsLayout.Grid.GetX(CellIndex) * CellSize, CellsLayout.Grid.GetY(CellIndex) * CellSize, Height);
+}
+
+//In a tower the exit and the key are on the top layer
+void AMazeGenerator::PlaceExitAndKey()
+{
+    const bool bTower = Tower.NumLayers() > 1;
+    const FMazeLayout& ExitLayout = bTower ? Tower.Layers.Last() : Layout;
+    const FVector Offset = bTower ? GetLayerOffset(Tower.NumLayers() - 1) : FVector::ZeroVector;
+
+    if (Exit && Key && ExitLayout.Grid.IsValidIndex(ExitLayout.ExitIndex) && ExitLayout.Grid.IsValidIndex(ExitLayout.KeyIndex)) {
+        const FVector CellCenter(CellSize / 2, CellSize / 2, CellSize / 2);
+        Exit->SetActorLocation(GetActorTransform().TransformPosition(GetCellLocation(ExitLayout, ExitLayout.ExitIndex) + Offset + CellCenter));
+        Key->SetActorLocation(GetActorTransform().TransformPosition(GetCellLocation(ExitLayout, ExitLayout.KeyIndex) + Offset + CellCenter));
+    }
+    else {
+        UE_LOG(LogTemp, Error, TEXT("Error in PlaceExitAndKey() Exit: %d, Key: %d"), ExitLayout.ExitIndex, ExitLayout.KeyIndex);
     }
 }
 
-//A voronoid grid is used to create areas with different colors in the maze
-void  AMazeGenerator::SetColorVoronoid()
+//Spawns the objects of the placement rules on the floor of their cells, the objects of a previous placement are
+//destroyed first. Towers are not supported, their layers are spawned and destroyed while streaming
+void AMazeGenerator::PlaceObjects()
 {
-    TSet<AMazeCell*> voronoidPoints;
-    for (int I = 0; I < VoronoidGridDepth; I++)
+    for (AActor* Placed : PlacedActors)
     {
-        for (int J = 0; J < VoronoidGridWidth; J++)
+        if (IsValid(Placed))
         {
-            int Index = FMath::RandRange(I * VoronoidCellSize, (I + 1) * VoronoidCellSize - 1) * MazeWidth + FMath::RandRange(J * VoronoidCellSize, (J + 1) * VoronoidCellSize - 1);
-            int VoronoiIndex = I * VoronoidGridWidth + J;
-            if (MazeGrid.IsValidIndex(Index)) {
-                VoronoidGrid[VoronoiIndex] = MazeGrid[Index];
-                VoronoidGrid[VoronoiIndex]->SetWallsColor(PossibleColors[FMath::RandRange(0, PossibleColors.Num() - 1)]);
-                voronoidPoints.Add(VoronoidGrid[VoronoiIndex]);
-            }
-            else
-            {
-                UE_LOG(LogTemp, Error, TEXT("SetColorVoronoid MazeIndex Out of Bounds %d"), Index);
-            }
+            Placed->Destroy();
         }
     }
+    PlacedActors.Reset();
+    PlacedActorCells.Reset();
 
-    int XExit = FMath::RoundToInt(Exit->GetActorLocation().X - CellSize / 2) / CellSize;
-    int YExit = FMath::RoundToInt(Exit->GetActorLocation().Y - CellSize / 2) / CellSize;
-    int XKey = FMath::RoundToInt(Key->GetActorLocation().X - CellSize/2) / CellSize;
-    int YKey = FMath::RoundToInt(Key->GetActorLocation().Y - CellSize / 2) / CellSize;
-    AMazeCell* exitCell = MazeGrid[YExit * MazeWidth + XExit];
-    AMazeCell* keyCell = MazeGrid[YKey * MazeWidth + XKey];
-    exitCell->SetWallsColor(AreaEVA);
-    keyCell->SetWallsColor(AreaPlant);
-    PathSearch::GetClosestVoronoid(MazeGrid, exitCell, voronoidPoints)->SetWallsColor(AreaEVA);
-    PathSearch::GetClosestVoronoid(MazeGrid, keyCell, voronoidPoints)->SetWallsColor(AreaPlant);
+    if (PlacementRules.Num() == 0 || Tower.NumLayers() > 1)
+    {
+        return;
+    }
 
-    for (int Y = 0; Y < MazeDepth; Y++)
+    TArray<TArray<int32>> PlacedCells;
+    MazePlacement::Place(Layout, PlacementRules, PlacedCells);
+    for (int32 RuleIndex = 0; RuleIndex < PlacementRules.Num(); RuleIndex++)
     {
-        for (int X = 0; X < MazeWidth; X++)
+        const FMazePlacementRule& Rule = PlacementRules[RuleIndex];
+        if (!Rule.ActorClass)
         {
-            if ((X == XExit && Y == YExit) || (X == XKey && Y == YKey))
-            {
-                continue;
-            }
-            int32 VoronoidIndex = Y * VoronoidGridWidth + X;
-            int32 MazeIndex = Y * MazeWidth + X;
-            if (voronoidPoints.Contains(MazeGrid[Y * MazeWidth + X]))
+            UE_LOG(LogTemp, Error, TEXT("Error in PlaceObjects() rule %d has no actor class"), RuleIndex);
+            continue;
+        }
+        for (int32 CellIndex : PlacedCells[RuleIndex])
+        {
+            if (AActor* Placed = GetWorld()->SpawnActor<AActor>(Rule.ActorClass, GetCellWorldLocation(CellIndex), GetActorRotation()))
             {
-                continue;
+                PlacedActors.Add(Placed);
+                PlacedActorCells.Add(CellIndex);
             }
-            AMazeCell* NearestVor = PathSearch::GetClosestVoronoid(MazeGrid, MazeGrid[MazeIndex], voronoidPoints);
-            MazeGrid[MazeIndex]->SetWallsColor(NearestVor->Color);
+        }
+    }
+}
+
+//Colors the walls of every cell with the color of its voronoid region
+void AMazeGenerator::ApplyColors(const FMazeLayout& CellsLayout, const TArray<AMazeCell*>& Cells)
+{
+    for (int32 CellIndex = 0; CellIndex < Cells.Num(); CellIndex++)
+    {
+        if (Cells[CellIndex])
+        {
+            Cells[CellIndex]->SetWallsColor(CellsLayout.GetCellColor(CellIndex, PossibleColors, AreaEVA, AreaPlant));
         }
     }
 }
@@ -402,33 +652,1139 @@ void  AMazeGenerator::SetColorVoronoid()
 
 AMazeCell* AMazeGenerator::GetCellInDirection(AMazeCell* Cell, EDirection Direction)
 {
-    int32 X = Cell->GetActorLocation().X / CellSize;
-    int32 Y = Cell->GetActorLocation().Y / CellSize;
+    //The center of the cell is used so the rounding of its corner location never picks the cell beside it
+    const int32 CellIndex = GetCellAtLocation(Cell->GetActorTransform().TransformPosition(FVector(CellSize / 2, CellSize / 2, 0.f)));
+    const int32 NextIndex = CellIndex != INDEX_NONE ? Layout.Grid.GetNeighbourIndex(CellIndex, Direction) : INDEX_NONE;
+    if (MazeGrid.IsValidIndex(NextIndex)) {
+        return MazeGrid[NextIndex];
+    }
+    else {
+        return nullptr;
+    }
+}
 
-    switch (Direction)
+int32 AMazeGenerator::GetCellAtLocation(const FVector& WorldLocation) const
+{
+    const FVector Local = GetActorTransform().InverseTransformPosition(WorldLocation);
+    const int32 X = FMath::FloorToInt(Local.X / CellSize);
+    const int32 Y = FMath::FloorToInt(Local.Y / CellSize);
+    if (X < 0 || Y < 0 || X >= Layout.Grid.Width || Y >= Layout.Grid.Depth)
     {
-    case EDirection::Left:
-        X++;
-        break;
-    case EDirection::Right:
-        X--;
-        break;
-    case EDirection::Bottom:
-        Y--;
-        break;
-    case EDirection::Top:
-        Y++;
-        break;
+        return INDEX_NONE;
     }
-    int32 CellIndex = Y * MazeWidth + X;
-    if (MazeGrid.IsValidIndex(CellIndex)) {
-        return MazeGrid[CellIndex];
+    return Layout.Grid.GetIndex(X, Y);
+}
+
+FVector AMazeGenerator::GetCellWorldLocation(int32 CellIndex) const
+{
+    if (!Layout.Grid.IsValidIndex(CellIndex))
+    {
+        UE_LOG(LogTemp, Error, TEXT("Invalid cell in GetCellWorldLocation(): %d"), CellIndex);
+        return FVector::ZeroVector;
     }
-    else {
-        return nullptr;
+    return GetActorTransform().TransformPosition(GetCellLocation(CellIndex) + FVector(CellSize / 2, CellSize / 2, 0.f));
+}
+
+//Baked geometry replaces the MazeCell actors with one instanced component per wall mesh and color
+//and one floor mesh per chunk of cells
+void AMazeGenerator::BuildBakedGeometry()
+{
+    LLM_SCOPE_BYTAG(Maze_Geometry);
+    DestroyBakedGeometry();
+    BuildInstancedWalls();
+    BuildFloorChunks();
+    BuildDecoration();
+}
+
+void AMazeGenerator::BuildInstancedWalls()
+{
+    if (!BPMazeCell)
+    {
+        UE_LOG(LogTemp, Error, TEXT("Invalid BPMazeCell"));
+        return;
+    }
+
+    const FMazeGrid& Grid = Layout.Grid;
+    BakedWallInstances.Init(FIntPoint(INDEX_NONE, INDEX_NONE), Grid.Num() * FMazeGrid::NumDirections);
+
+    for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+    {
+        const FColor Color = Layout.GetCellColor(CellIndex, PossibleColors, AreaEVA, AreaPlant);
+        for (int32 Dir = 0; Dir < FMazeGrid::NumDirections; Dir++)
+        {
+            if (!Grid.IsOpen(CellIndex, (EDirection)Dir))
+            {
+                AddBakedWall(CellIndex, (EDirection)Dir, Color);
+            }
+        }
     }
 }
 
+//Adds the wall of one side of a cell to the instanced component of its mesh, material and color.
+//The walls are taken from the MazeCell blueprint so the baked maze looks the same as the spawned one
+void AMazeGenerator::AddBakedWall(int32 CellIndex, EDirection Direction, const FColor& Color)
+{
+    const UStaticMeshComponent* Wall = BPMazeCell ? BPMazeCell->GetDefaultObject<AMazeCell>()->GetWall(Direction) : nullptr;
+    if (!Wall || !Wall->GetStaticMesh())
+    {
+        return;
+    }
+
+    int32 ComponentIndex = INDEX_NONE;
+    for (int32 I = 0; I < BakedWalls.Num() && ComponentIndex == INDEX_NONE; I++)
+    {
+        const UMaterialInstanceDynamic* DynamicMaterial = Cast<UMaterialInstanceDynamic>(BakedWalls[I]->GetMaterial(0));
+        const UMaterialInterface* Material = DynamicMaterial ? DynamicMaterial->Parent.Get() : BakedWalls[I]->GetMaterial(0);
+        if (BakedWallColors[I] == Color && BakedWalls[I]->GetStaticMesh() == Wall->GetStaticMesh() && Material == Wall->GetMaterial(0))
+        {
+            ComponentIndex = I;
+        }
+    }
+
+    if (ComponentIndex == INDEX_NONE)
+    {
+        UInstancedStaticMeshComponent* Component = NewObject<UInstancedStaticMeshComponent>(this, NAME_None, RF_Transactional);
+        Component->SetStaticMesh(Wall->GetStaticMesh());
+        Component->SetCollisionProfileName(Wall->GetCollisionProfileName());
+        Component->SetCanEverAffectNavigation(!bUseMazeNavigation);
+        Component->SetupAttachment(Root);
+
+        {
+            LLM_SCOPE_BYTAG(Maze_Materials);
+            UMaterialInstanceDynamic* DynamicMaterial = UMaterialInstanceDynamic::Create(Wall->GetMaterial(0), Component);
+            if (DynamicMaterial)
+            {
+                DynamicMaterial->SetVectorParameterValue(TEXT("Color"), Color);
+                Component->SetMaterial(0, DynamicMaterial);
+            }
+        }
 
+        Component->RegisterComponent();
+        AddInstanceComponent(Component);
+        ComponentIndex = BakedWalls.Add(Component);
+        BakedWallColors.Add(Color);
+    }
 
+    const int32 Instance = BakedWalls[ComponentIndex]->AddInstance(GetBakedWallTransform(CellIndex, Wall));
+    BakedWallInstances[CellIndex * FMazeGrid::NumDirections + (int32)Direction] = FIntPoint(ComponentIndex, Instance);
+}
 
+//Instances are never removed so the stored indices stay valid, an open wall is scaled to zero and
+//a wall that changes color is hidden and added again to the component of the new color
+void AMazeGenerator::SetBakedWallOpen(int32 CellIndex, EDirection Direction, bool bOpen, const FColor& Color)
+{
+    const int32 SlotIndex = CellIndex * FMazeGrid::NumDirections + (int32)Direction;
+    if (!BakedWallInstances.IsValidIndex(SlotIndex))
+    {
+        return;
+    }
+
+    FIntPoint& Slot = BakedWallInstances[SlotIndex];
+    if (Slot.X != INDEX_NONE)
+    {
+        const bool bReuse = !bOpen && BakedWallColors[Slot.X] == Color;
+        const UStaticMeshComponent* Wall = BPMazeCell ? BPMazeCell->GetDefaultObject<AMazeCell>()->GetWall(Direction) : nullptr;
+        const FTransform Transform = bReuse && Wall ? GetBakedWallTransform(CellIndex, Wall) : FTransform(FQuat::Identity, GetCellLocation(CellIndex), FVector::ZeroVector);
+        BakedWalls[Slot.X]->UpdateInstanceTransform(Slot.Y, Transform, false, true, true);
+        if (bReuse || bOpen)
+        {
+            return;
+        }
+        Slot = FIntPoint(INDEX_NONE, INDEX_NONE);
+    }
+    if (!bOpen)
+    {
+        AddBakedWall(CellIndex, Direction, Color);
+    }
+}
+
+FTransform AMazeGenerator::GetBakedWallTransform(int32 CellIndex, const UStaticMeshComponent* Wall) const
+{
+    return Wall->GetRelativeTransform() * FTransform(GetCellLocation(CellIndex));
+}
+
+void AMazeGenerator::BuildFloorChunks()
+{
+    const AMazeCell* CellDefaults = BPMazeCell ? BPMazeCell->GetDefaultObject<AMazeCell>() : nullptr;
+    UMaterialInterface* FloorMaterial = CellDefaults ? CellDefaults->FloorMaterial : nullptr;
+
+    const FMazeGrid& Grid = Layout.Grid;
+    const int32 ChunkSize = FMath::Max(BakeChunkSize, 1);
+
+    for (int32 ChunkY = 0; ChunkY < Grid.Depth; ChunkY += ChunkSize)
+    {
+        for (int32 ChunkX = 0; ChunkX < Grid.Width; ChunkX += ChunkSize)
+        {
+            UProceduralMeshComponent* Floor = NewObject<UProceduralMeshComponent>(this, NAME_None, RF_Transactional);
+            Floor->SetCanEverAffectNavigation(!bUseMazeNavigation);
+            Floor->SetupAttachment(Root);
+            BuildFloorChunk(ChunkX, ChunkY, Floor);
+            if (FloorMaterial)
+            {
+                Floor->SetMaterial(0, FloorMaterial);
+            }
+            Floor->RegisterComponent();
+            AddInstanceComponent(Floor);
+            BakedFloors.Add(Floor);
+        }
+    }
+}
+
+//Builds the mesh section of the chunk whose first cell is at ChunkX, ChunkY, replacing the one it had
+void AMazeGenerator::BuildFloorChunk(int32 ChunkX, int32 ChunkY, UProceduralMeshComponent* Floor)
+{
+    const FMazeGrid& Grid = Layout.Grid;
+    const FMazeElevation& Elevation = Layout.Elevation;
+    const int32 ChunkSize = FMath::Max(BakeChunkSize, 1);
+    const float Scale = 1.f / ElevationRatio;
+    const int32 CellTris[] = { (int32)EVert::LeftTop, (int32)EVert::LeftBot, (int32)EVert::RightTop, (int32)EVert::RightTop, (int32)EVert::LeftBot, (int32)EVert::RightBot };
+
+    TArray<FVector> Vertices;
+    TArray<int32> Triangles;
+    TArray<FLinearColor> VertexColors;
+
+    for (int32 Y = ChunkY; Y < FMath::Min(ChunkY + ChunkSize, Grid.Depth); Y++)
+    {
+        for (int32 X = ChunkX; X < FMath::Min(ChunkX + ChunkSize, Grid.Width); X++)
+        {
+            const int32 CellIndex = Grid.GetIndex(X, Y);
+            const FVector Base = GetCellLocation(CellIndex);
+            float Corners[4] = { 0.f, 0.f, 0.f, 0.f };
+            if (Elevation.IsValid())
+            {
+                for (int32 I = 0; I < 4; I++)
+                {
+                    Corners[I] = Elevation.GetCorners(CellIndex)[I] * Scale;
+                }
+            }
+
+            //Same vertex layout as AMazeCell::GenerateMesh
+            const int32 FirstVertex = Vertices.Num();
+            Vertices.Add(Base + FVector(CellSize, 0.f, Corners[(int32)EVert::LeftBot]));
+            Vertices.Add(Base + FVector(0.f, 0.f, Corners[(int32)EVert::RightBot]));
+            Vertices.Add(Base + FVector(CellSize, CellSize, Corners[(int32)EVert::LeftTop]));
+            Vertices.Add(Base + FVector(0.f, CellSize, Corners[(int32)EVert::RightTop]));
+            for (int32 Vert : CellTris)
+            {
+                Triangles.Add(FirstVertex + Vert);
+            }
+        }
+    }
+
+    VertexColors.Init(FLinearColor::Gray, Vertices.Num());
+    Floor->CreateMeshSection_LinearColor(0, Vertices, Triangles, TArray<FVector>(), TArray<FVector2D>(), VertexColors, TArray<FProcMeshTangent>(), true);
+}
+
+bool AMazeGenerator::IsServerMaze() const
+{
+    return bServerCollisionOnly && NumLayers <= 1 && GetNetMode() == NM_DedicatedServer;
+}
+
+//The walls keep the boxes and the collision profile of the MazeCell blueprint. The floors are triangles like the floors
+//of the cells, on their own component with the collision profile of the floor of the blueprint and one mesh section per
+//band of rows
+void AMazeGenerator::BuildServerCollision()
+{
+    LLM_SCOPE_BYTAG(Maze_Collision);
+    DirtyServerHulls.Reset();
+    const AMazeCell* CellDefaults = BPMazeCell ? BPMazeCell->GetDefaultObject<AMazeCell>() : nullptr;
+    if (!CellDefaults)
+    {
+        UE_LOG(LogTemp, Error, TEXT("Invalid BPMazeCell"));
+        return;
+    }
+
+    FName ProfileName = UCollisionProfile::BlockAll_ProfileName;
+    ServerWallBoxes.Init(FBox(ForceInit), FMazeGrid::NumDirections);
+    for (int32 Dir = 0; Dir < FMazeGrid::NumDirections; Dir++)
+    {
+        const UStaticMeshComponent* Wall = CellDefaults->GetWall((EDirection)Dir);
+        if (Wall && Wall->GetStaticMesh() && Wall->GetCollisionEnabled() != ECollisionEnabled::NoCollision)
+        {
+            ServerWallBoxes[Dir] = Wall->GetStaticMesh()->GetBoundingBox().TransformBy(Wall->GetRelativeTransform());
+            ProfileName = Wall->GetCollisionProfileName();
+        }
+    }
+    const FName FloorProfileName = CellDefaults->Floor ? CellDefaults->Floor->GetCollisionProfileName() : UCollisionProfile::BlockAll_ProfileName;
+
+    const int32 NumLines = MazeCollision::GetNumWallLines(Layout.Grid);
+    const int32 NumBands = FMath::DivideAndRoundUp(Layout.Grid.Depth, FMath::Max(BakeChunkSize, 1));
+    ServerHulls.Reset(NumLines);
+    ServerHulls.SetNum(NumLines);
+    for (int32 Hull = 0; Hull < NumLines + NumBands; Hull++)
+    {
+        DirtyServerHulls.Add(Hull);
+    }
+
+    auto MakeCollision = [this](const TCHAR* Name, bool bComplex)
+        {
+            UProceduralMeshComponent* Component = NewObject<UProceduralMeshComponent>(this, Name);
+            Component->bUseComplexAsSimpleCollision = bComplex;
+            Component->SetCanEverAffectNavigation(!bUseMazeNavigation);
+            Component->SetupAttachment(Root);
+            Component->RegisterComponent();
+            AddInstanceComponent(Component);
+            return Component;
+        };
+    if (!ServerCollision)
+    {
+        ServerCollision = MakeCollision(TEXT("ServerCollision"), false);
+    }
+    if (!ServerFloorCollision)
+    {
+        ServerFloorCollision = MakeCollision(TEXT("ServerFloorCollision"), true);
+        ServerFloorCollision->SetVisibility(false);
+    }
+    ServerFloorCollision->ClearAllMeshSections();
+    ServerCollision->SetCollisionProfileName(ProfileName);
+    ServerFloorCollision->SetCollisionProfileName(FloorProfileName);
+    UpdateServerCollision();
+}
+
+//Builds again the lines of walls and the bands of floors that changed since the last update. The wall component gets all
+//the hulls again when a line changed and a changed band replaces its mesh section. Closing a wall can join the runs on
+//both sides of it, so the whole line of the wall is the part that is built again
+void AMazeGenerator::UpdateServerCollision()
+{
+    LLM_SCOPE_BYTAG(Maze_Collision);
+    const int32 NumLines = MazeCollision::GetNumWallLines(Layout.Grid);
+    const int32 BandSize = FMath::Max(BakeChunkSize, 1);
+    if (!ServerCollision || !ServerFloorCollision || ServerHulls.Num() != NumLines)
+    {
+        DirtyServerHulls.Reset();
+        return;
+    }
+
+    bool bWallsChanged = false;
+    TArray<FVector> Vertices;
+    TArray<int32> Triangles;
+    for (int32 Hull : DirtyServerHulls)
+    {
+        if (Hull < NumLines)
+        {
+            ServerHulls[Hull].Reset();
+            MazeCollision::BuildWallLine(Layout, CellSize, 1.f / ElevationRatio, ServerWallBoxes, Hull, ServerHulls[Hull]);
+            bWallsChanged = true;
+        }
+        else
+        {
+            const int32 Band = Hull - NumLines;
+            Vertices.Reset();
+            Triangles.Reset();
+            MazeCollision::BuildFloorMesh(Layout, CellSize, 1.f / ElevationRatio, Band * BandSize, (Band + 1) * BandSize, Vertices, Triangles);
+            ServerFloorCollision->CreateMeshSection(Band, Vertices, Triangles, TArray<FVector>(), TArray<FVector2D>(), TArray<FColor>(), TArray<FProcMeshTangent>(), true);
+        }
+    }
+    DirtyServerHulls.Reset();
+
+    if (bWallsChanged)
+    {
+        int32 NumHulls = 0;
+        for (const TArray<TArray<FVector>>& LineHulls : ServerHulls)
+        {
+            NumHulls += LineHulls.Num();
+        }
+        TArray<TArray<FVector>> Hulls;
+        Hulls.Reserve(NumHulls);
+        for (const TArray<TArray<FVector>>& LineHulls : ServerHulls)
+        {
+            Hulls.Append(LineHulls);
+        }
+        ServerCollision->SetCollisionConvexMeshes(Hulls);
+    }
+}
+
+void AMazeGenerator::DestroyBakedGeometry()
+{
+    for (UInstancedStaticMeshComponent* Component : BakedWalls)
+    {
+        if (Component)
+        {
+            Component->DestroyComponent();
+        }
+    }
+    for (UProceduralMeshComponent* Component : BakedFloors)
+    {
+        if (Component)
+        {
+            Component->DestroyComponent();
+        }
+    }
+    BakedWalls.Empty();
+    BakedWallColors.Empty();
+    BakedWallInstances.Empty();
+    BakedFloors.Empty();
+}
+
+//The props of every chunk are scattered in parallel on data, then each prop type with instances in a chunk gets one
+//instanced component. Every component only covers its chunk so its bounds are culled with the chunk
+void AMazeGenerator::BuildDecoration()
+{
+    LLM_SCOPE_BYTAG(Maze_Geometry);
+    DestroyDecoration();
+    if (DecorationThemes.Num() == 0 || !Layout.IsValid())
+    {
+        return;
+    }
+
+    TArray<FMazeDecorationChunk> Chunks;
+    const int32 DecorationSeed = (int32)HashCombine(GetTypeHash(Seed), GetTypeHash(TEXT("Decoration")));
+    MazeDecoration::Scatter(Layout, DecorationThemes, CellSize, 1.f / ElevationRatio, DecorationChunkSize, DecorationSeed, Chunks);
+
+    TArray<int32> ChunkIndices;
+    ChunkIndices.SetNumUninitialized(Chunks.Num());
+    for (int32 ChunkIndex = 0; ChunkIndex < Chunks.Num(); ChunkIndex++)
+    {
+        ChunkIndices[ChunkIndex] = ChunkIndex;
+    }
+    DecorationComponents.SetNumZeroed(Chunks.Num() * MazeDecoration::GetNumPropTypes(DecorationThemes));
+    SetDecorationChunks(ChunkIndices, Chunks);
+}
+
+//Gives the components of every chunk its new instances, a prop type that has none in the chunk anymore keeps an empty
+//component and one that had none gets a new component
+void AMazeGenerator::SetDecorationChunks(TConstArrayView<int32> ChunkIndices, TConstArrayView<FMazeDecorationChunk> Chunks)
+{
+    TArray<UStaticMesh*> PropMeshes;
+    for (const FMazeDecorationTheme& Theme : DecorationThemes)
+    {
+        for (const FMazePropType& PropType : Theme.Props)
+        {
+            PropMeshes.Add(PropType.Mesh);
+        }
+    }
+
+    for (int32 Index = 0; Index < Chunks.Num(); Index++)
+    {
+        const FMazeDecorationChunk& Chunk = Chunks[Index];
+        for (int32 PropType = 0; PropType < Chunk.Instances.Num(); PropType++)
+        {
+            UInstancedStaticMeshComponent*& Component = DecorationComponents[ChunkIndices[Index] * PropMeshes.Num() + PropType];
+            if (Component)
+            {
+                Component->ClearInstances();
+            }
+            if (Chunk.Instances[PropType].Num() == 0)
+            {
+                continue;
+            }
+
+            if (!Component)
+            {
+                Component = NewObject<UInstancedStaticMeshComponent>(this, NAME_None, RF_Transactional);
+                Component->SetStaticMesh(PropMeshes[PropType]);
+                Component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+                Component->SetCanEverAffectNavigation(false);
+                if (DecorationCullDistance > 0.f)
+                {
+                    Component->SetCullDistances(0, FMath::RoundToInt(DecorationCullDistance));
+                }
+                Component->SetupAttachment(Root);
+                Component->RegisterComponent();
+                AddInstanceComponent(Component);
+            }
+            Component->AddInstances(Chunk.Instances[PropType], false);
+        }
+    }
+}
+
+void AMazeGenerator::DestroyDecoration()
+{
+    for (UInstancedStaticMeshComponent* Component : DecorationComponents)
+    {
+        if (Component)
+        {
+            Component->DestroyComponent();
+        }
+    }
+    DecorationComponents.Empty();
+}
+
+#if WITH_EDITOR
+void AMazeGenerator::BakeMaze()
+{
+    if (!BPMazeCell)
+    {
+        UE_LOG(LogTemp, Error, TEXT("Invalid BPMazeCell, the maze was not baked"));
+        return;
+    }
+    if (NumLayers > 1)
+    {
+        UE_LOG(LogTemp, Error, TEXT("Mazes with layers are streamed at runtime, the maze was not baked"));
+        return;
+    }
+
+    Modify();
+    MazeGeneration::BuildLayout(ValidateSettings(), Layout);
+    ResetWallState();
+    BuildBakedGeometry();
+
+    if (Exit)
+    {
+        Exit->Modify();
+    }
+    if (Key)
+    {
+        Key->Modify();
+    }
+    PlaceExitAndKey();
+    bBaked = true;
+}
+
+void AMazeGenerator::ClearBakedMaze()
+{
+    Modify();
+    DestroyBakedGeometry();
+    DestroyDecoration();
+    Layout = FMazeLayout();
+    ResetWallState();
+    bBaked = false;
+}
+
+void AMazeGenerator::FindSeed()
+{
+    Modify();
+    FMazeSettings Settings = ValidateSettings();
+    //Wraps to the lowest seed after the highest one instead of overflowing
+    Settings.Seed = (int32)((uint32)Seed + 1u);
+
+    const double StartTime = FPlatformTime::Seconds();
+    TArray<FMazeSeedCandidate> Results;
+    MazeSeedSearch::FindBestSeeds(Settings, SeedConstraints, SeedSearchCandidates, 1, Results);
+    const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+    if (Results.Num() == 0)
+    {
+        UE_LOG(LogTemp, Error, TEXT("Error in FindSeed() none of the %d seeds after %d meets the constraints, searched in %.3f s"), SeedSearchCandidates, Seed, Seconds);
+        return;
+    }
+
+    const FMazeSeedCandidate& Best = Results[0];
+    Seed = Best.Seed;
+    UE_LOG(LogTemp, Display, TEXT("FindSeed() picked seed %d: solution %d, dead ends %.3f, key to exit %d. %d seeds searched in %.3f s"),
+        Best.Seed, Best.Metrics.SolutionLength, Best.Metrics.DeadEndRatio, Best.Metrics.KeyExitDistance, SeedSearchCandidates, Seconds);
+}
+
+void AMazeGenerator::SimulateAgents()
+{
+    FMazeLayout SimulatedLayout;
+    MazeGeneration::BuildLayout(ValidateSettings(), SimulatedLayout);
+
+    const double StartTime = FPlatformTime::Seconds();
+    FMazeSolveStats Stats;
+    MazeSimulation::Simulate(SimulatedLayout, SimulationSettings, Stats);
+    const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+    UE_LOG(LogTemp, Display, TEXT("SimulateAgents() seed %d: %d of %d agents solved the maze, steps mean %.1f, p10 %d, median %d, p90 %d, max %d. %lld steps in %.3f s"),
+        Seed, Stats.NumSolved, Stats.NumAgents, Stats.MeanSteps, Stats.P10Steps, Stats.MedianSteps, Stats.P90Steps, Stats.MaxSteps, Stats.SimulatedSteps, Seconds);
+}
+#endif
+
+void AMazeGenerator::SetWallOpen(int32 CellIndex, EDirection Direction, bool bOpen)
+{
+    FMazeGrid& Grid = Layout.Grid;
+    const int32 Neighbour = Grid.IsValidIndex(CellIndex) ? Grid.GetNeighbourIndex(CellIndex, Direction) : INDEX_NONE;
+    if (Neighbour == INDEX_NONE)
+    {
+        UE_LOG(LogTemp, Error, TEXT("Invalid wall in SetWallOpen(): %d"), CellIndex);
+        return;
+    }
+    if (Tower.NumLayers() > 1)
+    {
+        UE_LOG(LogTemp, Error, TEXT("Error in SetWallOpen() mazes with layers are not supported"));
+        return;
+    }
+    if (Grid.IsOpen(CellIndex, Direction) == bOpen)
+    {
+        return;
+    }
+
+    InitWallState();
+
+    if (bOpen)
+    {
+        Grid.OpenWall(CellIndex, Direction);
+    }
+    else
+    {
+        Grid.CloseWall(CellIndex, Direction);
+    }
+    Connectivity.OnWallChanged(Grid, CellIndex, Neighbour, bOpen);
+    OnWallChanged(CellIndex, Direction, bOpen);
+    ScheduleWallChanges();
+}
+
+void AMazeGenerator::RegenerateRegion(FIntPoint Min, FIntPoint Max, int32 RegionSeed)
+{
+    LLM_SCOPE_BYTAG(Maze_Topology);
+    FMazeGrid& Grid = Layout.Grid;
+    if (!Layout.IsValid())
+    {
+        UE_LOG(LogTemp, Error, TEXT("Error in RegenerateRegion() the maze was not generated"));
+        return;
+    }
+    if (Tower.NumLayers() > 1)
+    {
+        UE_LOG(LogTemp, Error, TEXT("Error in RegenerateRegion() mazes with layers are not supported"));
+        return;
+    }
+
+    //The tree of the start field only repairs the walls changed since it was last read
+    InitWallState();
+    if (Connectivity.GetComponentSize(Connectivity.GetComponent(Layout.StartIndex)) != Grid.Num())
+    {
+        UE_LOG(LogTemp, Error, TEXT("Error in RegenerateRegion() every cell has to be connected to the start"));
+        return;
+    }
+    StartField.Update(Grid);
+
+    TArray<TPair<int32, EDirection>> ChangedWalls;
+    if (!MazeGeneration::RegenerateRegion(Grid, StartField.Parents, FIntRect(Min, Max), RegionSeed, EllersMergeProb, ChangedWalls))
+    {
+        return;
+    }
+
+    //The floors follow the new cells before their walls are placed
+    TArray<int32> ElevatedCells;
+    if (Layout.Elevation.IsValid())
+    {
+        Layout.Elevation.SolveRegion(Grid, FIntRect(Min, Max), (int32)HashCombine(GetTypeHash(ElevationSeed), GetTypeHash(RegionSeed)), ElevatedCells);
+    }
+
+    //The maze is still one component so the connectivity does not change
+    for (const TPair<int32, EDirection>& Wall : ChangedWalls)
+    {
+        OnWallChanged(Wall.Key, Wall.Value, Grid.IsOpen(Wall.Key, Wall.Value));
+    }
+    if (ElevatedCells.Num() > 0)
+    {
+        UpdateRegionElevation(ElevatedCells);
+    }
+    ScheduleWallChanges();
+}
+
+//Everything that follows the grid after one of its walls changed but the connectivity
+void AMazeGenerator::OnWallChanged(int32 CellIndex, EDirection Direction, bool bOpen)
+{
+    const int32 Neighbour = Layout.Grid.GetNeighbourIndex(CellIndex, Direction);
+    if (Bitboard.IsValid())
+    {
+        Bitboard.SetWallOpen(CellIndex, Direction, bOpen);
+    }
+    StartField.OnWallChanged(CellIndex, Neighbour);
+    if (!ServerCollision)
+    {
+        RegionField.OnWallChanged(CellIndex, Neighbour);
+    }
+
+    const EDirection Opposite = FMazeGrid::GetOpposite(Direction);
+    if (ServerCollision)
+    {
+        DirtyServerHulls.AddUnique(MazeCollision::GetWallLine(Layout.Grid, CellIndex, Direction));
+    }
+    else if (bBaked)
+    {
+        SetBakedWallOpen(CellIndex, Direction, bOpen, Layout.GetCellColor(CellIndex, PossibleColors, AreaEVA, AreaPlant));
+        SetBakedWallOpen(Neighbour, Opposite, bOpen, Layout.GetCellColor(Neighbour, PossibleColors, AreaEVA, AreaPlant));
+    }
+    else if (MazeGrid.IsValidIndex(CellIndex) && MazeGrid[CellIndex] && MazeGrid[Neighbour])
+    {
+        AMazeCell* CurrentCell = MazeGrid[CellIndex];
+        AMazeCell* NextCell = MazeGrid[Neighbour];
+        if (bOpen)
+        {
+            CurrentCell->BreakWall(Direction);
+            NextCell->BreakWall(Opposite);
+            CurrentCell->AddNeighbour(NextCell);
+            NextCell->AddNeighbour(CurrentCell);
+        }
+        else
+        {
+            CurrentCell->RestoreWall(Direction);
+            NextCell->RestoreWall(Opposite);
+            CurrentCell->RemoveNeighbour(NextCell);
+            NextCell->RemoveNeighbour(CurrentCell);
+        }
+    }
+
+    if (UMazeMinimapSubsystem* Minimap = GetWorld() ? GetWorld()->GetSubsystem<UMazeMinimapSubsystem>() : nullptr)
+    {
+        Minimap->UpdateWall(Layout, CellIndex, Direction);
+    }
+    if (NavigationData)
+    {
+        NavigationData->SetWallOpen(CellIndex, Direction, bOpen);
+    }
+}
+
+void AMazeGenerator::ScheduleWallChanges()
+{
+    //Several doors toggled in the same frame are repaired together. The start field is only read here for the exit and
+    //the key, otherwise its changes wait for the next query. The regions are only colors, so servers do not follow them
+    const bool bNeedsUpdate = DirtyServerHulls.Num() > 0 || (!ServerCollision && RegionField.NeedsUpdate())
+        || (bUpdateExitAndKeyOnWallChange && StartField.NeedsUpdate());
+    if (bNeedsUpdate && !bWallChangesPending && GetWorld())
+    {
+        bWallChangesPending = true;
+        GetWorldTimerManager().SetTimerForNextTick(this, &AMazeGenerator::ApplyWallChanges);
+    }
+}
+
+bool AMazeGenerator::IsWallOpen(int32 CellIndex, EDirection Direction) const
+{
+    return Layout.Grid.IsValidIndex(CellIndex) && Layout.Grid.IsOpen(CellIndex, Direction);
+}
+
+bool AMazeGenerator::AreCellsConnected(int32 A, int32 B)
+{
+    if (!Layout.Grid.IsValidIndex(A) || !Layout.Grid.IsValidIndex(B))
+    {
+        UE_LOG(LogTemp, Error, TEXT("Invalid cells in AreCellsConnected(): %d, %d"), A, B);
+        return false;
+    }
+    InitWallState();
+    return Connectivity.AreConnected(A, B);
+}
+
+int32 AMazeGenerator::GetDistanceFromStart(int32 CellIndex)
+{
+    if (!Layout.Grid.IsValidIndex(CellIndex))
+    {
+        UE_LOG(LogTemp, Error, TEXT("Invalid cell in GetDistanceFromStart(): %d"), CellIndex);
+        return INDEX_NONE;
+    }
+    InitWallState();
+    StartField.Update(Layout.Grid);
+    return StartField.Distances[CellIndex];
+}
+
+//The first change or query pays for one full search, every change after that is checked against the stored results
+void AMazeGenerator::InitWallState()
+{
+    LLM_SCOPE_BYTAG(Maze_Search);
+    if (Connectivity.IsValid() || !Layout.IsValid())
+    {
+        return;
+    }
+    Connectivity.Build(Layout.Grid);
+    StartField.SetSources(MakeArrayView(&Layout.StartIndex, 1));
+    StartField.Update(Layout.Grid);
+    if (!ServerCollision)
+    {
+        RegionField.SetSources(Layout.VoronoidPoints);
+        RegionField.Update(Layout.Grid);
+    }
+}
+
+void AMazeGenerator::ResetWallState()
+{
+    Bitboard = FMazeBitboard();
+    Connectivity = FMazeConnectivity();
+    StartField = FMazeDistanceField();
+    RegionField = FMazeDistanceField();
+}
+
+//Repairs the regions and the exit and key after the wall changes of the frame and recolors only the cells whose
+//region changed, on the cells and on the minimap
+void AMazeGenerator::ApplyWallChanges()
+{
+    LLM_SCOPE_BYTAG(Maze_Search);
+    bWallChangesPending = false;
+
+    if (DirtyServerHulls.Num() > 0)
+    {
+        UpdateServerCollision();
+    }
+
+    TArray<int32> RecolorCells;
+    if (!ServerCollision && RegionField.Update(Layout.Grid))
+    {
+        if (Layout.Regions.Num() != Layout.Grid.Num())
+        {
+            Layout.Regions.Init(INDEX_NONE, Layout.Grid.Num());
+        }
+        for (int32 CellIndex : RegionField.ChangedCells)
+        {
+            if (Layout.Regions[CellIndex] != RegionField.Labels[CellIndex])
+            {
+                Layout.Regions[CellIndex] = RegionField.Labels[CellIndex];
+                RecolorCells.Add(CellIndex);
+            }
+        }
+    }
+
+    //The exit is the farthest cell, so moving it is a full search anyway
+    if (bUpdateExitAndKeyOnWallChange && StartField.Update(Layout.Grid))
+    {
+        const TPair<int32, int32> ExitAndKey = PathSearch::GetExitAndKey(Layout.Grid, Layout.StartIndex);
+        if (ExitAndKey.Key != Layout.ExitIndex || ExitAndKey.Value != Layout.KeyIndex)
+        {
+            RecolorCells.Add(Layout.ExitIndex);
+            RecolorCells.Add(Layout.KeyIndex);
+            Layout.ExitIndex = ExitAndKey.Key;
+            Layout.KeyIndex = ExitAndKey.Value;
+            RecolorCells.Add(Layout.ExitIndex);
+            RecolorCells.Add(Layout.KeyIndex);
+            PlaceExitAndKey();
+        }
+    }
+
+    //A new exit or key region changes the color of every cell of the old and the new region
+    const int32 OldExitRegion = Layout.ExitRegion;
+    const int32 OldKeyRegion = Layout.KeyRegion;
+    Layout.UpdateExitAndKeyRegions();
+    if (ServerCollision)
+    {
+        return;
+    }
+    if (Layout.ExitRegion != OldExitRegion || Layout.KeyRegion != OldKeyRegion)
+    {
+        for (int32 CellIndex = 0; CellIndex < Layout.Grid.Num(); CellIndex++)
+        {
+            UpdateCellColor(CellIndex);
+        }
+        UpdateMinimap();
+        return;
+    }
+
+    RecolorCells.RemoveAll([this](int32 CellIndex) { return !Layout.Grid.IsValidIndex(CellIndex); });
+    if (RecolorCells.Num() == 0)
+    {
+        return;
+    }
+    for (int32 CellIndex : RecolorCells)
+    {
+        UpdateCellColor(CellIndex);
+    }
+    if (UMazeMinimapSubsystem* Minimap = GetWorld() ? GetWorld()->GetSubsystem<UMazeMinimapSubsystem>() : nullptr)
+    {
+        Minimap->UpdateCells(Layout, RecolorCells);
+    }
+}
+
+void AMazeGenerator::UpdateCellColor(int32 CellIndex)
+{
+    const FColor Color = Layout.GetCellColor(CellIndex, PossibleColors, AreaEVA, AreaPlant);
+    if (bBaked && BakedWallInstances.Num() == Layout.Grid.Num() * FMazeGrid::NumDirections)
+    {
+        for (int32 Dir = 0; Dir < FMazeGrid::NumDirections; Dir++)
+        {
+            const FIntPoint& Slot = BakedWallInstances[CellIndex * FMazeGrid::NumDirections + Dir];
+            if (!Layout.Grid.IsOpen(CellIndex, (EDirection)Dir) && Slot.X != INDEX_NONE && BakedWallColors[Slot.X] != Color)
+            {
+                SetBakedWallOpen(CellIndex, (EDirection)Dir, false, Color);
+            }
+        }
+    }
+    else if (MazeGrid.IsValidIndex(CellIndex) && MazeGrid[CellIndex] && MazeGrid[CellIndex]->Color != Color)
+    {
+        MazeGrid[CellIndex]->SetWallsColor(Color);
+    }
+}
+
+FVector AMazeGenerator::GetLayerOffset(int32 Layer) const
+{
+    return FVector(0.f, 0.f, Layer * LayerHeight);
+}
+
+//Picks the layers next to the player to be spawned and the others to be destroyed, the player is on the layer closest
+//to its height. The cells themselves are spawned and destroyed over the next frames
+void AMazeGenerator::UpdateStreamedLayers()
+{
+    APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+    const APawn* PlayerPawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+    if (PlayerPawn)
+    {
+        const float Height = GetActorTransform().InverseTransformPosition(PlayerPawn->GetActorLocation()).Z;
+        CurrentLayer = FMath::Clamp(FMath::RoundToInt(Height / LayerHeight), 0, Tower.NumLayers() - 1);
+    }
+
+    for (int32 Layer = 0; Layer < Tower.NumLayers(); Layer++)
+    {
+        LayerActors[Layer].bStreamed = FMath::Abs(Layer - CurrentLayer) <= StreamedLayerRadius;
+    }
+    if (!bLayerCellsPending)
+    {
+        StreamLayerCells();
+    }
+}
+
+void AMazeGenerator::StreamLayerCells()
+{
+    bLayerCellsPending = false;
+    UpdateLayerCells(FMath::Max(LayerCellsPerFrame, 1));
+}
+
+//Spawns or destroys at most MaxCells cells, the layer of the player first and then the closest ones, and waits for the
+//next frame if there is more to do
+void AMazeGenerator::UpdateLayerCells(int32 MaxCells)
+{
+    int32 Budget = MaxCells;
+    bool bSpawned = false;
+    bool bDone = true;
+    for (int32 Distance = 0; Distance < Tower.NumLayers(); Distance++)
+    {
+        for (int32 Side = 0; Side < (Distance > 0 ? 2 : 1); Side++)
+        {
+            const int32 Layer = Side == 0 ? CurrentLayer - Distance : CurrentLayer + Distance;
+            if (!LayerActors.IsValidIndex(Layer))
+            {
+                continue;
+            }
+
+            const FMazeLayerActors& Actors = LayerActors[Layer];
+            const bool bSpawn = Actors.bStreamed && Actors.NumSpawned < Tower.Layers[Layer].Grid.Num();
+            const bool bDestroy = !Actors.bStreamed && Actors.Cells.Num() > 0;
+            if (!bSpawn && !bDestroy)
+            {
+                continue;
+            }
+            if (Budget <= 0)
+            {
+                bDone = false;
+            }
+            else if (bSpawn)
+            {
+                const bool bLayerDone = SpawnLayerCells(Layer, Budget);
+                bSpawned |= bLayerDone;
+                bDone &= bLayerDone;
+            }
+            else
+            {
+                bDone &= DestroyLayerCells(Layer, Budget);
+            }
+        }
+    }
+
+    if (bSpawned)
+    {
+        CheckMemoryBudget();
+    }
+    if (!bDone && !bLayerCellsPending)
+    {
+        bLayerCellsPending = true;
+        GetWorldTimerManager().SetTimerForNextTick(this, &AMazeGenerator::StreamLayerCells);
+    }
+}
+
+//Spawns the next cells of a layer within the budget and returns true once the whole layer is spawned. Stairs go up from
+//the exit of every layer but the top one and the floor above them is left open
+bool AMazeGenerator::SpawnLayerCells(int32 Layer, int32& InOutBudget)
+{
+    LLM_SCOPE_BYTAG(Maze_Geometry);
+    const FMazeLayout& LayerLayout = Tower.Layers[Layer];
+    FMazeLayerActors& Actors = LayerActors[Layer];
+    const FVector Offset = GetLayerOffset(Layer);
+    const int32 NumCells = LayerLayout.Grid.Num();
+
+    if (Actors.Cells.Num() != NumCells)
+    {
+        Actors.Cells.Init(nullptr, NumCells);
+        Actors.NumSpawned = 0;
+    }
+    if (!BPMazeCell)
+    {
+        UE_LOG(LogTemp, Error, TEXT("Invalid BPMazeCell"));
+        Actors.NumSpawned = NumCells;
+        return true;
+    }
+
+    const int32 End = FMath::Min(Actors.NumSpawned + InOutBudget, NumCells);
+    for (int32 CellIndex = Actors.NumSpawned; CellIndex < End; CellIndex++)
+    {
+        SpawnCell(LayerLayout, Actors.Cells, CellIndex, Offset);
+        if (AMazeCell* Cell = Actors.Cells[CellIndex])
+        {
+            if (LayerLayout.Elevation.IsValid())
+            {
+                ApplyCellElevation(LayerLayout, Cell, CellIndex, Offset);
+            }
+            Cell->SetWallsColor(LayerLayout.GetCellColor(CellIndex, PossibleColors, AreaEVA, AreaPlant));
+        }
+    }
+    InOutBudget -= End - Actors.NumSpawned;
+    Actors.NumSpawned = End;
+    if (End < NumCells)
+    {
+        return false;
+    }
+
+    if (Layer + 1 < Tower.NumLayers() && BPStairs && !IsValid(Actors.Stairs))
+    {
+        const int32 StairsIndex = Tower.Links[Layer];
+        Actors.Stairs = GetWorld()->SpawnActor<AActor>(BPStairs, GetCellLocation(LayerLayout, StairsIndex) + Offset, FRotator::ZeroRotator);
+        if (Actors.Stairs)
+        {
+            Actors.Stairs->AttachToComponent(Root, FAttachmentTransformRules::KeepRelativeTransform);
+        }
+    }
+
+    if (Layer > 0 && Actors.Cells.IsValidIndex(Tower.Links[Layer - 1]))
+    {
+        AMazeCell* Landing = Actors.Cells[Tower.Links[Layer - 1]];
+        if (IsValid(Landing) && Landing->Floor)
+        {
+            Landing->Floor->SetVisibility(false);
+            Landing->Floor->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+        }
+    }
+    return true;
+}
+
+//Destroys the last spawned cells of a layer within the budget and returns true once the whole layer is gone
+bool AMazeGenerator::DestroyLayerCells(int32 Layer, int32& InOutBudget)
+{
+    FMazeLayerActors& Actors = LayerActors[Layer];
+    if (IsValid(Actors.Stairs))
+    {
+        Actors.Stairs->Destroy();
+    }
+    Actors.Stairs = nullptr;
+
+    const int32 End = FMath::Max(Actors.NumSpawned - InOutBudget, 0);
+    for (int32 CellIndex = Actors.NumSpawned - 1; CellIndex >= End; CellIndex--)
+    {
+        if (IsValid(Actors.Cells[CellIndex]))
+        {
+            Actors.Cells[CellIndex]->Destroy();
+        }
+        Actors.Cells[CellIndex] = nullptr;
+    }
+    InOutBudget -= Actors.NumSpawned - End;
+    Actors.NumSpawned = End;
+    if (End > 0)
+    {
+        return false;
+    }
+    Actors.Cells.Empty();
+    return true;
+}
+
+//The minimap shows the ground layer, it is drawn on a worker from the layout
+void AMazeGenerator::UpdateMinimap()
+{
+    if (UMazeMinimapSubsystem* Minimap = GetWorld() ? GetWorld()->GetSubsystem<UMazeMinimapSubsystem>() : nullptr)
+    {
+        Minimap->BuildMinimap(Layout, PossibleColors, AreaEVA, AreaPlant, GetActorTransform(), CellSize);
+    }
+}
+
+//The navigation data of the level is reused if there is one, otherwise it is spawned with the configuration of the
+//supported agent that uses it so the navigation system registers it
+void AMazeGenerator::UpdateNavigation()
+{
+    LLM_SCOPE_BYTAG(Maze_Search);
+    UWorld* World = GetWorld();
+    if (!bUseMazeNavigation || !World || !Layout.IsValid())
+    {
+        return;
+    }
+
+    if (!NavigationData)
+    {
+        TActorIterator<AMazeNavigationData> It(World);
+        NavigationData = It ? *It : nullptr;
+    }
+    if (!NavigationData)
+    {
+        const UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World);
+        const FNavDataConfig* AgentConfig = nullptr;
+        if (NavSys)
+        {
+            for (const FNavDataConfig& Agent : NavSys->GetSupportedAgents())
+            {
+                if (Agent.GetNavDataClass<ANavigationData>() == AMazeNavigationData::StaticClass())
+                {
+                    AgentConfig = &Agent;
+                    break;
+                }
+            }
+        }
+        if (!AgentConfig)
+        {
+            UE_LOG(LogTemp, Error, TEXT("Error in UpdateNavigation() no supported agent uses MazeNavigationData, agents will not find paths in the maze"));
+            return;
+        }
+
+        NavigationData = World->SpawnActorDeferred<AMazeNavigationData>(AMazeNavigationData::StaticClass(), FTransform::Identity);
+        NavigationData->SetConfig(*AgentConfig);
+        NavigationData->FinishSpawning(FTransform::Identity);
+    }
+
+    TArray<float> CellHeights;
+    CellHeights.SetNumUninitialized(Layout.Grid.Num());
+    for (int32 CellIndex = 0; CellIndex < Layout.Grid.Num(); CellIndex++)
+    {
+        CellHeights[CellIndex] = GetCellLocation(CellIndex).Z;
+    }
+    NavigationData->SetMaze(Layout.Grid, CellHeights, GetActorTransform(), CellSize);
+}
+
+//Everything is counted once: the data by its arrays, the generator without its properties since the layout is one
+//of them, and every cell actor and component with the objects they own
+void AMazeGenerator::GetMemoryStats(FMazeMemoryStats& OutStats) const
+{
+    OutStats = FMazeMemoryStats();
+    OutStats.NumCells = Layout.Grid.Num();
+    for (int32 Layer = 1; Layer < Tower.NumLayers(); Layer++)
+    {
+        OutStats.NumCells += Tower.Layers[Layer].Grid.Num();
+    }
+
+    OutStats.Topology += Layout.GetAllocatedSize() + Tower.GetAllocatedSize() + Bitboard.GetAllocatedSize();
+    OutStats.Search += Connectivity.GetAllocatedSize() + StartField.GetAllocatedSize() + RegionField.GetAllocatedSize();
+    if (NavigationData)
+    {
+        OutStats.Search += MazeMemory::GetObjectBytes(NavigationData) + NavigationData->GetAllocatedSize();
+        OutStats.NumObjects++;
+    }
+
+    OutStats.Geometry += GetClass()->GetStructureSize() + MazeGrid.GetAllocatedSize() + BakedWallColors.GetAllocatedSize() + BakedWallInstances.GetAllocatedSize();
+    OutStats.NumObjects++;
+    TInlineComponentArray<UActorComponent*> Components(this);
+    for (UActorComponent* Component : Components)
+    {
+        MazeMemory::AddComponent(Component, OutStats, Component == ServerCollision || Component == ServerFloorCollision);
+    }
+    OutStats.Collision += ServerHulls.GetAllocatedSize() + ServerWallBoxes.GetAllocatedSize() + DirtyServerHulls.GetAllocatedSize();
+    for (const TArray<TArray<FVector>>& LineHulls : ServerHulls)
+    {
+        OutStats.Collision += LineHulls.GetAllocatedSize();
+        for (const TArray<FVector>& Hull : LineHulls)
+        {
+            OutStats.Collision += Hull.GetAllocatedSize();
+        }
+    }
+
+    auto AddCells = [&OutStats](const TArray<AMazeCell*>& Cells)
+        {
+            for (AMazeCell* Cell : Cells)
+            {
+                if (IsValid(Cell))
+                {
+                    MazeMemory::AddActor(Cell, OutStats);
+                    OutStats.Topology += Cell->GetAllocatedSize();
+                }
+            }
+        };
+    AddCells(MazeGrid);
+    for (const FMazeLayerActors& Actors : LayerActors)
+    {
+        AddCells(Actors.Cells);
+    }
+}
+
+void AMazeGenerator::CheckMemoryBudget() const
+{
+    if (MemoryBudgetMB <= 0)
+    {
+        return;
+    }
+
+    FMazeMemoryStats Stats;
+    GetMemoryStats(Stats);
+    if (Stats.GetTotal() > (int64)MemoryBudgetMB * 1024 * 1024)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("%s is over its memory budget of %d MB: %s"), *GetName(), MemoryBudgetMB, *Stats.ToString());
+    }
+}
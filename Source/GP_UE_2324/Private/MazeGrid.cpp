@@ -0,0 +1,143 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeGrid.h"
+
+void FMazeGrid::Init(int32 InWidth, int32 InDepth)
+{
+    Width = InWidth;
+    Depth = InDepth;
+    Cells.Init(0, Width * Depth);
+}
+
+EDirection FMazeGrid::GetOpposite(EDirection Direction)
+{
+    switch (Direction)
+    {
+    case EDirection::Left:
+        return EDirection::Right;
+    case EDirection::Right:
+        return EDirection::Left;
+    case EDirection::Bottom:
+        return EDirection::Top;
+    default:
+        return EDirection::Bottom;
+    }
+}
+
+//Returns INDEX_NONE when the neighbour would be outside of the grid
+int32 FMazeGrid::GetNeighbourIndex(int32 Index, EDirection Direction) const
+{
+    const int32 X = GetX(Index);
+    const int32 Y = GetY(Index);
+
+    switch (Direction)
+    {
+    case EDirection::Left:
+        return X + 1 < Width ? Index + 1 : INDEX_NONE;
+    case EDirection::Right:
+        return X > 0 ? Index - 1 : INDEX_NONE;
+    case EDirection::Bottom:
+        return Y > 0 ? Index - Width : INDEX_NONE;
+    case EDirection::Top:
+        return Y + 1 < Depth ? Index + Width : INDEX_NONE;
+    default:
+        return INDEX_NONE;
+    }
+}
+
+void FMazeGrid::OpenWall(int32 Index, EDirection Direction)
+{
+    const int32 Neighbour = GetNeighbourIndex(Index, Direction);
+    if (!IsValidIndex(Index) || Neighbour == INDEX_NONE)
+    {
+        UE_LOG(LogTemp, Error, TEXT("FMazeGrid::OpenWall invalid wall at index: %d"), Index);
+        return;
+    }
+    Cells[Index] |= GetMask(Direction);
+    Cells[Neighbour] |= GetMask(GetOpposite(Direction));
+}
+
+void FMazeGrid::CloseWall(int32 Index, EDirection Direction)
+{
+    const int32 Neighbour = GetNeighbourIndex(Index, Direction);
+    if (!IsValidIndex(Index) || Neighbour == INDEX_NONE)
+    {
+        UE_LOG(LogTemp, Error, TEXT("FMazeGrid::CloseWall invalid wall at index: %d"), Index);
+        return;
+    }
+    Cells[Index] &= ~GetMask(Direction);
+    Cells[Neighbour] &= ~GetMask(GetOpposite(Direction));
+}
+
+//Grid DDA: the segment is followed one cell boundary at a time, always crossing the closest boundary next,
+//and only the wall bit of the side it crosses is read
+bool FMazeGrid::HasLineOfSight(const FVector2D& From, const FVector2D& To) const
+{
+    int32 X = FMath::FloorToInt(From.X);
+    int32 Y = FMath::FloorToInt(From.Y);
+    const int32 EndX = FMath::FloorToInt(To.X);
+    const int32 EndY = FMath::FloorToInt(To.Y);
+    if (X < 0 || Y < 0 || X >= Width || Y >= Depth || EndX < 0 || EndY < 0 || EndX >= Width || EndY >= Depth)
+    {
+        return false;
+    }
+
+    const double DeltaX = To.X - From.X;
+    const double DeltaY = To.Y - From.Y;
+    const int32 StepX = DeltaX > 0.0 ? 1 : -1;
+    const int32 StepY = DeltaY > 0.0 ? 1 : -1;
+    const EDirection DirectionX = StepX > 0 ? EDirection::Left : EDirection::Right;
+    const EDirection DirectionY = StepY > 0 ? EDirection::Top : EDirection::Bottom;
+
+    //Distance along the segment, from 0 to 1, to cross one whole cell and to reach the next boundary on each axis
+    const double CellX = DeltaX != 0.0 ? FMath::Abs(1.0 / DeltaX) : TNumericLimits<double>::Max();
+    const double CellY = DeltaY != 0.0 ? FMath::Abs(1.0 / DeltaY) : TNumericLimits<double>::Max();
+    double NextX = DeltaX != 0.0 ? (StepX > 0 ? X + 1 - From.X : From.X - X) * CellX : TNumericLimits<double>::Max();
+    double NextY = DeltaY != 0.0 ? (StepY > 0 ? Y + 1 - From.Y : From.Y - Y) * CellY : TNumericLimits<double>::Max();
+
+    int32 Index = GetIndex(X, Y);
+    int32 StepsLeft = FMath::Abs(EndX - X) + FMath::Abs(EndY - Y);
+    while (StepsLeft > 0)
+    {
+        if (NextX < NextY)
+        {
+            if (!IsOpen(Index, DirectionX))
+            {
+                return false;
+            }
+            X += StepX;
+            Index += StepX;
+            NextX += CellX;
+            StepsLeft--;
+        }
+        else if (NextY < NextX)
+        {
+            if (!IsOpen(Index, DirectionY))
+            {
+                return false;
+            }
+            Y += StepY;
+            Index += StepY * Width;
+            NextY += CellY;
+            StepsLeft--;
+        }
+        else
+        {
+            //Exactly through a corner, the segment sees through if either of the two cells beside the corner lets it
+            const bool bThroughX = IsOpen(Index, DirectionX) && IsOpen(Index + StepX, DirectionY);
+            const bool bThroughY = IsOpen(Index, DirectionY) && IsOpen(Index + StepY * Width, DirectionX);
+            if (!bThroughX && !bThroughY)
+            {
+                return false;
+            }
+            X += StepX;
+            Y += StepY;
+            Index += StepX + StepY * Width;
+            NextX += CellX;
+            NextY += CellY;
+            StepsLeft -= 2;
+        }
+    }
+    return X == EndX && Y == EndY;
+}
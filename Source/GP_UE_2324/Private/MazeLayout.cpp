@@ -0,0 +1,153 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeLayout.h"
+
+void FMazeSettings::Validate()
+{
+    if (Width <= 0) {
+        UE_LOG(LogTemp, Error, TEXT("Invalid MazeWidth: %d, MazeWidth was set to 5"), Width);
+        Width = 5;
+    }
+    if (Depth <= 0) {
+        UE_LOG(LogTemp, Error, TEXT("Invalid MazeDepth: %d, MazeDepth was set to 5"), Depth);
+        Depth = 5;
+    }
+    if (VoronoidCellSize <= 0) {
+        UE_LOG(LogTemp, Error, TEXT("Invalid VoronoidCellSize: %d, VoronoidCellSize was set to 1"), VoronoidCellSize);
+        VoronoidCellSize = 1;
+    }
+    if (Width % VoronoidCellSize != 0 || Depth % VoronoidCellSize != 0)
+    {
+        UE_LOG(LogTemp, Error, TEXT("Invalid VoronoidCellSize: %d, VoronoidCellSize was set to 1"), VoronoidCellSize);
+        UE_LOG(LogTemp, Error, TEXT("VoronoidCellSize must be divisible by maze width and depth"));
+        VoronoidCellSize = 1;
+    }
+    if (NumLayers <= 0) {
+        UE_LOG(LogTemp, Error, TEXT("Invalid NumLayers: %d, NumLayers was set to 1"), NumLayers);
+        NumLayers = 1;
+    }
+    if (BraidFactor < 0.f || BraidFactor > 1.f) {
+        UE_LOG(LogTemp, Error, TEXT("Invalid BraidFactor: %f, it was clamped between 0 and 1"), BraidFactor);
+        BraidFactor = FMath::Clamp(BraidFactor, 0.f, 1.f);
+    }
+    if (NumColors <= 0) {
+        UE_LOG(LogTemp, Error, TEXT("Invalid number of Possible Colors: %d, it was set to 1"), NumColors);
+        NumColors = 1;
+    }
+}
+
+int32 FMazeSettings::GetElevationSeed() const
+{
+    return ElevationSeed != 0 ? ElevationSeed : (int32)HashCombine(GetTypeHash(Seed), GetTypeHash(TEXT("Elevation")));
+}
+
+void FMazeLayout::UpdateExitAndKeyRegions()
+{
+    ExitRegion = Grid.IsValidIndex(ExitIndex) && Regions.IsValidIndex(ExitIndex) ? Regions[ExitIndex] : INDEX_NONE;
+    KeyRegion = Grid.IsValidIndex(KeyIndex) && Regions.IsValidIndex(KeyIndex) ? Regions[KeyIndex] : INDEX_NONE;
+}
+
+SIZE_T FMazeLayout::GetAllocatedSize() const
+{
+    return Grid.Cells.GetAllocatedSize() + VoronoidPoints.GetAllocatedSize() + RegionColors.GetAllocatedSize()
+        + Regions.GetAllocatedSize() + Elevation.GetAllocatedSize();
+}
+
+FColor FMazeLayout::GetCellColor(int32 CellIndex, TConstArrayView<FColor> Palette, const FColor& AreaExit, const FColor& AreaKey) const
+{
+    if (CellIndex == KeyIndex)
+    {
+        return AreaKey;
+    }
+    if (CellIndex == ExitIndex)
+    {
+        return AreaExit;
+    }
+
+    const int32 Region = Regions.IsValidIndex(CellIndex) ? Regions[CellIndex] : INDEX_NONE;
+    if (Region == INDEX_NONE)
+    {
+        return FColor::Black;
+    }
+    if (Region == KeyRegion)
+    {
+        return AreaKey;
+    }
+    if (Region == ExitRegion)
+    {
+        return AreaExit;
+    }
+    return Palette.IsValidIndex(RegionColors[Region]) ? Palette[RegionColors[Region]] : FColor::Black;
+}
+
+void FMazeLayout::Rasterize(TConstArrayView<FColor> Palette, const FColor& AreaExit, const FColor& AreaKey, const FColor& WallColor, TArray<FColor>& OutPixels, int32& OutWidth, int32& OutHeight) const
+{
+    OutWidth = 2 * Grid.Width + 1;
+    OutHeight = 2 * Grid.Depth + 1;
+    OutPixels.Init(WallColor, OutWidth * OutHeight);
+
+    for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+    {
+        const int32 PixelX = 2 * Grid.GetX(CellIndex) + 1;
+        const int32 PixelY = 2 * Grid.GetY(CellIndex) + 1;
+        const FColor Color = GetCellColor(CellIndex, Palette, AreaExit, AreaKey);
+
+        OutPixels[PixelY * OutWidth + PixelX] = Color;
+        if (Grid.IsOpen(CellIndex, EDirection::Left))
+        {
+            OutPixels[PixelY * OutWidth + PixelX + 1] = Color;
+        }
+        if (Grid.IsOpen(CellIndex, EDirection::Top))
+        {
+            OutPixels[(PixelY + 1) * OutWidth + PixelX] = Color;
+        }
+    }
+}
+
+FArchive& operator<<(FArchive& Ar, FMazeLayout& Layout)
+{
+    int32 Version = FMazeLayout::Version;
+    Ar << Version;
+    if (Ar.IsLoading() && Version != FMazeLayout::Version)
+    {
+        UE_LOG(LogTemp, Error, TEXT("FMazeLayout version %d does not match %d"), Version, FMazeLayout::Version);
+        Ar.SetError();
+        return Ar;
+    }
+
+    Ar << Layout.Grid.Width;
+    Ar << Layout.Grid.Depth;
+    Ar << Layout.Grid.Cells;
+    Ar << Layout.StartIndex;
+    Ar << Layout.ExitIndex;
+    Ar << Layout.KeyIndex;
+    Ar << Layout.VoronoidPoints;
+    Ar << Layout.RegionColors;
+    Ar << Layout.Regions;
+    Ar << Layout.ExitRegion;
+    Ar << Layout.KeyRegion;
+    Ar << Layout.Elevation.Order;
+    Ar << Layout.Elevation.Parents;
+    Ar << Layout.Elevation.Levels;
+    Ar << Layout.Elevation.Heights;
+    Ar << Layout.Elevation.Corners;
+    return Ar;
+}
+
+SIZE_T FMazeTower::GetAllocatedSize() const
+{
+    SIZE_T Size = Layers.GetAllocatedSize() + Links.GetAllocatedSize();
+    for (const FMazeLayout& Layer : Layers)
+    {
+        Size += Layer.GetAllocatedSize();
+    }
+    return Size;
+}
+
+FArchive& operator<<(FArchive& Ar, FMazeTower& Tower)
+{
+    Ar << Tower.Layers;
+    Ar << Tower.Links;
+    return Ar;
+}
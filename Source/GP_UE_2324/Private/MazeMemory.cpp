@@ -0,0 +1,116 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeMemory.h"
+#include "GameFramework/Actor.h"
+#include "Components/PrimitiveComponent.h"
+#include "ProceduralMeshComponent.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "Serialization/ArchiveCountMem.h"
+#include "UObject/UObjectHash.h"
+
+LLM_DEFINE_TAG(Maze);
+LLM_DEFINE_TAG(Maze_Topology, TEXT("Topology"), TEXT("Maze"));
+LLM_DEFINE_TAG(Maze_Search, TEXT("Search"), TEXT("Maze"));
+LLM_DEFINE_TAG(Maze_Geometry, TEXT("Geometry"), TEXT("Maze"));
+LLM_DEFINE_TAG(Maze_Materials, TEXT("Materials"), TEXT("Maze"));
+LLM_DEFINE_TAG(Maze_Collision, TEXT("Collision"), TEXT("Maze"));
+
+namespace
+{
+    //The scene proxy of a procedural mesh copies every section into its own buffers: position, two packed tangents,
+    //four half precision UVs and a color per vertex and 32 bit indices
+    constexpr int64 ProxyBytesPerVertex = 12 + 2 * 4 + 4 * 4 + 4;
+    constexpr int64 ProxyBytesPerIndex = 4;
+
+    double ToMB(int64 Bytes)
+    {
+        return Bytes / (1024.0 * 1024.0);
+    }
+}
+
+FString FMazeMemoryStats::ToString() const
+{
+    return FString::Printf(TEXT("%.2f MB, %.1f bytes per cell of %d cells, %d objects (topology %.2f MB, search %.2f MB, geometry %.2f MB, materials %.2f MB, collision %.2f MB)"),
+        ToMB(GetTotal()), GetBytesPerCell(), NumCells, NumObjects, ToMB(Topology), ToMB(Search), ToMB(Geometry), ToMB(Materials), ToMB(Collision));
+}
+
+int64 MazeMemory::GetObjectBytes(UObject* Object)
+{
+    if (!Object)
+    {
+        return 0;
+    }
+    FArchiveCountMem Count(Object);
+    return Object->GetClass()->GetStructureSize() + Count.GetMax() + Object->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+}
+
+void MazeMemory::AddActor(AActor* Actor, FMazeMemoryStats& Stats)
+{
+    if (!Actor)
+    {
+        return;
+    }
+    Stats.Geometry += GetObjectBytes(Actor);
+    Stats.NumObjects++;
+
+    TInlineComponentArray<UActorComponent*> Components(Actor);
+    for (UActorComponent* Component : Components)
+    {
+        AddComponent(Component, Stats);
+    }
+}
+
+void MazeMemory::AddComponent(UActorComponent* Component, FMazeMemoryStats& Stats, bool bCollision)
+{
+    if (!Component)
+    {
+        return;
+    }
+
+    int64 Bytes = GetObjectBytes(Component);
+    Stats.NumObjects++;
+
+    //The resource size of a primitive includes its physics bodies
+    if (const UPrimitiveComponent* Primitive = Cast<UPrimitiveComponent>(Component))
+    {
+        FResourceSizeEx BodySize(EResourceSizeMode::Exclusive);
+        Primitive->BodyInstance.GetBodyInstanceResourceSizeEx(BodySize);
+        const int64 BodyBytes = FMath::Min((int64)BodySize.GetTotalMemoryBytes(), Bytes);
+        Stats.Collision += BodyBytes;
+        Bytes -= BodyBytes;
+    }
+
+    UProceduralMeshComponent* ProcMesh = Cast<UProceduralMeshComponent>(Component);
+    if (ProcMesh && ProcMesh->SceneProxy)
+    {
+        for (int32 Section = 0; Section < ProcMesh->GetNumSections(); Section++)
+        {
+            const FProcMeshSection* MeshSection = ProcMesh->GetProcMeshSection(Section);
+            if (MeshSection && MeshSection->bSectionVisible)
+            {
+                Bytes += MeshSection->ProcVertexBuffer.Num() * ProxyBytesPerVertex + MeshSection->ProcIndexBuffer.Num() * ProxyBytesPerIndex;
+            }
+        }
+    }
+    (bCollision ? Stats.Collision : Stats.Geometry) += Bytes;
+
+    ForEachObjectWithOuter(Component, [&Stats, bCollision](UObject* Inner)
+        {
+            const int64 InnerBytes = GetObjectBytes(Inner);
+            Stats.NumObjects++;
+            if (bCollision || Inner->IsA<UBodySetup>())
+            {
+                Stats.Collision += InnerBytes;
+            }
+            else if (Inner->IsA<UMaterialInstanceDynamic>())
+            {
+                Stats.Materials += InnerBytes;
+            }
+            else
+            {
+                Stats.Geometry += InnerBytes;
+            }
+        }, false);
+}
@@ -0,0 +1,345 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeMinimapSubsystem.h"
+#include "Async/Async.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+
+void UMazeMinimapSubsystem::BuildMinimap(const FMazeLayout& Layout, TConstArrayView<FColor> InPalette, const FColor& InAreaExit, const FColor& InAreaKey,
+    const FTransform& InMazeTransform, float InCellSize, bool bFogOfWar)
+{
+    if (!Layout.IsValid())
+    {
+        UE_LOG(LogTemp, Error, TEXT("Error in UMazeMinimapSubsystem::BuildMinimap() invalid layout"));
+        return;
+    }
+
+    if (Layout.Grid.Width != GridWidth || Layout.Grid.Depth != GridDepth)
+    {
+        GridWidth = Layout.Grid.Width;
+        GridDepth = Layout.Grid.Depth;
+        Revealed.Init(false, Layout.Grid.Num());
+    }
+    Palette = TArray<FColor>(InPalette.GetData(), InPalette.Num());
+    AreaExit = InAreaExit;
+    AreaKey = InAreaKey;
+    MazeTransform = InMazeTransform;
+    CellSize = InCellSize;
+    bFog = bFogOfWar;
+    PlayerCell = INDEX_NONE;
+
+    //The worker only gets the data it draws, not the elevation
+    FMazeLayout MapLayout;
+    MapLayout.Grid = Layout.Grid;
+    MapLayout.ExitIndex = Layout.ExitIndex;
+    MapLayout.KeyIndex = Layout.KeyIndex;
+    MapLayout.RegionColors = Layout.RegionColors;
+    MapLayout.Regions = Layout.Regions;
+    MapLayout.ExitRegion = Layout.ExitRegion;
+    MapLayout.KeyRegion = Layout.KeyRegion;
+
+    const uint32 Serial = ++BuildSerial;
+    TWeakObjectPtr<UMazeMinimapSubsystem> WeakThis(this);
+    Async(EAsyncExecution::ThreadPool, [WeakThis, Serial, MapLayout = MoveTemp(MapLayout), MapPalette = Palette, InAreaExit, InAreaKey, MapWallColor = WallColor]()
+        {
+            TArray<FColor> Pixels;
+            int32 Width;
+            int32 Height;
+            MapLayout.Rasterize(MapPalette, InAreaExit, InAreaKey, MapWallColor, Pixels, Width, Height);
+
+            AsyncTask(ENamedThreads::GameThread, [WeakThis, Serial, Pixels = MoveTemp(Pixels), Width, Height]() mutable
+                {
+                    if (UMazeMinimapSubsystem* Minimap = WeakThis.Get())
+                    {
+                        Minimap->OnRasterized(Serial, MoveTemp(Pixels), Width, Height);
+                    }
+                });
+        });
+}
+
+//Builds what the texture shows from the new map and the revealed cells and uploads all of it once
+void UMazeMinimapSubsystem::OnRasterized(uint32 Serial, TArray<FColor>&& Pixels, int32 Width, int32 Height)
+{
+    if (Serial != BuildSerial)
+    {
+        return;
+    }
+
+    MapPixels = MoveTemp(Pixels);
+    if (bFog)
+    {
+        DisplayPixels.Init(FogColor, MapPixels.Num());
+        for (TConstSetBitIterator<> It(Revealed); It; ++It)
+        {
+            CopyCellBlock(It.GetIndex() % GridWidth, It.GetIndex() / GridWidth);
+        }
+    }
+    else
+    {
+        DisplayPixels = MapPixels;
+    }
+
+    const bool bNewTexture = !Texture || Width != PixelWidth || Height != PixelHeight;
+    PixelWidth = Width;
+    PixelHeight = Height;
+    DirtyRects.Reset();
+
+    if (bNewTexture)
+    {
+        Texture = UTexture2D::CreateTransient(Width, Height, PF_B8G8R8A8, TEXT("MazeMinimap"));
+        Texture->Filter = TF_Nearest;
+        Texture->SRGB = true;
+
+        FTexture2DMipMap& Mip = Texture->GetPlatformData()->Mips[0];
+        void* Data = Mip.BulkData.Lock(LOCK_READ_WRITE);
+        FMemory::Memcpy(Data, DisplayPixels.GetData(), DisplayPixels.Num() * sizeof(FColor));
+        Mip.BulkData.Unlock();
+        Texture->UpdateResource();
+    }
+    else
+    {
+        AddDirtyRect(FIntRect(0, 0, Width, Height));
+        FlushDirtyRects();
+    }
+
+    OnMinimapReady.Broadcast(Texture);
+}
+
+//A cell is drawn with its four walls and corners, the 3 x 3 pixels around its center
+void UMazeMinimapSubsystem::CopyCellBlock(int32 X, int32 Y)
+{
+    for (int32 PixelY = 2 * Y; PixelY <= 2 * Y + 2; PixelY++)
+    {
+        const int32 Row = PixelY * PixelWidth;
+        for (int32 PixelX = 2 * X; PixelX <= 2 * X + 2; PixelX++)
+        {
+            DisplayPixels[Row + PixelX] = MapPixels[Row + PixelX];
+        }
+    }
+}
+
+void UMazeMinimapSubsystem::UpdateWall(const FMazeLayout& Layout, int32 CellIndex, EDirection Direction)
+{
+    const FMazeGrid& Grid = Layout.Grid;
+    const int32 Neighbour = Grid.IsValidIndex(CellIndex) ? Grid.GetNeighbourIndex(CellIndex, Direction) : INDEX_NONE;
+    if (Neighbour == INDEX_NONE || MapPixels.Num() != PixelWidth * PixelHeight || Grid.Width != GridWidth || Grid.Depth != GridDepth)
+    {
+        return;
+    }
+
+    //Same as FMazeLayout::Rasterize, an open wall takes the color of the cell on its -X or -Y side
+    const int32 Lower = FMath::Min(CellIndex, Neighbour);
+    const int32 Upper = FMath::Max(CellIndex, Neighbour);
+    const int32 PixelX = Grid.GetX(Lower) + Grid.GetX(Upper) + 1;
+    const int32 PixelY = Grid.GetY(Lower) + Grid.GetY(Upper) + 1;
+    const int32 Pixel = PixelY * PixelWidth + PixelX;
+
+    MapPixels[Pixel] = Grid.IsOpen(CellIndex, Direction) ? Layout.GetCellColor(Lower, Palette, AreaExit, AreaKey) : WallColor;
+    if (!bFog || Revealed[CellIndex] || Revealed[Neighbour])
+    {
+        DisplayPixels[Pixel] = MapPixels[Pixel];
+        AddDirtyRect(FIntRect(PixelX, PixelY, PixelX + 1, PixelY + 1));
+    }
+}
+
+//Changed cells are close to each other, so they are uploaded as one rectangle around all of them
+void UMazeMinimapSubsystem::UpdateCells(const FMazeLayout& Layout, TConstArrayView<int32> Cells)
+{
+    const FMazeGrid& Grid = Layout.Grid;
+    if (MapPixels.Num() != PixelWidth * PixelHeight || Grid.Width != GridWidth || Grid.Depth != GridDepth)
+    {
+        return;
+    }
+
+    FIntRect Bounds(MAX_int32, MAX_int32, MIN_int32, MIN_int32);
+    auto Draw = [&](int32 PixelX, int32 PixelY, const FColor& Color, bool bVisible)
+        {
+            const int32 Pixel = PixelY * PixelWidth + PixelX;
+            MapPixels[Pixel] = Color;
+            if (bVisible)
+            {
+                DisplayPixels[Pixel] = Color;
+                Bounds.Include(FIntPoint(PixelX, PixelY));
+            }
+        };
+
+    //Same as FMazeLayout::Rasterize, a cell also colors its open walls towards +X and +Y
+    for (int32 CellIndex : Cells)
+    {
+        if (!Grid.IsValidIndex(CellIndex))
+        {
+            continue;
+        }
+        const FColor Color = Layout.GetCellColor(CellIndex, Palette, AreaExit, AreaKey);
+        const int32 PixelX = 2 * Grid.GetX(CellIndex) + 1;
+        const int32 PixelY = 2 * Grid.GetY(CellIndex) + 1;
+        const bool bVisible = !bFog || Revealed[CellIndex];
+
+        Draw(PixelX, PixelY, Color, bVisible);
+        if (Grid.IsOpen(CellIndex, EDirection::Left))
+        {
+            Draw(PixelX + 1, PixelY, Color, bVisible || Revealed[Grid.GetNeighbourIndex(CellIndex, EDirection::Left)]);
+        }
+        if (Grid.IsOpen(CellIndex, EDirection::Top))
+        {
+            Draw(PixelX, PixelY + 1, Color, bVisible || Revealed[Grid.GetNeighbourIndex(CellIndex, EDirection::Top)]);
+        }
+    }
+
+    if (Bounds.Min.X <= Bounds.Max.X)
+    {
+        AddDirtyRect(FIntRect(Bounds.Min, Bounds.Max + FIntPoint(1, 1)));
+    }
+}
+
+void UMazeMinimapSubsystem::RevealArea(int32 CellIndex, int32 Radius)
+{
+    if (!Revealed.IsValidIndex(CellIndex))
+    {
+        return;
+    }
+
+    const int32 CenterX = CellIndex % GridWidth;
+    const int32 CenterY = CellIndex / GridWidth;
+    const int32 MinX = FMath::Max(CenterX - Radius, 0);
+    const int32 MinY = FMath::Max(CenterY - Radius, 0);
+    const int32 MaxX = FMath::Min(CenterX + Radius, GridWidth - 1);
+    const int32 MaxY = FMath::Min(CenterY + Radius, GridDepth - 1);
+
+    //Cells revealed while the map is still being drawn are applied when it is done
+    const bool bCanDraw = bFog && MapPixels.Num() == PixelWidth * PixelHeight && MapPixels.Num() > 0;
+    bool bChanged = false;
+    for (int32 Y = MinY; Y <= MaxY; Y++)
+    {
+        for (int32 X = MinX; X <= MaxX; X++)
+        {
+            const int32 Index = Y * GridWidth + X;
+            if (!Revealed[Index])
+            {
+                Revealed[Index] = true;
+                if (bCanDraw)
+                {
+                    CopyCellBlock(X, Y);
+                    bChanged = true;
+                }
+            }
+        }
+    }
+
+    if (bChanged)
+    {
+        AddDirtyRect(FIntRect(2 * MinX, 2 * MinY, 2 * MaxX + 3, 2 * MaxY + 3));
+    }
+}
+
+bool UMazeMinimapSubsystem::IsCellRevealed(int32 CellIndex) const
+{
+    return Revealed.IsValidIndex(CellIndex) && Revealed[CellIndex];
+}
+
+FVector2D UMazeMinimapSubsystem::GetCellUV(int32 CellIndex) const
+{
+    if (GridWidth <= 0 || PixelWidth <= 0)
+    {
+        return FVector2D::ZeroVector;
+    }
+    return FVector2D((2 * (CellIndex % GridWidth) + 1.5f) / PixelWidth, (2 * (CellIndex / GridWidth) + 1.5f) / PixelHeight);
+}
+
+//Overlapping rectangles are merged so a pixel is uploaded at most once per tick
+void UMazeMinimapSubsystem::AddDirtyRect(const FIntRect& Rect)
+{
+    FIntRect Merged = Rect;
+    for (int32 I = 0; I < DirtyRects.Num(); I++)
+    {
+        if (DirtyRects[I].Intersect(Merged))
+        {
+            //The grown rectangle may now overlap rectangles that were already checked
+            Merged.Union(DirtyRects[I]);
+            DirtyRects.RemoveAtSwap(I);
+            I = -1;
+        }
+    }
+    DirtyRects.Add(Merged);
+}
+
+//Every rectangle is copied out so the render thread never reads pixels that change after this tick
+void UMazeMinimapSubsystem::FlushDirtyRects()
+{
+    if (!Texture || DirtyRects.Num() == 0)
+    {
+        return;
+    }
+
+    for (const FIntRect& Rect : DirtyRects)
+    {
+        const int32 RectWidth = Rect.Width();
+        const int32 RectHeight = Rect.Height();
+        FColor* RectPixels = new FColor[RectWidth * RectHeight];
+        for (int32 Y = 0; Y < RectHeight; Y++)
+        {
+            FMemory::Memcpy(RectPixels + Y * RectWidth, DisplayPixels.GetData() + (Rect.Min.Y + Y) * PixelWidth + Rect.Min.X, RectWidth * sizeof(FColor));
+        }
+
+        FUpdateTextureRegion2D* Region = new FUpdateTextureRegion2D(Rect.Min.X, Rect.Min.Y, 0, 0, RectWidth, RectHeight);
+        Texture->UpdateTextureRegions(0, 1, Region, RectWidth * sizeof(FColor), sizeof(FColor), (uint8*)RectPixels,
+            [](uint8* SrcData, const FUpdateTextureRegion2D* Regions)
+            {
+                delete[] (FColor*)SrcData;
+                delete Regions;
+            });
+    }
+    DirtyRects.Reset();
+}
+
+void UMazeMinimapSubsystem::RevealAroundPlayer()
+{
+    APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+    const APawn* PlayerPawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+    if (!PlayerPawn || GridWidth <= 0 || CellSize <= 0.f)
+    {
+        return;
+    }
+
+    const FVector Local = MazeTransform.InverseTransformPosition(PlayerPawn->GetActorLocation());
+    const int32 X = FMath::FloorToInt(Local.X / CellSize);
+    const int32 Y = FMath::FloorToInt(Local.Y / CellSize);
+    const int32 Cell = X >= 0 && Y >= 0 && X < GridWidth && Y < GridDepth ? Y * GridWidth + X : INDEX_NONE;
+    if (Cell != PlayerCell)
+    {
+        PlayerCell = Cell;
+        RevealArea(Cell, RevealRadius);
+    }
+}
+
+void UMazeMinimapSubsystem::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+
+    if (bFog && bRevealAroundPlayer)
+    {
+        RevealAroundPlayer();
+    }
+    FlushDirtyRects();
+}
+
+bool UMazeMinimapSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+    return !IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UMazeMinimapSubsystem::Deinitialize()
+{
+    ++BuildSerial;
+    Texture = nullptr;
+    MapPixels.Empty();
+    DisplayPixels.Empty();
+    DirtyRects.Empty();
+    Super::Deinitialize();
+}
+
+TStatId UMazeMinimapSubsystem::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UMazeMinimapSubsystem, STATGROUP_Tickables);
+}
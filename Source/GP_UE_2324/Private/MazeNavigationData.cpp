@@ -0,0 +1,522 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeNavigationData.h"
+#include "MazeScratch.h"
+
+namespace
+{
+    //Node references are the cell index plus one because 0 is the invalid reference
+    NavNodeRef GetCellRef(int32 CellIndex) { return (NavNodeRef)(CellIndex + 1); }
+
+    //Walls are treated as having no thickness, agents keep at least this fraction of a cell from the corners
+    constexpr float MinCornerMargin = 0.05f;
+}
+
+AMazeNavigationData::AMazeNavigationData(const FObjectInitializer& ObjectInitializer)
+    : Super(ObjectInitializer)
+{
+    FindPathImplementation = FindPath;
+    FindHierarchicalPathImplementation = FindPath;
+    TestPathImplementation = TestPath;
+    TestHierarchicalPathImplementation = TestPath;
+    RaycastImplementation = Raycast;
+
+    //The generator spawns it for its maze, and the recast navmesh of the Default agent stays the main navigation data
+    //for the agents of a level without a maze
+    bCanSpawnOnRebuild = false;
+    bCanBeMainNavData = false;
+}
+
+void AMazeNavigationData::SetMaze(const FMazeGrid& InGrid, TConstArrayView<float> InCellHeights, const FTransform& InMazeTransform, float InCellSize)
+{
+    if (InCellHeights.Num() != InGrid.Num() || InCellSize <= 0.f)
+    {
+        UE_LOG(LogTemp, Error, TEXT("Error in AMazeNavigationData::SetMaze() %d heights for %d cells, cell size %f"), InCellHeights.Num(), InGrid.Num(), InCellSize);
+        return;
+    }
+
+    {
+        FScopeLock Lock(&MazeLock);
+        Grid = InGrid;
+        CellHeights = InCellHeights;
+        MazeTransform = InMazeTransform;
+        CellSize = InCellSize;
+        Pathfinder.SetCellCosts(TConstArrayView<int32>());
+    }
+    InvalidatePaths();
+}
+
+void AMazeNavigationData::ClearMaze()
+{
+    {
+        FScopeLock Lock(&MazeLock);
+        Grid = FMazeGrid();
+        CellHeights.Reset();
+    }
+    InvalidatePaths();
+}
+
+void AMazeNavigationData::SetCellHeights(TConstArrayView<int32> InCells, TConstArrayView<float> InHeights)
+{
+    if (InCells.Num() != InHeights.Num())
+    {
+        UE_LOG(LogTemp, Error, TEXT("Error in AMazeNavigationData::SetCellHeights() %d heights for %d cells"), InHeights.Num(), InCells.Num());
+        return;
+    }
+
+    {
+        FScopeLock Lock(&MazeLock);
+        for (int32 I = 0; I < InCells.Num(); I++)
+        {
+            if (CellHeights.IsValidIndex(InCells[I]))
+            {
+                CellHeights[InCells[I]] = InHeights[I];
+            }
+        }
+    }
+    InvalidatePaths();
+}
+
+SIZE_T AMazeNavigationData::GetAllocatedSize() const
+{
+    FScopeLock Lock(&MazeLock);
+    return Grid.Cells.GetAllocatedSize() + CellHeights.GetAllocatedSize() + Pathfinder.GetAllocatedSize();
+}
+
+void AMazeNavigationData::SetWallOpen(int32 CellIndex, EDirection Direction, bool bOpen)
+{
+    {
+        FScopeLock Lock(&MazeLock);
+        if (!Grid.IsValidIndex(CellIndex) || Grid.GetNeighbourIndex(CellIndex, Direction) == INDEX_NONE)
+        {
+            return;
+        }
+
+        if (bOpen)
+        {
+            Grid.OpenWall(CellIndex, Direction);
+        }
+        else
+        {
+            Grid.CloseWall(CellIndex, Direction);
+        }
+    }
+
+    //Opening a wall leaves the current paths valid, only shorter ones may exist
+    if (!bOpen)
+    {
+        InvalidatePaths();
+    }
+}
+
+//Paths are invalidated outside of the lock because their observers may request new paths right away
+void AMazeNavigationData::InvalidatePaths()
+{
+    TArray<FNavPathSharedPtr> Paths;
+    {
+        FScopeLock Lock(&ActivePathsLock);
+        Paths.Reserve(ActivePaths.Num());
+        for (const FNavPathWeakPtr& WeakPath : ActivePaths)
+        {
+            FNavPathSharedPtr Path = WeakPath.Pin();
+            if (Path.IsValid() && Path->IsValid())
+            {
+                Paths.Add(Path);
+            }
+        }
+    }
+
+    for (const FNavPathSharedPtr& Path : Paths)
+    {
+        Path->Invalidate();
+    }
+}
+
+FVector2D AMazeNavigationData::ToGridSpace(const FVector& WorldLocation) const
+{
+    const FVector Local = MazeTransform.InverseTransformPosition(WorldLocation);
+    return FVector2D(Local.X / CellSize, Local.Y / CellSize);
+}
+
+FVector AMazeNavigationData::ToWorld(const FVector2D& GridLocation) const
+{
+    const int32 CellIndex = GetCell(GridLocation);
+    const float Height = CellIndex != INDEX_NONE ? CellHeights[CellIndex] : 0.f;
+    return MazeTransform.TransformPosition(FVector(GridLocation.X * CellSize, GridLocation.Y * CellSize, Height));
+}
+
+int32 AMazeNavigationData::GetCell(const FVector2D& GridLocation) const
+{
+    const int32 X = FMath::FloorToInt(GridLocation.X);
+    const int32 Y = FMath::FloorToInt(GridLocation.Y);
+    return X >= 0 && Y >= 0 && X < Grid.Width && Y < Grid.Depth ? Grid.GetIndex(X, Y) : INDEX_NONE;
+}
+
+FVector AMazeNavigationData::GetRandomPointInCell(int32 CellIndex) const
+{
+    return ToWorld(FVector2D(Grid.GetX(CellIndex) + FMath::FRand(), Grid.GetY(CellIndex) + FMath::FRand()));
+}
+
+FBox AMazeNavigationData::GetBounds() const
+{
+    FScopeLock Lock(&MazeLock);
+    if (Grid.Num() == 0)
+    {
+        return FBox(ForceInit);
+    }
+
+    float MinHeight = CellHeights[0];
+    float MaxHeight = CellHeights[0];
+    for (float Height : CellHeights)
+    {
+        MinHeight = FMath::Min(MinHeight, Height);
+        MaxHeight = FMath::Max(MaxHeight, Height);
+    }
+    return FBox(FVector(0.f, 0.f, MinHeight), FVector(Grid.Width * CellSize, Grid.Depth * CellSize, MaxHeight)).TransformBy(MazeTransform);
+}
+
+//An empty maze gives a location without a node
+FNavLocation AMazeNavigationData::GetRandomPoint(FSharedConstNavQueryFilter Filter, const UObject* Querier) const
+{
+    FScopeLock Lock(&MazeLock);
+    if (Grid.Num() == 0)
+    {
+        return FNavLocation();
+    }
+
+    const int32 CellIndex = FMath::RandHelper(Grid.Num());
+    return FNavLocation(GetRandomPointInCell(CellIndex), GetCellRef(CellIndex));
+}
+
+//Walks the open walls from the cell of the origin and picks one of the cells reached whose center is in the radius
+bool AMazeNavigationData::GetRandomReachablePointInRadius(const FVector& Origin, float Radius, FNavLocation& OutResult, FSharedConstNavQueryFilter Filter, const UObject* Querier) const
+{
+    FScopeLock Lock(&MazeLock);
+    const FVector2D Center = ToGridSpace(Origin);
+    const int32 Start = GetCell(Center);
+    if (Start == INDEX_NONE)
+    {
+        return false;
+    }
+
+    const float GridRadiusSquared = FMath::Square(Radius / CellSize);
+    auto IsInRadius = [&](int32 CellIndex)
+        {
+            return FVector2D::DistSquared(FVector2D(Grid.GetX(CellIndex) + 0.5f, Grid.GetY(CellIndex) + 0.5f), Center) <= GridRadiusSquared;
+        };
+
+    FMazeScratchScope Scratch;
+    FMazeScratchBitArray Visited(false, Grid.Num());
+    TMazeScratchArray<int32> Reached;
+    Reached.Add(Start);
+    Visited[Start] = true;
+    for (int32 I = 0; I < Reached.Num(); I++)
+    {
+        Grid.ForEachOpenNeighbour(Reached[I], [&](int32 Neighbour, EDirection Direction)
+            {
+                if (!Visited[Neighbour] && IsInRadius(Neighbour))
+                {
+                    Visited[Neighbour] = true;
+                    Reached.Add(Neighbour);
+                }
+            });
+    }
+
+    const int32 CellIndex = Reached[FMath::RandHelper(Reached.Num())];
+    OutResult = FNavLocation(GetRandomPointInCell(CellIndex), GetCellRef(CellIndex));
+    return true;
+}
+
+bool AMazeNavigationData::GetRandomPointInNavigableRadius(const FVector& Origin, float Radius, FNavLocation& OutResult, FSharedConstNavQueryFilter Filter, const UObject* Querier) const
+{
+    FScopeLock Lock(&MazeLock);
+    if (Grid.Num() == 0)
+    {
+        return false;
+    }
+
+    //Every cell is walkable, so any point of the maze in the radius will do
+    const FVector2D Center = ToGridSpace(Origin);
+    const float GridRadius = Radius / CellSize;
+    for (int32 Attempt = 0; Attempt < 8; Attempt++)
+    {
+        const float Angle = FMath::FRandRange(0.f, UE_TWO_PI);
+        const FVector2D Point = Center + FVector2D(FMath::Cos(Angle), FMath::Sin(Angle)) * GridRadius * FMath::Sqrt(FMath::FRand());
+        const int32 CellIndex = GetCell(Point);
+        if (CellIndex != INDEX_NONE)
+        {
+            OutResult = FNavLocation(ToWorld(Point), GetCellRef(CellIndex));
+            return true;
+        }
+    }
+    return false;
+}
+
+//Points are moved onto the floor of the cell under them, or of the closest cell of the border if they are outside
+bool AMazeNavigationData::ProjectPointLocked(const FVector& Point, FNavLocation& OutLocation, const FVector& Extent) const
+{
+    if (Grid.Num() == 0)
+    {
+        return false;
+    }
+
+    FVector2D GridLocation = ToGridSpace(Point);
+    GridLocation.X = FMath::Clamp<FVector2D::FReal>(GridLocation.X, 0., Grid.Width - UE_KINDA_SMALL_NUMBER);
+    GridLocation.Y = FMath::Clamp<FVector2D::FReal>(GridLocation.Y, 0., Grid.Depth - UE_KINDA_SMALL_NUMBER);
+
+    const FVector Projected = ToWorld(GridLocation);
+    const FVector Offset = (Projected - Point).GetAbs();
+    if (Offset.X > Extent.X || Offset.Y > Extent.Y || Offset.Z > Extent.Z)
+    {
+        return false;
+    }
+
+    OutLocation = FNavLocation(Projected, GetCellRef(GetCell(GridLocation)));
+    return true;
+}
+
+bool AMazeNavigationData::ProjectPoint(const FVector& Point, FNavLocation& OutLocation, const FVector& Extent, FSharedConstNavQueryFilter Filter, const UObject* Querier) const
+{
+    FScopeLock Lock(&MazeLock);
+    return ProjectPointLocked(Point, OutLocation, Extent);
+}
+
+void AMazeNavigationData::BatchProjectPoints(TArray<FNavigationProjectionWork>& Workload, const FVector& Extent, FSharedConstNavQueryFilter Filter, const UObject* Querier) const
+{
+    FScopeLock Lock(&MazeLock);
+    for (FNavigationProjectionWork& Work : Workload)
+    {
+        Work.bResult = ProjectPointLocked(Work.Point, Work.OutLocation, Extent);
+    }
+}
+
+void AMazeNavigationData::BatchProjectPoints(TArray<FNavigationProjectionWork>& Workload, FSharedConstNavQueryFilter Filter, const UObject* Querier) const
+{
+    FScopeLock Lock(&MazeLock);
+    for (FNavigationProjectionWork& Work : Workload)
+    {
+        const FVector Extent = Work.ProjectionLimit.IsValid ? Work.ProjectionLimit.GetExtent() : GetDefaultQueryExtent();
+        Work.bResult = ProjectPointLocked(Work.Point, Work.OutLocation, Extent);
+    }
+}
+
+//Every cell costs the same to cross, so the cost of a path is its length
+ENavigationQueryResult::Type AMazeNavigationData::CalcPathLocked(const FVector& PathStart, const FVector& PathEnd, FVector::FReal& OutPathLength) const
+{
+    TArray<FVector> Points;
+    if (!BuildPath(PathStart, PathEnd, MinCornerMargin * CellSize, Points))
+    {
+        return ENavigationQueryResult::Fail;
+    }
+
+    OutPathLength = 0.;
+    for (int32 I = 1; I < Points.Num(); I++)
+    {
+        OutPathLength += FVector::Dist(Points[I - 1], Points[I]);
+    }
+    return ENavigationQueryResult::Success;
+}
+
+ENavigationQueryResult::Type AMazeNavigationData::CalcPathCost(const FVector& PathStart, const FVector& PathEnd, FVector::FReal& OutPathCost, FSharedConstNavQueryFilter QueryFilter, const UObject* Querier) const
+{
+    FScopeLock Lock(&MazeLock);
+    return CalcPathLocked(PathStart, PathEnd, OutPathCost);
+}
+
+ENavigationQueryResult::Type AMazeNavigationData::CalcPathLength(const FVector& PathStart, const FVector& PathEnd, FVector::FReal& OutPathLength, FSharedConstNavQueryFilter QueryFilter, const UObject* Querier) const
+{
+    FScopeLock Lock(&MazeLock);
+    return CalcPathLocked(PathStart, PathEnd, OutPathLength);
+}
+
+ENavigationQueryResult::Type AMazeNavigationData::CalcPathLengthAndCost(const FVector& PathStart, const FVector& PathEnd, FVector::FReal& OutPathLength, FVector::FReal& OutPathCost, FSharedConstNavQueryFilter QueryFilter, const UObject* Querier) const
+{
+    FScopeLock Lock(&MazeLock);
+    const ENavigationQueryResult::Type Result = CalcPathLocked(PathStart, PathEnd, OutPathLength);
+    OutPathCost = OutPathLength;
+    return Result;
+}
+
+bool AMazeNavigationData::DoesNodeContainLocation(NavNodeRef NodeRef, const FVector& WorldSpaceLocation) const
+{
+    FScopeLock Lock(&MazeLock);
+    const int32 CellIndex = GetCell(ToGridSpace(WorldSpaceLocation));
+    return CellIndex != INDEX_NONE && GetCellRef(CellIndex) == NodeRef;
+}
+
+//The walls are checked on the plane of the maze, the hit is found by halving the part of the ray that is still visible
+bool AMazeNavigationData::RaycastLocked(const FVector& RayStart, const FVector& RayEnd, FVector& HitLocation) const
+{
+    const FVector2D From = ToGridSpace(RayStart);
+    const FVector2D To = ToGridSpace(RayEnd);
+    if (Grid.HasLineOfSight(From, To))
+    {
+        HitLocation = RayEnd;
+        return false;
+    }
+    if (GetCell(From) == INDEX_NONE)
+    {
+        HitLocation = RayStart;
+        return true;
+    }
+
+    float Visible = 0.f;
+    float Blocked = 1.f;
+    for (int32 Step = 0; Step < 16; Step++)
+    {
+        const float Middle = (Visible + Blocked) * 0.5f;
+        if (Grid.HasLineOfSight(From, FMath::Lerp(From, To, Middle)))
+        {
+            Visible = Middle;
+        }
+        else
+        {
+            Blocked = Middle;
+        }
+    }
+    HitLocation = ToWorld(FMath::Lerp(From, To, Visible));
+    return true;
+}
+
+void AMazeNavigationData::BatchRaycast(TArray<FNavigationRaycastWork>& Workload, FSharedConstNavQueryFilter QueryFilter, const UObject* Querier) const
+{
+    FScopeLock Lock(&MazeLock);
+    for (FNavigationRaycastWork& Work : Workload)
+    {
+        FVector HitLocation;
+        Work.bDidHit = RaycastLocked(Work.RayStart, Work.RayEnd, HitLocation);
+        Work.HitLocation = FNavLocation(HitLocation, GetCellRef(GetCell(ToGridSpace(HitLocation))));
+    }
+}
+
+//Moves in a straight line until the first wall
+bool AMazeNavigationData::FindMoveAlongSurface(const FNavLocation& StartLocation, const FVector& TargetPosition, FNavLocation& OutLocation, FSharedConstNavQueryFilter Filter, const UObject* Querier) const
+{
+    FScopeLock Lock(&MazeLock);
+    if (GetCell(ToGridSpace(StartLocation.Location)) == INDEX_NONE)
+    {
+        return false;
+    }
+
+    FVector HitLocation;
+    RaycastLocked(StartLocation.Location, TargetPosition, HitLocation);
+    const FVector2D GridLocation = ToGridSpace(HitLocation);
+    OutLocation = FNavLocation(ToWorld(GridLocation), GetCellRef(GetCell(GridLocation)));
+    return true;
+}
+
+bool AMazeNavigationData::FindOverlappingEdges(const FNavLocation& StartLocation, TConstArrayView<FVector> ConvexPolygon, TArray<FVector>& OutEdges, FSharedConstNavQueryFilter Filter, const UObject* Querier) const
+{
+    OutEdges.Reset();
+    return false;
+}
+
+bool AMazeNavigationData::GetPathSegmentBoundaryEdges(const FNavigationPath& Path, const FNavPathPoint& StartPoint, const FNavPathPoint& EndPoint, const TConstArrayView<FVector> SearchArea, TArray<FVector>& OutEdges, const float MaxAreaEnterCost, FSharedConstNavQueryFilter Filter, const UObject* Querier) const
+{
+    OutEdges.Reset();
+    return false;
+}
+
+bool AMazeNavigationData::BuildPath(const FVector& Start, const FVector& End, float AgentRadius, TArray<FVector>& OutPoints, int32* OutNumVisited) const
+{
+    OutPoints.Reset();
+    const FVector2D GridStart = ToGridSpace(Start);
+    const FVector2D GridEnd = ToGridSpace(End);
+    const int32 StartCell = GetCell(GridStart);
+    const int32 EndCell = GetCell(GridEnd);
+    if (StartCell == INDEX_NONE || EndCell == INDEX_NONE)
+    {
+        return false;
+    }
+
+    TArray<int32> PathCells;
+    const int32 Cost = Pathfinder.FindPath(Grid, StartCell, EndCell, PathCells);
+    if (OutNumVisited)
+    {
+        *OutNumVisited = Pathfinder.GetNumExpanded();
+    }
+    if (Cost == INDEX_NONE)
+    {
+        return false;
+    }
+
+    TArray<FVector2D> GridPoints;
+    FMazePathfinder::PullString(Grid, PathCells, GridStart, GridEnd, FMath::Max(AgentRadius / CellSize, MinCornerMargin), GridPoints);
+    OutPoints.Reserve(GridPoints.Num());
+    for (const FVector2D& GridPoint : GridPoints)
+    {
+        OutPoints.Add(ToWorld(GridPoint));
+    }
+    return true;
+}
+
+FPathFindingResult AMazeNavigationData::FindPath(const FNavAgentProperties& AgentProperties, const FPathFindingQuery& Query)
+{
+    const AMazeNavigationData* Self = Cast<const AMazeNavigationData>(Query.NavData.Get());
+    if (!Self)
+    {
+        return FPathFindingResult(ENavigationQueryResult::Error);
+    }
+
+    FPathFindingResult Result(ENavigationQueryResult::Error);
+    if (Query.PathInstanceToFill.IsValid())
+    {
+        Result.Path = Query.PathInstanceToFill;
+        Result.Path->ResetForRepath();
+    }
+    else
+    {
+        Result.Path = Self->CreatePathInstance<FNavigationPath>(Query);
+    }
+    if (!Result.Path.IsValid())
+    {
+        return Result;
+    }
+
+    TArray<FVector> Points;
+    {
+        FScopeLock Lock(&Self->MazeLock);
+        if (!Self->BuildPath(Query.StartLocation, Query.EndLocation, AgentProperties.AgentRadius, Points))
+        {
+            Result.Result = ENavigationQueryResult::Fail;
+            return Result;
+        }
+    }
+
+    TArray<FNavPathPoint>& PathPoints = Result.Path->GetPathPoints();
+    PathPoints.Reserve(Points.Num());
+    for (const FVector& Point : Points)
+    {
+        PathPoints.Add(FNavPathPoint(Point));
+    }
+    Result.Path->MarkReady();
+    Result.Result = ENavigationQueryResult::Success;
+    return Result;
+}
+
+bool AMazeNavigationData::TestPath(const FNavAgentProperties& AgentProperties, const FPathFindingQuery& Query, int32* NumVisitedNodes)
+{
+    const AMazeNavigationData* Self = Cast<const AMazeNavigationData>(Query.NavData.Get());
+    if (!Self)
+    {
+        return false;
+    }
+
+    FScopeLock Lock(&Self->MazeLock);
+    TArray<FVector> Points;
+    return Self->BuildPath(Query.StartLocation, Query.EndLocation, AgentProperties.AgentRadius, Points, NumVisitedNodes);
+}
+
+bool AMazeNavigationData::Raycast(const ANavigationData* NavDataInstance, const FVector& RayStart, const FVector& RayEnd, FVector& HitLocation, FSharedConstNavQueryFilter QueryFilter, const UObject* Querier)
+{
+    const AMazeNavigationData* Self = Cast<const AMazeNavigationData>(NavDataInstance);
+    if (!Self)
+    {
+        HitLocation = RayStart;
+        return true;
+    }
+
+    FScopeLock Lock(&Self->MazeLock);
+    return Self->RaycastLocked(RayStart, RayEnd, HitLocation);
+}
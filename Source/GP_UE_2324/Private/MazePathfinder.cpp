@@ -0,0 +1,245 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazePathfinder.h"
+#include "Algo/Reverse.h"
+#include "MazeScratch.h"
+
+void FMazePathfinder::SetCellCosts(TConstArrayView<int32> InCellCosts)
+{
+    CellCosts.Reset(InCellCosts.Num());
+    MinCellCost = 1;
+    MaxCellCost = 1;
+
+    for (int32 I = 0; I < InCellCosts.Num(); I++)
+    {
+        const int32 Cost = FMath::Max(InCellCosts[I], 1);
+        CellCosts.Add(Cost);
+        MinCellCost = I == 0 ? Cost : FMath::Min(MinCellCost, Cost);
+        MaxCellCost = FMath::Max(MaxCellCost, Cost);
+    }
+}
+
+int32 FMazePathfinder::FindPath(const FMazeGrid& Grid, int32 Start, int32 Goal, TArray<int32>& OutPath)
+{
+    OutPath.Reset();
+    const int32 Cost = Search(Grid, Start, Goal);
+    if (Cost == INDEX_NONE)
+    {
+        return INDEX_NONE;
+    }
+
+    for (int32 CellIndex = Goal; CellIndex != INDEX_NONE; CellIndex = Parents[CellIndex])
+    {
+        OutPath.Add(CellIndex);
+    }
+    Algo::Reverse(OutPath);
+    return Cost;
+}
+
+int32 FMazePathfinder::GetPathCost(const FMazeGrid& Grid, int32 Start, int32 Goal)
+{
+    return Search(Grid, Start, Goal);
+}
+
+SIZE_T FMazePathfinder::GetAllocatedSize() const
+{
+    SIZE_T Size = CellCosts.GetAllocatedSize() + Stamps.GetAllocatedSize() + ClosedStamps.GetAllocatedSize()
+        + Costs.GetAllocatedSize() + Parents.GetAllocatedSize() + Buckets.GetAllocatedSize();
+    for (const TArray<int32>& Bucket : Buckets)
+    {
+        Size += Bucket.GetAllocatedSize();
+    }
+    return Size;
+}
+
+//The heuristic is the Manhattan distance times the cheapest cell, which never overestimates and changes by at most
+//the cost of a step, so the estimate never decreases along a path and the first time a cell is expanded its cost is final
+int32 FMazePathfinder::Search(const FMazeGrid& Grid, int32 Start, int32 Goal)
+{
+    NumExpanded = 0;
+    if (!Grid.IsValidIndex(Start) || !Grid.IsValidIndex(Goal))
+    {
+        UE_LOG(LogTemp, Error, TEXT("Error in FMazePathfinder::Search() invalid cells: %d, %d"), Start, Goal);
+        return INDEX_NONE;
+    }
+    if (CellCosts.Num() > 0 && CellCosts.Num() != Grid.Num())
+    {
+        UE_LOG(LogTemp, Error, TEXT("Error in FMazePathfinder::Search() there are %d cell costs for %d cells, every step costs 1"), CellCosts.Num(), Grid.Num());
+        SetCellCosts(TConstArrayView<int32>());
+    }
+
+    if (Stamps.Num() != Grid.Num())
+    {
+        Stamps.Init(0, Grid.Num());
+        ClosedStamps.Init(0, Grid.Num());
+        Costs.SetNumUninitialized(Grid.Num());
+        Parents.SetNumUninitialized(Grid.Num());
+        Stamp = 0;
+    }
+    if (Stamp == MAX_uint32)
+    {
+        FMemory::Memzero(Stamps.GetData(), Stamps.Num() * sizeof(uint32));
+        FMemory::Memzero(ClosedStamps.GetData(), ClosedStamps.Num() * sizeof(uint32));
+        Stamp = 0;
+    }
+    Stamp++;
+
+    //Buckets left over from a query that stopped at its goal are emptied without freeing them
+    const int32 NumBuckets = MaxCellCost + MinCellCost + 1;
+    Buckets.SetNum(NumBuckets);
+    for (TArray<int32>& Bucket : Buckets)
+    {
+        Bucket.Reset();
+    }
+
+    const int32 GoalX = Grid.GetX(Goal);
+    const int32 GoalY = Grid.GetY(Goal);
+    auto Heuristic = [&](int32 Index)
+        {
+            return MinCellCost * (FMath::Abs(Grid.GetX(Index) - GoalX) + FMath::Abs(Grid.GetY(Index) - GoalY));
+        };
+
+    Stamps[Start] = Stamp;
+    Costs[Start] = 0;
+    Parents[Start] = INDEX_NONE;
+
+    int32 Estimate = Heuristic(Start);
+    Buckets[Estimate % NumBuckets].Add(Start);
+    int32 NumQueued = 1;
+
+    while (NumQueued > 0)
+    {
+        TArray<int32>& Bucket = Buckets[Estimate % NumBuckets];
+        if (Bucket.Num() == 0)
+        {
+            Estimate++;
+            continue;
+        }
+
+        //Cells queued again with a lower cost leave their old entries behind, those are skipped here
+        const int32 Current = Bucket.Pop(false);
+        NumQueued--;
+        if (ClosedStamps[Current] == Stamp || Costs[Current] + Heuristic(Current) != Estimate)
+        {
+            continue;
+        }
+        ClosedStamps[Current] = Stamp;
+        NumExpanded++;
+
+        if (Current == Goal)
+        {
+            return Costs[Current];
+        }
+
+        Grid.ForEachOpenNeighbour(Current, [&](int32 Neighbour, EDirection Direction)
+            {
+                const int32 Cost = Costs[Current] + GetCellCost(Neighbour);
+                if (Stamps[Neighbour] != Stamp || Cost < Costs[Neighbour])
+                {
+                    Stamps[Neighbour] = Stamp;
+                    Costs[Neighbour] = Cost;
+                    Parents[Neighbour] = Current;
+                    Buckets[(Cost + Heuristic(Neighbour)) % NumBuckets].Add(Neighbour);
+                    NumQueued++;
+                }
+            });
+    }
+
+    return INDEX_NONE;
+}
+
+//Simple stupid funnel: the funnel from the apex is narrowed by the sides of every portal in order, and when one side
+//crosses over the other, the end of the other side is a corner of the path and becomes the new apex
+void FMazePathfinder::PullString(const FMazeGrid& Grid, TConstArrayView<int32> PathCells, const FVector2D& Start, const FVector2D& End, float Margin, TArray<FVector2D>& OutPoints)
+{
+    OutPoints.Reset();
+    OutPoints.Add(Start);
+
+    const float HalfWidth = 0.5f - FMath::Clamp(Margin, 0.f, 0.45f);
+    const int32 NumPortals = FMath::Max(PathCells.Num(), 1) + 1;
+
+    //Ends of every portal on the left and on the right of the walking direction. The first portal is the start
+    //and the last one the end
+    FMazeScratchScope Scratch;
+    TMazeScratchArray<FVector2D> Lefts;
+    TMazeScratchArray<FVector2D> Rights;
+    Lefts.Reserve(NumPortals);
+    Rights.Reserve(NumPortals);
+    Lefts.Add(Start);
+    Rights.Add(Start);
+    for (int32 I = 1; I < PathCells.Num(); I++)
+    {
+        const int32 From = PathCells[I - 1];
+        const int32 To = PathCells[I];
+        const FVector2D Direction(Grid.GetX(To) - Grid.GetX(From), Grid.GetY(To) - Grid.GetY(From));
+        const FVector2D Middle((Grid.GetX(From) + Grid.GetX(To) + 1) * 0.5f, (Grid.GetY(From) + Grid.GetY(To) + 1) * 0.5f);
+        const FVector2D Side(-Direction.Y * HalfWidth, Direction.X * HalfWidth);
+        Lefts.Add(Middle + Side);
+        Rights.Add(Middle - Side);
+    }
+    Lefts.Add(End);
+    Rights.Add(End);
+
+    //Positive when C is on the left of the line from A to B
+    auto Cross = [](const FVector2D& A, const FVector2D& B, const FVector2D& C)
+        {
+            return (B.X - A.X) * (C.Y - A.Y) - (B.Y - A.Y) * (C.X - A.X);
+        };
+
+    FVector2D Apex = Start;
+    FVector2D PortalLeft = Start;
+    FVector2D PortalRight = Start;
+    int32 ApexIndex = 0;
+    int32 LeftIndex = 0;
+    int32 RightIndex = 0;
+
+    for (int32 I = 1; I < Lefts.Num(); I++)
+    {
+        const FVector2D& Left = Lefts[I];
+        const FVector2D& Right = Rights[I];
+
+        if (Cross(Apex, PortalRight, Right) >= 0.f)
+        {
+            if (Apex == PortalRight || Cross(Apex, PortalLeft, Right) < 0.f)
+            {
+                PortalRight = Right;
+                RightIndex = I;
+            }
+            else
+            {
+                Apex = PortalLeft;
+                ApexIndex = LeftIndex;
+                OutPoints.Add(Apex);
+                PortalLeft = PortalRight = Apex;
+                LeftIndex = RightIndex = ApexIndex;
+                I = ApexIndex;
+                continue;
+            }
+        }
+
+        if (Cross(Apex, PortalLeft, Left) <= 0.f)
+        {
+            if (Apex == PortalLeft || Cross(Apex, PortalRight, Left) > 0.f)
+            {
+                PortalLeft = Left;
+                LeftIndex = I;
+            }
+            else
+            {
+                Apex = PortalRight;
+                ApexIndex = RightIndex;
+                OutPoints.Add(Apex);
+                PortalLeft = PortalRight = Apex;
+                LeftIndex = RightIndex = ApexIndex;
+                I = ApexIndex;
+                continue;
+            }
+        }
+    }
+
+    if (OutPoints.Last() != End)
+    {
+        OutPoints.Add(End);
+    }
+}
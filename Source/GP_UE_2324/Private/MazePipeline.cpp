@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazePipeline.h"
+#include "MazeMemory.h"
+#include "HAL/PlatformTime.h"
+#include "Tasks/Task.h"
+
+FString FMazePipelineTimings::ToString() const
+{
+    FString Result = FString::Printf(TEXT("%.2f ms (critical path %.2f ms, stages %.2f ms):"), WallSeconds * 1000.0, CriticalPathSeconds * 1000.0, TotalStageSeconds * 1000.0);
+    for (const FMazeStageTiming& Stage : Stages)
+    {
+        Result += FString::Printf(TEXT(" %s %.2f ms"), Stage.Name, Stage.Duration * 1000.0);
+    }
+    return Result;
+}
+
+void FMazePipeline::AddStage(const TCHAR* Name, EMazeData Inputs, EMazeData Outputs, TUniqueFunction<void()> Work)
+{
+    FStage& Stage = Stages.AddDefaulted_GetRef();
+    Stage.Name = Name;
+    Stage.Inputs = Inputs;
+    Stage.Outputs = Outputs;
+    Stage.Work = MoveTemp(Work);
+
+    for (int32 Earlier = 0; Earlier < Stages.Num() - 1; Earlier++)
+    {
+        const FStage& Other = Stages[Earlier];
+        if (EnumHasAnyFlags(Inputs, Other.Outputs) || EnumHasAnyFlags(Outputs, Other.Inputs | Other.Outputs))
+        {
+            Stage.Prerequisites.Add(Earlier);
+        }
+    }
+}
+
+void FMazePipeline::Run(FMazePipelineTimings* OutTimings, bool bParallel)
+{
+    TArray<FMazeStageTiming> Timings;
+    Timings.SetNum(Stages.Num());
+    TArray<UE::Tasks::FTask> Tasks;
+    Tasks.Reserve(Stages.Num());
+
+    const double StartTime = FPlatformTime::Seconds();
+    for (int32 StageIndex = 0; StageIndex < Stages.Num(); StageIndex++)
+    {
+        //Every task only writes the timing of its own stage
+        FStage& Stage = Stages[StageIndex];
+        FMazeStageTiming& Timing = Timings[StageIndex];
+        auto RunStage = [&Stage, &Timing, StartTime]()
+            {
+                //Workers do not inherit the memory tag of the thread that runs the pipeline
+                LLM_SCOPE_BYTAG(Maze_Topology);
+                const double StageStart = FPlatformTime::Seconds();
+                Stage.Work();
+                Timing.Name = Stage.Name;
+                Timing.Start = StageStart - StartTime;
+                Timing.Duration = FPlatformTime::Seconds() - StageStart;
+            };
+        if (bParallel)
+        {
+            TArray<UE::Tasks::FTask> Prerequisites;
+            for (int32 Prerequisite : Stage.Prerequisites)
+            {
+                Prerequisites.Add(Tasks[Prerequisite]);
+            }
+            Tasks.Add(UE::Tasks::Launch(Stage.Name, MoveTemp(RunStage), Prerequisites));
+        }
+        else
+        {
+            RunStage();
+        }
+    }
+    UE::Tasks::Wait(Tasks);
+
+    if (OutTimings)
+    {
+        OutTimings->WallSeconds = FPlatformTime::Seconds() - StartTime;
+        OutTimings->TotalStageSeconds = 0.0;
+        OutTimings->CriticalPathSeconds = 0.0;
+
+        //Prerequisites are always earlier stages, so one pass in order finds the longest chain
+        TArray<double> Finish;
+        Finish.SetNumZeroed(Stages.Num());
+        for (int32 StageIndex = 0; StageIndex < Stages.Num(); StageIndex++)
+        {
+            for (int32 Prerequisite : Stages[StageIndex].Prerequisites)
+            {
+                Finish[StageIndex] = FMath::Max(Finish[StageIndex], Finish[Prerequisite]);
+            }
+            Finish[StageIndex] += Timings[StageIndex].Duration;
+            OutTimings->CriticalPathSeconds = FMath::Max(OutTimings->CriticalPathSeconds, Finish[StageIndex]);
+            OutTimings->TotalStageSeconds += Timings[StageIndex].Duration;
+        }
+        OutTimings->Stages = MoveTemp(Timings);
+    }
+    Stages.Reset();
+}
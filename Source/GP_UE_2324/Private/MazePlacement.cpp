@@ -0,0 +1,302 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazePlacement.h"
+#include "PathSearch.h"
+#include "MazeScratch.h"
+
+namespace
+{
+    //Steps from every cell to the closest anchor. A new anchor starts a breadth search that only goes on through the
+    //cells it gets closer to, so each search stops where the previous anchors were already as close.
+    //While a Spread rule runs, its allowed cells are also kept in one linked list per distance. Distances only go down,
+    //so the farthest cell is found by lowering the longest distance until a list is not empty
+    struct FSpreadField
+    {
+        const FMazeGrid& Grid;
+        TMazeScratchArray<int32> Distances;
+        TMazeScratchArray<int32> Work;
+
+        TMazeScratchArray<int32> Heads;
+        TMazeScratchArray<int32> Next;
+        TMazeScratchArray<int32> Previous;
+        FMazeScratchBitArray Listed;
+        int32 MaxDistance = 0;
+        bool bListsActive = false;
+
+        explicit FSpreadField(const FMazeGrid& InGrid)
+            : Grid(InGrid)
+        {
+            Distances.Init(MAX_int32, Grid.Num());
+            Work.Reserve(Grid.Num());
+        }
+
+        void AddAnchor(int32 CellIndex)
+        {
+            SetDistance(CellIndex, 0);
+            Work.Reset();
+            Work.Add(CellIndex);
+            for (int32 Head = 0; Head < Work.Num(); Head++)
+            {
+                const int32 Current = Work[Head];
+                Grid.ForEachOpenNeighbour(Current, [&](int32 Neighbour, EDirection Direction)
+                    {
+                        if (Distances[Current] + 1 < Distances[Neighbour])
+                        {
+                            SetDistance(Neighbour, Distances[Current] + 1);
+                            Work.Add(Neighbour);
+                        }
+                    });
+            }
+        }
+
+        //Lists the cells that pass IsAllowed and are not anchors, the lowest index goes first within a distance
+        template<typename PredicateType>
+        void BuildLists(PredicateType&& IsAllowed)
+        {
+            MaxDistance = 0;
+            for (int32 Distance : Distances)
+            {
+                if (Distance != MAX_int32)
+                {
+                    MaxDistance = FMath::Max(MaxDistance, Distance);
+                }
+            }
+            Heads.Init(INDEX_NONE, MaxDistance + 1);
+            Next.SetNumUninitialized(Grid.Num());
+            Previous.SetNumUninitialized(Grid.Num());
+            Listed.Init(false, Grid.Num());
+            bListsActive = true;
+
+            for (int32 CellIndex = Grid.Num() - 1; CellIndex >= 0; CellIndex--)
+            {
+                if (Distances[CellIndex] > 0 && Distances[CellIndex] != MAX_int32 && IsAllowed(CellIndex))
+                {
+                    Link(CellIndex);
+                }
+            }
+        }
+
+        void ClearLists()
+        {
+            bListsActive = false;
+        }
+
+        int32 GetFarthest()
+        {
+            while (MaxDistance > 0 && Heads[MaxDistance] == INDEX_NONE)
+            {
+                MaxDistance--;
+            }
+            return MaxDistance > 0 ? Heads[MaxDistance] : INDEX_NONE;
+        }
+
+    private:
+        void SetDistance(int32 CellIndex, int32 Distance)
+        {
+            const bool bRelink = bListsActive && Listed[CellIndex];
+            if (bRelink)
+            {
+                Unlink(CellIndex);
+            }
+            Distances[CellIndex] = Distance;
+            if (bRelink && Distance > 0)
+            {
+                Link(CellIndex);
+            }
+        }
+
+        void Link(int32 CellIndex)
+        {
+            const int32 Distance = Distances[CellIndex];
+            Next[CellIndex] = Heads[Distance];
+            Previous[CellIndex] = INDEX_NONE;
+            if (Heads[Distance] != INDEX_NONE)
+            {
+                Previous[Heads[Distance]] = CellIndex;
+            }
+            Heads[Distance] = CellIndex;
+            Listed[CellIndex] = true;
+        }
+
+        void Unlink(int32 CellIndex)
+        {
+            if (Previous[CellIndex] != INDEX_NONE)
+            {
+                Next[Previous[CellIndex]] = Next[CellIndex];
+            }
+            else
+            {
+                Heads[Distances[CellIndex]] = Next[CellIndex];
+            }
+            if (Next[CellIndex] != INDEX_NONE)
+            {
+                Previous[Next[CellIndex]] = Previous[CellIndex];
+            }
+            Listed[CellIndex] = false;
+        }
+    };
+
+    //Breadth search from every cell of the path from the start to the exit at once. The parents are the next cell
+    //towards the path, so the cells off the path form trees hanging from it even when the maze has loops
+    void SearchFromExitPath(const FMazeGrid& Grid, int32 StartIndex, int32 ExitIndex, TMazeScratchArray<int32>& OutOrder,
+        TMazeScratchArray<int32>& OutParents, TMazeScratchArray<int32>& OutDistances)
+    {
+        PathSearch::BreadthSearch(Grid, StartIndex, OutOrder, OutParents, OutDistances);
+
+        TMazeScratchArray<int32> PathParents = OutParents;
+        OutOrder.Reset(Grid.Num());
+        OutParents.Init(INDEX_NONE, Grid.Num());
+        OutDistances.Init(INDEX_NONE, Grid.Num());
+        for (int32 CellIndex = ExitIndex; CellIndex != INDEX_NONE; CellIndex = PathParents[CellIndex])
+        {
+            OutDistances[CellIndex] = 0;
+            OutOrder.Add(CellIndex);
+        }
+
+        for (int32 Head = 0; Head < OutOrder.Num(); Head++)
+        {
+            const int32 Current = OutOrder[Head];
+            Grid.ForEachOpenNeighbour(Current, [&](int32 Neighbour, EDirection Direction)
+                {
+                    if (OutDistances[Neighbour] == INDEX_NONE)
+                    {
+                        OutDistances[Neighbour] = OutDistances[Current] + 1;
+                        OutParents[Neighbour] = Current;
+                        OutOrder.Add(Neighbour);
+                    }
+                });
+        }
+    }
+
+    struct FBranch
+    {
+        int32 Length = 0;
+        int32 End = INDEX_NONE;
+    };
+
+    //Long path decomposition of the trees hanging from the path: the height of every cell is computed from the
+    //leaves up and every cell continues the chain of its highest child, so the chains split the cells and the ends
+    //of the longest ones are the ends of the longest distinct branches. Sorted from the longest
+    void GetBranches(const FMazeGrid& Grid, TConstArrayView<int32> Order, TConstArrayView<int32> Parents, TConstArrayView<int32> PathDistances,
+        TMazeScratchArray<FBranch>& OutBranches)
+    {
+        TMazeScratchArray<int32> Heights;
+        TMazeScratchArray<int32> HighestChildren;
+        Heights.Init(0, Grid.Num());
+        HighestChildren.Init(INDEX_NONE, Grid.Num());
+
+        for (int32 I = Order.Num() - 1; I >= 0; I--)
+        {
+            const int32 Current = Order[I];
+            const int32 Parent = Parents[Current];
+            if (Parent != INDEX_NONE && PathDistances[Parent] > 0 && (HighestChildren[Parent] == INDEX_NONE || Heights[Current] + 1 > Heights[Parent]))
+            {
+                Heights[Parent] = Heights[Current] + 1;
+                HighestChildren[Parent] = Current;
+            }
+        }
+
+        OutBranches.Reset();
+        for (int32 Current : Order)
+        {
+            const int32 Parent = Parents[Current];
+            if (Parent == INDEX_NONE || (PathDistances[Parent] > 0 && HighestChildren[Parent] == Current))
+            {
+                continue;
+            }
+
+            FBranch& Branch = OutBranches.AddDefaulted_GetRef();
+            Branch.Length = Heights[Current] + 1;
+            Branch.End = Current;
+            while (HighestChildren[Branch.End] != INDEX_NONE)
+            {
+                Branch.End = HighestChildren[Branch.End];
+            }
+        }
+
+        OutBranches.Sort([](const FBranch& A, const FBranch& B)
+            {
+                return A.Length != B.Length ? A.Length > B.Length : A.End < B.End;
+            });
+    }
+}
+
+void MazePlacement::Place(const FMazeLayout& Layout, TConstArrayView<FMazePlacementRule> Rules, TArray<TArray<int32>>& OutCells)
+{
+    OutCells.Reset();
+    OutCells.SetNum(Rules.Num());
+    const FMazeGrid& Grid = Layout.Grid;
+    if (!Layout.IsValid() || !Grid.IsValidIndex(Layout.ExitIndex))
+    {
+        UE_LOG(LogTemp, Error, TEXT("Error in MazePlacement::Place() the maze has no start or exit"));
+        return;
+    }
+
+    FMazeScratchScope Scratch;
+    TMazeScratchArray<int32> Order;
+    TMazeScratchArray<int32> Parents;
+    TMazeScratchArray<int32> PathDistances;
+    SearchFromExitPath(Grid, Layout.StartIndex, Layout.ExitIndex, Order, Parents, PathDistances);
+
+    //Only built if a rule uses the branches
+    TMazeScratchArray<FBranch> Branches;
+    bool bBranchesBuilt = false;
+
+    //Every placed object is an anchor of the field and Spread picks the allowed cell farthest from all of them
+    FSpreadField Field(Grid);
+    FMazeScratchBitArray Occupied(false, Grid.Num());
+    for (int32 CellIndex : { Layout.StartIndex, Layout.ExitIndex, Layout.KeyIndex })
+    {
+        if (Grid.IsValidIndex(CellIndex) && !Occupied[CellIndex])
+        {
+            Occupied[CellIndex] = true;
+            Field.AddAnchor(CellIndex);
+        }
+    }
+
+    for (int32 RuleIndex = 0; RuleIndex < Rules.Num(); RuleIndex++)
+    {
+        const FMazePlacementRule& Rule = Rules[RuleIndex];
+        TArray<int32>& Cells = OutCells[RuleIndex];
+        const int32 MinPathDistance = FMath::Max(Rule.MinPathDistance, 0);
+
+        auto AddCell = [&](int32 CellIndex)
+            {
+                Cells.Add(CellIndex);
+                Occupied[CellIndex] = true;
+                Field.AddAnchor(CellIndex);
+            };
+
+        if (Rule.Mode == EMazePlacement::Branches)
+        {
+            if (!bBranchesBuilt)
+            {
+                GetBranches(Grid, Order, Parents, PathDistances, Branches);
+                bBranchesBuilt = true;
+            }
+            for (int32 I = 0; I < Branches.Num() && Cells.Num() < Rule.Count; I++)
+            {
+                const int32 End = Branches[I].End;
+                if (!Occupied[End] && PathDistances[End] >= MinPathDistance)
+                {
+                    AddCell(End);
+                }
+            }
+        }
+        else
+        {
+            Field.BuildLists([&PathDistances, MinPathDistance](int32 CellIndex) { return PathDistances[CellIndex] >= MinPathDistance; });
+            while (Cells.Num() < Rule.Count)
+            {
+                const int32 Farthest = Field.GetFarthest();
+                if (Farthest == INDEX_NONE)
+                {
+                    break;
+                }
+                AddCell(Farthest);
+            }
+            Field.ClearLists();
+        }
+    }
+}
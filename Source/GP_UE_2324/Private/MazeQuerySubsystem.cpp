@@ -0,0 +1,150 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeQuerySubsystem.h"
+#include "MazeGenerator.h"
+
+void UMazeQuerySubsystem::RegisterMaze(AMazeGenerator* Maze)
+{
+    ActiveMaze = Maze;
+}
+
+void UMazeQuerySubsystem::UnregisterMaze(AMazeGenerator* Maze)
+{
+    if (ActiveMaze.Get() == Maze)
+    {
+        ActiveMaze.Reset();
+    }
+}
+
+FMatrix UMazeQuerySubsystem::GetWorldToMaze() const
+{
+    const AMazeGenerator* Maze = ActiveMaze.Get();
+    return Maze ? Maze->GetActorTransform().ToInverseMatrixWithScale() : FMatrix::Identity;
+}
+
+FVector2D UMazeQuerySubsystem::ToGridSpace(const FMatrix& WorldToMaze, const FVector& WorldLocation) const
+{
+    const FVector Local = WorldToMaze.TransformPosition(WorldLocation);
+    const float CellSize = ActiveMaze.Get()->GetCellSize();
+    return FVector2D(Local.X / CellSize, Local.Y / CellSize);
+}
+
+int32 UMazeQuerySubsystem::WorldToCell(const FVector& WorldLocation) const
+{
+    const AMazeGenerator* Maze = ActiveMaze.Get();
+    return Maze ? Maze->GetCellAtLocation(WorldLocation) : INDEX_NONE;
+}
+
+FVector UMazeQuerySubsystem::CellToWorld(int32 CellIndex) const
+{
+    const AMazeGenerator* Maze = ActiveMaze.Get();
+    return Maze ? Maze->GetCellWorldLocation(CellIndex) : FVector::ZeroVector;
+}
+
+int32 UMazeQuerySubsystem::GridSpaceToCell(const FMazeGrid& Grid, const FVector2D& Location)
+{
+    const int32 X = FMath::FloorToInt(Location.X);
+    const int32 Y = FMath::FloorToInt(Location.Y);
+    return X >= 0 && Y >= 0 && X < Grid.Width && Y < Grid.Depth ? Grid.GetIndex(X, Y) : INDEX_NONE;
+}
+
+void UMazeQuerySubsystem::WorldToCells(TConstArrayView<FVector> WorldLocations, TArray<int32>& OutCells) const
+{
+    OutCells.Init(INDEX_NONE, WorldLocations.Num());
+    const AMazeGenerator* Maze = ActiveMaze.Get();
+    if (!Maze)
+    {
+        return;
+    }
+
+    const FMazeGrid& Grid = Maze->GetLayout().Grid;
+    const FMatrix WorldToMaze = GetWorldToMaze();
+    for (int32 I = 0; I < WorldLocations.Num(); I++)
+    {
+        OutCells[I] = GridSpaceToCell(Grid, ToGridSpace(WorldToMaze, WorldLocations[I]));
+    }
+}
+
+void UMazeQuerySubsystem::GetActorCells(const TArray<AActor*>& Actors, TArray<int32>& OutCells) const
+{
+    OutCells.Init(INDEX_NONE, Actors.Num());
+    const AMazeGenerator* Maze = ActiveMaze.Get();
+    if (!Maze)
+    {
+        return;
+    }
+
+    const FMazeGrid& Grid = Maze->GetLayout().Grid;
+    const FMatrix WorldToMaze = GetWorldToMaze();
+    for (int32 I = 0; I < Actors.Num(); I++)
+    {
+        if (Actors[I])
+        {
+            OutCells[I] = GridSpaceToCell(Grid, ToGridSpace(WorldToMaze, Actors[I]->GetActorLocation()));
+        }
+    }
+}
+
+bool UMazeQuerySubsystem::HasLineOfSight(const FVector& From, const FVector& To) const
+{
+    const AMazeGenerator* Maze = ActiveMaze.Get();
+    if (!Maze)
+    {
+        return false;
+    }
+
+    const FMatrix WorldToMaze = GetWorldToMaze();
+    return Maze->GetLayout().Grid.HasLineOfSight(ToGridSpace(WorldToMaze, From), ToGridSpace(WorldToMaze, To));
+}
+
+bool UMazeQuerySubsystem::HasCellLineOfSight(int32 FromCell, int32 ToCell) const
+{
+    const AMazeGenerator* Maze = ActiveMaze.Get();
+    if (!Maze)
+    {
+        return false;
+    }
+
+    const FMazeGrid& Grid = Maze->GetLayout().Grid;
+    if (!Grid.IsValidIndex(FromCell) || !Grid.IsValidIndex(ToCell))
+    {
+        return false;
+    }
+    return Grid.HasLineOfSight(FVector2D(Grid.GetX(FromCell) + 0.5f, Grid.GetY(FromCell) + 0.5f), FVector2D(Grid.GetX(ToCell) + 0.5f, Grid.GetY(ToCell) + 0.5f));
+}
+
+bool UMazeQuerySubsystem::CanActorSee(const AActor* Viewer, const AActor* Target) const
+{
+    return Viewer && Target && HasLineOfSight(Viewer->GetActorLocation(), Target->GetActorLocation());
+}
+
+void UMazeQuerySubsystem::HasLineOfSightBatch(const FVector& From, TConstArrayView<FVector> Targets, TBitArray<>& OutVisible) const
+{
+    OutVisible.Init(false, Targets.Num());
+    const AMazeGenerator* Maze = ActiveMaze.Get();
+    if (!Maze)
+    {
+        return;
+    }
+
+    const FMazeGrid& Grid = Maze->GetLayout().Grid;
+    const FMatrix WorldToMaze = GetWorldToMaze();
+    const FVector2D Origin = ToGridSpace(WorldToMaze, From);
+    for (int32 I = 0; I < Targets.Num(); I++)
+    {
+        OutVisible[I] = Grid.HasLineOfSight(Origin, ToGridSpace(WorldToMaze, Targets[I]));
+    }
+}
+
+int32 UMazeQuerySubsystem::FindPath(int32 FromCell, int32 ToCell, TArray<int32>& OutPath)
+{
+    OutPath.Reset();
+    const AMazeGenerator* Maze = ActiveMaze.Get();
+    return Maze ? Pathfinder.FindPath(Maze->GetLayout().Grid, FromCell, ToCell, OutPath) : INDEX_NONE;
+}
+
+void UMazeQuerySubsystem::SetPathCellCosts(const TArray<int32>& CellCosts)
+{
+    Pathfinder.SetCellCosts(CellCosts);
+}
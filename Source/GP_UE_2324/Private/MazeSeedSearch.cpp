@@ -0,0 +1,267 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeSeedSearch.h"
+#include "MazeGeneration.h"
+#include "MazePathfinder.h"
+#include "PathSearch.h"
+#include "Algo/StableSort.h"
+#include "Async/ParallelFor.h"
+#include <atomic>
+
+namespace
+{
+    //Candidates per task, large enough to pay for the search state of the batch
+    constexpr int32 BatchSize = 256;
+
+    bool IsInRange(float Value, float Min, float Max)
+    {
+        return Value >= Min && (Max <= 0.f || Value <= Max);
+    }
+
+    float GetRangeScore(float Value, float Min, float Max)
+    {
+        if (Max <= 0.f || Max <= Min)
+        {
+            return 0.f;
+        }
+        const float HalfWidth = (Max - Min) * 0.5f;
+        return FMath::Abs(Value - (Min + HalfWidth)) / HalfWidth;
+    }
+
+    int32 GetCandidateSeed(int32 FirstSeed, int32 Index)
+    {
+        int64 Seed = (int64)FirstSeed + Index;
+        if (FirstSeed <= 0 && Seed >= 0)
+        {
+            Seed++;
+        }
+        return (int32)Seed;
+    }
+
+    //Search state of one batch, every candidate of the batch reuses its allocations
+    struct FSeedEvaluator
+    {
+        FMazeGrid Grid;
+        TArray<int32> Order;
+        TArray<int32> Parents;
+        TArray<int32> Distances;
+        TBitArray<> OnExitPath;
+        FMazePathfinder Pathfinder;
+
+        //Draws from the stream in the same order as MazeGeneration::BuildLayout up to the start cell, the later stages
+        //do not change the metrics. The cheaper metrics are measured first and with Constraints the candidate is
+        //dropped as soon as one of them fails, leaving the rest of OutMetrics unset
+        bool Evaluate(const FMazeSettings& Settings, const FMazeSeedConstraints* Constraints, FMazeMetrics& OutMetrics)
+        {
+            FRandomStream Stream(Settings.Seed);
+            Grid.Init(Settings.Width, Settings.Depth);
+            MazeGeneration::GenerateEllers(Grid, Stream, Settings.EllersMergeProb);
+            if (Settings.BraidFactor > 0.f)
+            {
+                MazeGeneration::Braid(Grid, Stream, Settings.BraidFactor);
+            }
+            const int32 StartIndex = Stream.RandRange(0, Settings.Width - 1);
+
+            OutMetrics = FMazeMetrics();
+            OutMetrics.NumCells = Grid.Num();
+            for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+            {
+                if (Grid.GetOpenCount(CellIndex) == 1)
+                {
+                    OutMetrics.DeadEnds++;
+                }
+            }
+            OutMetrics.DeadEndRatio = Grid.Num() > 0 ? (float)OutMetrics.DeadEnds / Grid.Num() : 0.f;
+            if (Constraints && !IsInRange(OutMetrics.DeadEndRatio, Constraints->MinDeadEndRatio, Constraints->MaxDeadEndRatio))
+            {
+                return false;
+            }
+
+            PathSearch::BreadthSearch(Grid, StartIndex, Order, Parents, Distances);
+            const int32 ExitIndex = Order.Num() > 0 ? Order.Last() : INDEX_NONE;
+            if (!Grid.IsValidIndex(ExitIndex))
+            {
+                return !Constraints || Constraints->IsSatisfied(OutMetrics);
+            }
+            OutMetrics.SolutionLength = Distances[ExitIndex];
+            if (Constraints && !IsInRange(OutMetrics.SolutionLength, Constraints->MinSolutionLength, Constraints->MaxSolutionLength))
+            {
+                return false;
+            }
+
+            const int32 KeyIndex = PathSearch::GetExitAndKey(Grid, Order, Parents).Value;
+            if (!Grid.IsValidIndex(KeyIndex))
+            {
+                return !Constraints || Constraints->IsSatisfied(OutMetrics);
+            }
+            OutMetrics.KeyDistance = Distances[KeyIndex];
+
+            //Without loops the only path from the key to the exit goes up the search tree to the exit path
+            if (Settings.BraidFactor > 0.f)
+            {
+                OutMetrics.KeyExitDistance = Pathfinder.GetPathCost(Grid, KeyIndex, ExitIndex);
+            }
+            else
+            {
+                OnExitPath.Init(false, Grid.Num());
+                for (int32 CellIndex = ExitIndex; CellIndex != INDEX_NONE; CellIndex = Parents[CellIndex])
+                {
+                    OnExitPath[CellIndex] = true;
+                }
+                int32 Junction = KeyIndex;
+                while (!OnExitPath[Junction])
+                {
+                    Junction = Parents[Junction];
+                }
+                OutMetrics.KeyExitDistance = Distances[KeyIndex] + Distances[ExitIndex] - 2 * Distances[Junction];
+            }
+            return !Constraints || Constraints->IsSatisfied(OutMetrics);
+        }
+    };
+}
+
+bool FMazeSeedConstraints::IsSatisfied(const FMazeMetrics& Metrics) const
+{
+    return IsInRange(Metrics.SolutionLength, MinSolutionLength, MaxSolutionLength)
+        && IsInRange(Metrics.DeadEndRatio, MinDeadEndRatio, MaxDeadEndRatio)
+        && IsInRange(Metrics.KeyExitDistance, MinKeyExitDistance, MaxKeyExitDistance);
+}
+
+float FMazeSeedConstraints::GetScore(const FMazeMetrics& Metrics) const
+{
+    const int32 NumBounded = (MaxSolutionLength > 0 ? 1 : 0) + (MaxDeadEndRatio > 0.f ? 1 : 0) + (MaxKeyExitDistance > 0 ? 1 : 0);
+    if (NumBounded == 0)
+    {
+        return 0.f;
+    }
+
+    const float Score = GetRangeScore(Metrics.SolutionLength, MinSolutionLength, MaxSolutionLength)
+        + GetRangeScore(Metrics.DeadEndRatio, MinDeadEndRatio, MaxDeadEndRatio)
+        + GetRangeScore(Metrics.KeyExitDistance, MinKeyExitDistance, MaxKeyExitDistance);
+    return Score / NumBounded;
+}
+
+void MazeSeedSearch::EvaluateSeed(const FMazeSettings& Settings, FMazeMetrics& OutMetrics)
+{
+    FMazeSettings ValidSettings = Settings;
+    ValidSettings.Validate();
+
+    FSeedEvaluator Evaluator;
+    Evaluator.Evaluate(ValidSettings, nullptr, OutMetrics);
+}
+
+//Batches past the first match found so far stop early, the match of the lowest batch is the result
+bool MazeSeedSearch::FindFirstSeed(const FMazeSettings& Settings, const FMazeSeedConstraints& Constraints, int32 NumCandidates, FMazeSeedCandidate& OutResult)
+{
+    FMazeSettings ValidSettings = Settings;
+    ValidSettings.Validate();
+
+    const int32 NumBatches = FMath::DivideAndRoundUp(FMath::Max(NumCandidates, 0), BatchSize);
+    TArray<FMazeSeedCandidate> BatchResults;
+    BatchResults.SetNum(NumBatches);
+    std::atomic<int32> FirstFound(MAX_int32);
+
+    ParallelFor(NumBatches, [&](int32 Batch)
+        {
+            FSeedEvaluator Evaluator;
+            FMazeSettings CandidateSettings = ValidSettings;
+            FMazeMetrics Metrics;
+            const int32 LastIndex = FMath::Min((Batch + 1) * BatchSize, NumCandidates);
+
+            for (int32 Index = Batch * BatchSize; Index < LastIndex && Index < FirstFound.load(std::memory_order_relaxed); Index++)
+            {
+                CandidateSettings.Seed = GetCandidateSeed(ValidSettings.Seed, Index);
+                if (!Evaluator.Evaluate(CandidateSettings, &Constraints, Metrics))
+                {
+                    continue;
+                }
+
+                BatchResults[Batch].Seed = CandidateSettings.Seed;
+                BatchResults[Batch].Score = Constraints.GetScore(Metrics);
+                BatchResults[Batch].Metrics = Metrics;
+
+                int32 Found = FirstFound.load(std::memory_order_relaxed);
+                while (Index < Found && !FirstFound.compare_exchange_weak(Found, Index))
+                {
+                }
+                break;
+            }
+        });
+
+    const int32 Found = FirstFound.load();
+    if (Found == MAX_int32)
+    {
+        return false;
+    }
+    OutResult = BatchResults[Found / BatchSize];
+    return true;
+}
+
+//Every batch keeps its own best candidates, they are merged once all the batches are done
+void MazeSeedSearch::FindBestSeeds(const FMazeSettings& Settings, const FMazeSeedConstraints& Constraints, int32 NumCandidates, int32 NumBest, TArray<FMazeSeedCandidate>& OutResults)
+{
+    OutResults.Reset();
+    if (NumBest <= 0)
+    {
+        return;
+    }
+
+    FMazeSettings ValidSettings = Settings;
+    ValidSettings.Validate();
+
+    const int32 NumBatches = FMath::DivideAndRoundUp(FMath::Max(NumCandidates, 0), BatchSize);
+    TArray<TArray<FMazeSeedCandidate>> BatchResults;
+    BatchResults.SetNum(NumBatches);
+
+    ParallelFor(NumBatches, [&](int32 Batch)
+        {
+            FSeedEvaluator Evaluator;
+            FMazeSettings CandidateSettings = ValidSettings;
+            FMazeMetrics Metrics;
+            TArray<FMazeSeedCandidate>& Best = BatchResults[Batch];
+            Best.Reserve(NumBest + 1);
+            const int32 LastIndex = FMath::Min((Batch + 1) * BatchSize, NumCandidates);
+
+            for (int32 Index = Batch * BatchSize; Index < LastIndex; Index++)
+            {
+                CandidateSettings.Seed = GetCandidateSeed(ValidSettings.Seed, Index);
+                if (!Evaluator.Evaluate(CandidateSettings, &Constraints, Metrics))
+                {
+                    continue;
+                }
+
+                const float Score = Constraints.GetScore(Metrics);
+                if (Best.Num() == NumBest && Score >= Best.Last().Score)
+                {
+                    continue;
+                }
+
+                //Inserted after the candidates with the same score so earlier seeds win ties
+                int32 Position = Best.Num();
+                while (Position > 0 && Best[Position - 1].Score > Score)
+                {
+                    Position--;
+                }
+                FMazeSeedCandidate Candidate;
+                Candidate.Seed = CandidateSettings.Seed;
+                Candidate.Score = Score;
+                Candidate.Metrics = Metrics;
+                Best.Insert(Candidate, Position);
+                if (Best.Num() > NumBest)
+                {
+                    Best.Pop(false);
+                }
+            }
+        });
+
+    for (const TArray<FMazeSeedCandidate>& Best : BatchResults)
+    {
+        OutResults.Append(Best);
+    }
+    Algo::StableSortBy(OutResults, &FMazeSeedCandidate::Score);
+    if (OutResults.Num() > NumBest)
+    {
+        OutResults.SetNum(NumBest);
+    }
+}
@@ -0,0 +1,360 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeSimulation.h"
+#include "Async/ParallelFor.h"
+
+namespace
+{
+    //Agents per task, enough to pay for the visit stamps of a large maze
+    constexpr int32 AgentBlockSize = 64;
+
+    //Directions in counterclockwise order seen from above: +X, +Y, -X, -Y
+    constexpr EDirection TurnOrder[] = { EDirection::Left, EDirection::Top, EDirection::Right, EDirection::Bottom };
+
+    int32 GetMaxSteps(const FMazeGrid& Grid, int32 MaxSteps)
+    {
+        return MaxSteps > 0 ? MaxSteps : (int32)FMath::Min<int64>((int64)Grid.Num() * 100, MAX_int32);
+    }
+
+    int32 GetAgentSeed(int32 Seed, int32 AgentIndex)
+    {
+        return (int32)HashCombine(GetTypeHash(Seed), GetTypeHash(AgentIndex));
+    }
+
+    //State reused by the agents of one block. Cells visited by the current agent have its stamp,
+    //so the memory of the explorer never has to be cleared between agents
+    struct FAgentRunner
+    {
+        const FMazeGrid& Grid;
+        int32 Offsets[FMazeGrid::NumDirections];
+        //Steps the agents of this runner moved so far, solved or not
+        int64 SimulatedSteps = 0;
+        TArray<uint32> Visited;
+        TArray<uint32> Searched;
+        TArray<int32> Stack;
+        TArray<int32> Work;
+        TArray<int32> Distances;
+        uint32 Stamp = 0;
+
+        explicit FAgentRunner(const FMazeGrid& InGrid)
+            : Grid(InGrid)
+        {
+            for (int32 Dir = 0; Dir < FMazeGrid::NumDirections; Dir++)
+            {
+                const EDirection Direction = (EDirection)Dir;
+                Offsets[Dir] = Direction == EDirection::Left ? 1 : Direction == EDirection::Right ? -1 : Direction == EDirection::Top ? Grid.Width : -Grid.Width;
+            }
+        }
+
+        int32 Run(int32 StartIndex, int32 KeyIndex, int32 ExitIndex, EMazeAgentPolicy Policy, int32 AgentSeed, int32 MaxSteps)
+        {
+            FRandomStream Stream(AgentSeed);
+            switch (Policy)
+            {
+            case EMazeAgentPolicy::RandomWalk:
+                return RunRandomWalk(StartIndex, KeyIndex, ExitIndex, Stream, MaxSteps);
+            case EMazeAgentPolicy::WallFollower:
+                return RunWallFollower(StartIndex, KeyIndex, ExitIndex, MaxSteps);
+            default:
+                return RunExplorer(StartIndex, KeyIndex, ExitIndex, Stream, MaxSteps);
+            }
+        }
+
+    private:
+        int32 RunRandomWalk(int32 Current, int32 KeyIndex, int32 ExitIndex, FRandomStream& Stream, int32 MaxSteps)
+        {
+            bool bHasKey = Current == KeyIndex;
+            int32 Previous = INDEX_NONE;
+            int32 Options[FMazeGrid::NumDirections];
+            for (int32 Steps = 1; Steps <= MaxSteps; Steps++)
+            {
+                const uint8 Open = Grid.Cells[Current];
+                int32 NumOptions = 0;
+                for (int32 Dir = 0; Dir < FMazeGrid::NumDirections; Dir++)
+                {
+                    if ((Open & (1 << Dir)) && Current + Offsets[Dir] != Previous)
+                    {
+                        Options[NumOptions++] = Current + Offsets[Dir];
+                    }
+                }
+
+                const int32 Next = NumOptions > 0 ? Options[NumOptions > 1 ? Stream.RandHelper(NumOptions) : 0] : Previous;
+                if (Next == INDEX_NONE)
+                {
+                    SimulatedSteps += Steps - 1;
+                    return INDEX_NONE;
+                }
+                Previous = Current;
+                Current = Next;
+
+                bHasKey |= Current == KeyIndex;
+                if (bHasKey && Current == ExitIndex)
+                {
+                    SimulatedSteps += Steps;
+                    return Steps;
+                }
+            }
+            SimulatedSteps += MaxSteps;
+            return INDEX_NONE;
+        }
+
+        int32 RunWallFollower(int32 Current, int32 KeyIndex, int32 ExitIndex, int32 MaxSteps)
+        {
+            bool bHasKey = Current == KeyIndex;
+            //Facing into the maze from the first row
+            int32 Heading = 1;
+            for (int32 Steps = 1; Steps <= MaxSteps; Steps++)
+            {
+                const uint8 Open = Grid.Cells[Current];
+                if (Open == 0)
+                {
+                    SimulatedSteps += Steps - 1;
+                    return INDEX_NONE;
+                }
+
+                //Left, straight, right and back
+                for (int32 Turn : { 1, 0, 3, 2 })
+                {
+                    const int32 NextHeading = (Heading + Turn) % 4;
+                    if (Open & FMazeGrid::GetMask(TurnOrder[NextHeading]))
+                    {
+                        Heading = NextHeading;
+                        break;
+                    }
+                }
+                Current += Offsets[(int32)TurnOrder[Heading]];
+
+                bHasKey |= Current == KeyIndex;
+                if (bHasKey && Current == ExitIndex)
+                {
+                    SimulatedSteps += Steps;
+                    return Steps;
+                }
+            }
+            SimulatedSteps += MaxSteps;
+            return INDEX_NONE;
+        }
+
+        int32 RunExplorer(int32 Current, int32 KeyIndex, int32 ExitIndex, FRandomStream& Stream, int32 MaxSteps)
+        {
+            if (Visited.Num() != Grid.Num())
+            {
+                Visited.Init(0, Grid.Num());
+                Searched.Init(0, Grid.Num());
+                Distances.SetNumUninitialized(Grid.Num());
+            }
+            Stamp++;
+            Stack.Reset();
+            Visited[Current] = Stamp;
+
+            bool bHasKey = Current == KeyIndex;
+            int32 Options[FMazeGrid::NumDirections];
+            int32 Steps = 0;
+            while (Steps < MaxSteps)
+            {
+                //The way to the exit is solved by one search instead of being stepped, it counts in the steps of the
+                //agent but not in the simulated ones
+                if (bHasKey && Visited[ExitIndex] == Stamp)
+                {
+                    SimulatedSteps += Steps;
+                    const int32 Distance = GetKnownDistance(Current, ExitIndex);
+                    return Steps + Distance <= MaxSteps ? Steps + Distance : INDEX_NONE;
+                }
+
+                const uint8 Open = Grid.Cells[Current];
+                int32 NumOptions = 0;
+                for (int32 Dir = 0; Dir < FMazeGrid::NumDirections; Dir++)
+                {
+                    if ((Open & (1 << Dir)) && Visited[Current + Offsets[Dir]] != Stamp)
+                    {
+                        Options[NumOptions++] = Current + Offsets[Dir];
+                    }
+                }
+
+                if (NumOptions > 0)
+                {
+                    Stack.Add(Current);
+                    Current = Options[NumOptions > 1 ? Stream.RandHelper(NumOptions) : 0];
+                    Visited[Current] = Stamp;
+                }
+                else if (Stack.Num() > 0)
+                {
+                    Current = Stack.Pop(false);
+                }
+                else
+                {
+                    SimulatedSteps += Steps;
+                    return INDEX_NONE;
+                }
+                Steps++;
+                bHasKey |= Current == KeyIndex;
+            }
+            SimulatedSteps += Steps;
+            return INDEX_NONE;
+        }
+
+        //Breadth search over the cells the agent visited, only run once per agent
+        int32 GetKnownDistance(int32 From, int32 To)
+        {
+            Work.Reset();
+            Work.Add(From);
+            Searched[From] = Stamp;
+            Distances[From] = 0;
+            for (int32 Head = 0; Head < Work.Num(); Head++)
+            {
+                const int32 Current = Work[Head];
+                if (Current == To)
+                {
+                    return Distances[Current];
+                }
+                const uint8 Open = Grid.Cells[Current];
+                for (int32 Dir = 0; Dir < FMazeGrid::NumDirections; Dir++)
+                {
+                    const int32 Next = Current + Offsets[Dir];
+                    if ((Open & (1 << Dir)) && Visited[Next] == Stamp && Searched[Next] != Stamp)
+                    {
+                        Searched[Next] = Stamp;
+                        Distances[Next] = Distances[Current] + 1;
+                        Work.Add(Next);
+                    }
+                }
+            }
+            return 0;
+        }
+    };
+
+    void GetStats(TArray<int32>& Steps, int64 SimulatedSteps, FMazeSolveStats& OutStats)
+    {
+        OutStats = FMazeSolveStats();
+        OutStats.NumAgents = Steps.Num();
+        OutStats.SimulatedSteps = SimulatedSteps;
+
+        int32 NumSolved = 0;
+        int64 SolvedSteps = 0;
+        for (int32 AgentSteps : Steps)
+        {
+            if (AgentSteps != INDEX_NONE)
+            {
+                Steps[NumSolved++] = AgentSteps;
+                SolvedSteps += AgentSteps;
+            }
+        }
+        Steps.SetNum(NumSolved, false);
+        OutStats.NumSolved = NumSolved;
+        if (NumSolved == 0)
+        {
+            return;
+        }
+
+        Steps.Sort();
+        auto GetPercentile = [&Steps](int32 Percent) { return Steps[FMath::Min(Steps.Num() * Percent / 100, Steps.Num() - 1)]; };
+        OutStats.MeanSteps = (float)((double)SolvedSteps / NumSolved);
+        OutStats.MinSteps = Steps[0];
+        OutStats.P10Steps = GetPercentile(10);
+        OutStats.MedianSteps = GetPercentile(50);
+        OutStats.P90Steps = GetPercentile(90);
+        OutStats.MaxSteps = Steps.Last();
+    }
+}
+
+int32 MazeSimulation::RunAgent(const FMazeLayout& Layout, EMazeAgentPolicy Policy, int32 AgentSeed, int32 MaxSteps)
+{
+    const FMazeGrid& Grid = Layout.Grid;
+    if (!Layout.IsValid() || !Grid.IsValidIndex(Layout.ExitIndex) || !Grid.IsValidIndex(Layout.KeyIndex))
+    {
+        UE_LOG(LogTemp, Error, TEXT("Error in MazeSimulation::RunAgent() the maze has no start, exit or key"));
+        return INDEX_NONE;
+    }
+
+    FAgentRunner Runner(Grid);
+    return Runner.Run(Layout.StartIndex, Layout.KeyIndex, Layout.ExitIndex, Policy, AgentSeed, GetMaxSteps(Grid, MaxSteps));
+}
+
+void MazeSimulation::Simulate(const FMazeLayout& Layout, const FMazeSimulationSettings& Settings, FMazeSolveStats& OutStats, bool bParallel)
+{
+    if (!bParallel)
+    {
+        OutStats = FMazeSolveStats();
+        const FMazeGrid& Grid = Layout.Grid;
+        if (!Layout.IsValid() || !Grid.IsValidIndex(Layout.ExitIndex) || !Grid.IsValidIndex(Layout.KeyIndex))
+        {
+            UE_LOG(LogTemp, Error, TEXT("Error in MazeSimulation::Simulate() the maze has no start, exit or key"));
+            return;
+        }
+
+        FAgentRunner Runner(Grid);
+        const int32 MaxSteps = GetMaxSteps(Grid, Settings.MaxSteps);
+        TArray<int32> Steps;
+        Steps.SetNumUninitialized(FMath::Max(Settings.NumAgents, 0));
+        for (int32 Agent = 0; Agent < Steps.Num(); Agent++)
+        {
+            Steps[Agent] = Runner.Run(Layout.StartIndex, Layout.KeyIndex, Layout.ExitIndex, Settings.Policy, GetAgentSeed(Settings.Seed, Agent), MaxSteps);
+        }
+        GetStats(Steps, Runner.SimulatedSteps, OutStats);
+        return;
+    }
+
+    TArray<FMazeSolveStats> Stats;
+    const FMazeLayout* Layouts[] = { &Layout };
+    Simulate(Layouts, Settings, Stats);
+    OutStats = Stats[0];
+}
+
+void MazeSimulation::Simulate(TConstArrayView<const FMazeLayout*> Layouts, const FMazeSimulationSettings& Settings, TArray<FMazeSolveStats>& OutStats)
+{
+    const int32 NumAgents = FMath::Max(Settings.NumAgents, 0);
+    const int32 BlocksPerLayout = FMath::DivideAndRoundUp(NumAgents, AgentBlockSize);
+
+    //Every agent writes its own slot and every block its own count of simulated steps, the stats are computed once all
+    //of them are done
+    TArray<TArray<int32>> Steps;
+    Steps.SetNum(Layouts.Num());
+    TArray<int64> BlockSteps;
+    BlockSteps.Init(0, Layouts.Num() * BlocksPerLayout);
+    for (int32 LayoutIndex = 0; LayoutIndex < Layouts.Num(); LayoutIndex++)
+    {
+        const FMazeLayout& Layout = *Layouts[LayoutIndex];
+        if (Layout.IsValid() && Layout.Grid.IsValidIndex(Layout.ExitIndex) && Layout.Grid.IsValidIndex(Layout.KeyIndex))
+        {
+            Steps[LayoutIndex].Init(INDEX_NONE, NumAgents);
+        }
+        else
+        {
+            UE_LOG(LogTemp, Error, TEXT("Error in MazeSimulation::Simulate() maze %d has no start, exit or key, it was skipped"), LayoutIndex);
+        }
+    }
+
+    ParallelFor(Layouts.Num() * BlocksPerLayout, [&](int32 Block)
+        {
+            const int32 LayoutIndex = Block / BlocksPerLayout;
+            if (Steps[LayoutIndex].Num() == 0)
+            {
+                return;
+            }
+
+            const FMazeLayout& Layout = *Layouts[LayoutIndex];
+            const FMazeGrid& Grid = Layout.Grid;
+
+            FAgentRunner Runner(Grid);
+            const int32 MaxSteps = GetMaxSteps(Grid, Settings.MaxSteps);
+            const int32 FirstAgent = (Block % BlocksPerLayout) * AgentBlockSize;
+            const int32 LastAgent = FMath::Min(FirstAgent + AgentBlockSize, NumAgents);
+            for (int32 Agent = FirstAgent; Agent < LastAgent; Agent++)
+            {
+                Steps[LayoutIndex][Agent] = Runner.Run(Layout.StartIndex, Layout.KeyIndex, Layout.ExitIndex, Settings.Policy, GetAgentSeed(Settings.Seed, Agent), MaxSteps);
+            }
+            BlockSteps[Block] = Runner.SimulatedSteps;
+        });
+
+    OutStats.SetNum(Layouts.Num());
+    for (int32 LayoutIndex = 0; LayoutIndex < Layouts.Num(); LayoutIndex++)
+    {
+        int64 SimulatedSteps = 0;
+        for (int32 Block = LayoutIndex * BlocksPerLayout; Block < (LayoutIndex + 1) * BlocksPerLayout; Block++)
+        {
+            SimulatedSteps += BlockSteps[Block];
+        }
+        GetStats(Steps[LayoutIndex], SimulatedSteps, OutStats[LayoutIndex]);
+    }
+}
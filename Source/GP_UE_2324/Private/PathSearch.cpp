@@ -2,7 +2,6 @@
 
 
 #include "PathSearch.h"
-#include "MazeGenerator.h"
 
 
 TPair<AMazeCell*, AMazeCell*> PathSearch::GetExitAndKey(const TArray<AMazeCell*>& MazeGrid, AMazeCell* StartCell)
@@ -16,32 +15,31 @@ TPair<AMazeCell*, AMazeCell*> PathSearch::GetExitAndKey(const TArray<AMazeCell*>
 //whole maze is already searched
 TPair<TArray<AMazeCell*>, AMazeCell*> PathSearch::BreadthSearchExit(AMazeCell* StartCell)
 {
+    FMazeScratchScope Scratch;
     TArray<AMazeCell*> Result;
     TSet<AMazeCell*> Visited;
-    TQueue<AMazeCell*> Work;
+    TMazeScratchArray<AMazeCell*> Work;
 
     Visited.Add(StartCell);
-    Work.Enqueue(StartCell);
+    Work.Add(StartCell);
 
-    while (!Work.IsEmpty())
+    for (int32 Head = 0; Head < Work.Num(); Head++)
     {
-        AMazeCell* Current;
-        Work.Dequeue(Current);
-        TArray<AMazeCell*> CurrentNeighbours = Current->GetNeighbours();
+        AMazeCell* Current = Work[Head];
+        const TArray<AMazeCell*>& CurrentNeighbours = Current->GetNeighbours();
 
         for (AMazeCell* Neighbour : CurrentNeighbours)
         {
             if (!Visited.Contains(Neighbour))
             {
-                AMazeGenerator::GenerateCellMesh(Current, Neighbour);
                 Neighbour->SetHistory(Current->GetHistory());
                 Neighbour->AddHistory(Current);
                 Visited.Add(Neighbour);
-                Work.Enqueue(Neighbour);
+                Work.Add(Neighbour);
             }
         }
 
-        if (Work.IsEmpty())
+        if (Head == Work.Num() - 1)
         {
             Result = Current->GetHistory();
             Result.Add(Current);
@@ -66,7 +64,7 @@ AMazeCell* PathSearch::GetKeyCell(const TArray<AMazeCell*>& MazeGrid, const TArr
 
     for (AMazeCell* CurrentCell : MazeGrid)
     {
-        TArray <AMazeCell*> CurrentCellHistory = CurrentCell->GetHistory();
+        const TArray<AMazeCell*>& CurrentCellHistory = CurrentCell->GetHistory();
         int32 countNotInExit = 0;
 
         for (AMazeCell* CellinHistory : CurrentCellHistory)
@@ -98,17 +96,18 @@ AMazeCell* PathSearch::GetClosestVoronoid(const TArray<AMazeCell*>& MazeGrid, AM
         return Start;
     }
 
-    TArray<AMazeCell*> CloseVors;
+    FMazeScratchScope Scratch;
+    TMazeScratchArray<AMazeCell*> CloseVors;
     TSet<AMazeCell*> Visited;
-    TQueue<AMazeCell*> Work;
+    TMazeScratchArray<AMazeCell*> Work;
+    Work.Reserve(MazeGrid.Num());
 
     Visited.Add(Start);
-    Work.Enqueue(Start);
+    Work.Add(Start);
 
-    while (true)
+    for (int32 Head = 0; Head < Work.Num(); Head++)
     {
-        AMazeCell* Current;
-        Work.Dequeue(Current);
+        AMazeCell* Current = Work[Head];
 
         if (VoronoidPoints.Contains(Current) || CloseVors.Num() > 0)
         {
@@ -116,7 +115,7 @@ AMazeCell* PathSearch::GetClosestVoronoid(const TArray<AMazeCell*>& MazeGrid, AM
         }
         else
         {
-            TArray<AMazeCell*> CurrentNeighbours = Current->GetNeighbours();
+            const TArray<AMazeCell*>& CurrentNeighbours = Current->GetNeighbours();
 
             for (AMazeCell* Neighbour : CurrentNeighbours)
             {
@@ -131,7 +130,7 @@ AMazeCell* PathSearch::GetClosestVoronoid(const TArray<AMazeCell*>& MazeGrid, AM
                     }
 
                     Visited.Add(Neighbour);
-                    Work.Enqueue(Neighbour);
+                    Work.Add(Neighbour);
                 }
             }
         }
@@ -144,13 +143,13 @@ AMazeCell* PathSearch::GetClosestVoronoid(const TArray<AMazeCell*>& MazeGrid, AM
     else
     {
         AMazeCell* ClosestVor = nullptr;
-        TArray<AMazeCell*> Neighbours = Start->GetNeighbours();
+        const TArray<AMazeCell*>& Neighbours = Start->GetNeighbours();
         FColor MaxNeighboursColor = FColor::Black;
 
         if (Neighbours.Num() > 1)
         {
-            TArray<int32> ColorsCount;
-            TArray<FColor> Colors;
+            TMazeScratchArray<int32> ColorsCount;
+            TMazeScratchArray<FColor> Colors;
 
             for (AMazeCell* Neighbour : Neighbours)
             {
@@ -212,5 +211,145 @@ AMazeCell* PathSearch::GetClosestVoronoid(const TArray<AMazeCell*>& MazeGrid, AM
     }
 }
 
+//Breadth search over the grid, the order lists every reached cell after its parent
+template<typename AllocatorType>
+static void BreadthSearchGrid(const FMazeGrid& Grid, int32 StartIndex, TArray<int32, AllocatorType>& OutOrder, TArray<int32, AllocatorType>& OutParents, TArray<int32, AllocatorType>& OutDistances)
+{
+    OutOrder.Reset(Grid.Num());
+    OutParents.Init(INDEX_NONE, Grid.Num());
+    OutDistances.Init(INDEX_NONE, Grid.Num());
+
+    if (!Grid.IsValidIndex(StartIndex))
+    {
+        UE_LOG(LogTemp, Error, TEXT("Error in PathSearch::BreadthSearch() invalid start: %d"), StartIndex);
+        return;
+    }
+
+    OutDistances[StartIndex] = 0;
+    OutOrder.Add(StartIndex);
+
+    for (int32 Head = 0; Head < OutOrder.Num(); Head++)
+    {
+        const int32 Current = OutOrder[Head];
+        Grid.ForEachOpenNeighbour(Current, [&](int32 Neighbour, EDirection Direction)
+            {
+                if (OutDistances[Neighbour] == INDEX_NONE)
+                {
+                    OutDistances[Neighbour] = OutDistances[Current] + 1;
+                    OutParents[Neighbour] = Current;
+                    OutOrder.Add(Neighbour);
+                }
+            });
+    }
+}
+
+void PathSearch::BreadthSearch(const FMazeGrid& Grid, int32 StartIndex, TArray<int32>& OutOrder, TArray<int32>& OutParents, TArray<int32>& OutDistances)
+{
+    BreadthSearchGrid(Grid, StartIndex, OutOrder, OutParents, OutDistances);
+}
+
+//Same search into scratch arrays, the caller owns the scratch scope
+void PathSearch::BreadthSearch(const FMazeGrid& Grid, int32 StartIndex, TMazeScratchArray<int32>& OutOrder, TMazeScratchArray<int32>& OutParents, TMazeScratchArray<int32>& OutDistances)
+{
+    BreadthSearchGrid(Grid, StartIndex, OutOrder, OutParents, OutDistances);
+}
+
+//The exit is the last cell reached by the breadth search. The key is the cell farthest from the exit path, found with
+//one breadth search from every cell of that path. Without loops this is the cell with the most cells of its path from
+//the start outside of the exit path, and with loops it is still the cell that needs the longest detour
+TPair<int32, int32> PathSearch::GetExitAndKey(const FMazeGrid& Grid, int32 StartIndex)
+{
+    FMazeScratchScope Scratch;
+    TMazeScratchArray<int32> Order;
+    TMazeScratchArray<int32> Parents;
+    TMazeScratchArray<int32> Distances;
+    BreadthSearch(Grid, StartIndex, Order, Parents, Distances);
+    return GetExitAndKey(Grid, Order, Parents);
+}
+
+//Same as above from an existing breadth search of the whole maze
+TPair<int32, int32> PathSearch::GetExitAndKey(const FMazeGrid& Grid, TConstArrayView<int32> Order, TConstArrayView<int32> Parents)
+{
+    if (Order.Num() == 0 || Parents.Num() != Grid.Num())
+    {
+        UE_LOG(LogTemp, Error, TEXT("Error in PathSearch::GetExitAndKey()"));
+        return TPair<int32, int32>(INDEX_NONE, INDEX_NONE);
+    }
+
+    const int32 ExitIndex = Order.Last();
+
+    FMazeScratchScope Scratch;
+    TMazeScratchArray<int32> Work;
+    TMazeScratchArray<int32> ExitPathDistances;
+    Work.Reserve(Grid.Num());
+    ExitPathDistances.Init(INDEX_NONE, Grid.Num());
+    for (int32 CellIndex = ExitIndex; CellIndex != INDEX_NONE; CellIndex = Parents[CellIndex])
+    {
+        ExitPathDistances[CellIndex] = 0;
+        Work.Add(CellIndex);
+    }
 
+    for (int32 Head = 0; Head < Work.Num(); Head++)
+    {
+        const int32 Current = Work[Head];
+        Grid.ForEachOpenNeighbour(Current, [&](int32 Neighbour, EDirection Direction)
+            {
+                if (ExitPathDistances[Neighbour] == INDEX_NONE)
+                {
+                    ExitPathDistances[Neighbour] = ExitPathDistances[Current] + 1;
+                    Work.Add(Neighbour);
+                }
+            });
+    }
+
+    //Cells right next to the exit path are too close to it to hold the key
+    int32 KeyIndex = INDEX_NONE;
+    int32 CountCellsKey = 1;
+    for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+    {
+        if (ExitPathDistances[CellIndex] > CountCellsKey)
+        {
+            CountCellsKey = ExitPathDistances[CellIndex];
+            KeyIndex = CellIndex;
+        }
+    }
+
+    if (KeyIndex == INDEX_NONE) {
+        UE_LOG(LogTemp, Error, TEXT("KeyCell is null"));
+    }
+
+    return TPair<int32, int32>(ExitIndex, KeyIndex);
+}
 
+//One breadth search from all the voronoid points at once, every cell takes the region of the point that reaches it first
+void PathSearch::GetClosestVoronoids(const FMazeGrid& Grid, TConstArrayView<int32> VoronoidPoints, TArray<int32>& OutRegions)
+{
+    OutRegions.Init(INDEX_NONE, Grid.Num());
+
+    FMazeScratchScope Scratch;
+    TMazeScratchArray<int32> Work;
+    Work.Reserve(Grid.Num());
+
+    for (int32 Region = 0; Region < VoronoidPoints.Num(); Region++)
+    {
+        const int32 Point = VoronoidPoints[Region];
+        if (Grid.IsValidIndex(Point) && OutRegions[Point] == INDEX_NONE)
+        {
+            OutRegions[Point] = Region;
+            Work.Add(Point);
+        }
+    }
+
+    for (int32 Head = 0; Head < Work.Num(); Head++)
+    {
+        const int32 Current = Work[Head];
+        Grid.ForEachOpenNeighbour(Current, [&](int32 Neighbour, EDirection Direction)
+            {
+                if (OutRegions[Neighbour] == INDEX_NONE)
+                {
+                    OutRegions[Neighbour] = OutRegions[Current];
+                    Work.Add(Neighbour);
+                }
+            });
+    }
+}
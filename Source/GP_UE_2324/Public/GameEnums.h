@@ -30,3 +30,18 @@ enum class EVert : uint8
 	LeftTop UMETA(DisplayName = "Left Top"),
 	RightTop UMETA(DisplayName = "Right Top")
 };
+
+UENUM(BlueprintType)
+enum class EMazePlacement : uint8
+{
+	Spread UMETA(DisplayName = "Spread"),
+	Branches UMETA(DisplayName = "Branches")
+};
+
+UENUM(BlueprintType)
+enum class EMazeAgentPolicy : uint8
+{
+	RandomWalk UMETA(DisplayName = "Random Walk"),
+	WallFollower UMETA(DisplayName = "Wall Follower"),
+	Explorer UMETA(DisplayName = "Explorer")
+};
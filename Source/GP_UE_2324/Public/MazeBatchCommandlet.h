@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "MazeBatchCommandlet.generated.h"
+
+//Generates and analyzes many mazes on data only, without a level or any actors.
+//Usage: UnrealEditor-Cmd GP_UE_2324.uproject -run=MazeBatch -Seeds=1-1000 -Sizes=20x20,50x50
+//  -MergeProb=0.5 -Braid=0.25 -VoronoidCellSize=5 -Colors=4 -Output=<dir> -Png -Ascii -NoBinary -NoElevation
+//  -Simulate=1000 -Policy=Explorer -MaxSteps=0
+//Writes a binary layout and optional previews per maze, metrics.csv and the throughput of the run.
+//With -Simulate every maze is also solved by that many agents and metrics.csv gets the distribution of their steps
+UCLASS()
+class GP_UE_2324_API UMazeBatchCommandlet : public UCommandlet
+{
+    GENERATED_BODY()
+
+public:
+    UMazeBatchCommandlet();
+
+    virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MazeGrid.h"
+
+//Passability of the maze packed as bits, 64 cells per word and every row padded to whole words.
+//Breadth searches expand all the cells of a frontier row with a few shifts and masks per word
+//instead of one set lookup per edge, only the rows touched by the frontier are visited each step
+class GP_UE_2324_API FMazeBitboard
+{
+public:
+    void Build(const FMazeGrid& Grid);
+    bool IsValid() const { return Width > 0 && Depth > 0; }
+    SIZE_T GetAllocatedSize() const { return OpenX.GetAllocatedSize() + OpenY.GetAllocatedSize() + Frontier.GetAllocatedSize() + Next.GetAllocatedSize() + Visited.GetAllocatedSize(); }
+
+    //Updates the bit of one wall after it was opened or closed in the grid
+    void SetWallOpen(int32 Index, EDirection Direction, bool bOpen);
+
+    //Distance in steps between two cells, INDEX_NONE if To cannot be reached in MaxDistance steps
+    int32 GetDistance(int32 From, int32 To, int32 MaxDistance = MAX_int32) const;
+
+    //Distance from the sources to every cell, INDEX_NONE for unreachable cells. Returns the number of layers
+    int32 GetDistances(TConstArrayView<int32> Sources, TArray<int32>& OutDistances) const;
+
+    //Cells reachable from the sources in at most MaxDistance steps, indexed like the grid
+    void GetReachable(TConstArrayView<int32> Sources, TBitArray<>& OutReachable, int32 MaxDistance = MAX_int32) const;
+
+private:
+    int32 Width = 0;
+    int32 Depth = 0;
+    int32 WordsPerRow = 0;
+
+    //Bit set when the cell is open towards +X (EDirection::Left)
+    TArray<uint64> OpenX;
+    //Bit set when the cell is open towards +Y (EDirection::Top)
+    TArray<uint64> OpenY;
+
+    //Search buffers kept between queries, they are all zero outside a search and each search clears only the rows it
+    //reached. Queries are not reentrant and must come from one thread at a time
+    mutable TArray<uint64> Frontier;
+    mutable TArray<uint64> Next;
+    mutable TArray<uint64> Visited;
+
+    //Rows are stored with a zero row above and below and a zero word at each end, so every row
+    //can read its neighbours without bounds checks
+    int32 GetWordIndex(int32 Row, int32 Word) const { return 1 + (Row + 1) * WordsPerRow + Word; }
+    int32 GetNumWords() const { return (Depth + 2) * WordsPerRow + 2; }
+
+    template<typename VisitorType>
+    int32 Flood(TConstArrayView<int32> Sources, int32 MaxDistance, VisitorType&& Visitor) const;
+
+    static uint64 ExpandRow(const uint64* Frontier, const uint64* X, const uint64* Y, uint64* Visited, uint64* Next, int32 NumWords, int32 Stride);
+};
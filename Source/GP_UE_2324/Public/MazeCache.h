@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MazeLayout.h"
+
+//Generated mazes stored on disk under the hash of everything that went into them, so a maze that was already built
+//is loaded instead of running the algorithms again. A flat maze is stored as a tower of one layer.
+//Files are touched when they are loaded and the least recently used ones are deleted when the cache grows too big
+class GP_UE_2324_API MazeCache
+{
+public:
+    //Hash of the validated settings, which include the number of colors of the palette, and FMazeLayout::Version
+    static FString MakeKey(const FMazeSettings& Settings);
+
+    //False if the maze is not cached, a file that can't be read or does not match the settings is deleted
+    static bool Load(const FString& Key, const FMazeSettings& Settings, FMazeTower& OutTower);
+
+    //Writes the maze and evicts the oldest files until the cache takes at most MaxBytes
+    static void Store(const FString& Key, const FMazeTower& Tower, int64 MaxBytes);
+
+    static FString GetDirectory();
+
+private:
+    static FString GetPath(const FString& Key);
+    static void Evict(int64 MaxBytes, const FString& KeepKey);
+};
@@ -64,9 +64,13 @@ public:
     void BreakRightWall();
     void BreakTopWall();
     void BreakBottomWall();
+    void BreakWall(EDirection Direction);
+    void RestoreWall(EDirection Direction);
+    UStaticMeshComponent* GetWall(EDirection Direction) const;
 
     void Visit();
     void GenerateMesh(float Elevation, EDirection Direction, const TArray<FVector>& PrevCellVerts, float CellSize);
+    void GenerateMesh(TConstArrayView<float> CornerHeights, float CellSize);
     const TArray<FVector>& GetCellVerts();
     void SetElevation(EElevation NewElevation);
     const EElevation GetElevation();
@@ -80,9 +84,15 @@ public:
 
     const TArray<AMazeCell*>& GetNeighbours();
     void AddNeighbour(AMazeCell* Neighbour);
+    void RemoveNeighbour(AMazeCell* Neighbour);
+
+    //Bytes of History and Neighbours, the arrays that are not properties
+    SIZE_T GetAllocatedSize() const;
 
     EDirection GetOpenDirection();
 
+private:
+    void UpdateFloorMesh();
 
 
 };
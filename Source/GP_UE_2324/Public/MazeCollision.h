@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MazeLayout.h"
+
+//Collision of a whole maze on data only, for servers that never draw the maze. Walls of the same side in a line of
+//cells at the same height become one convex box. Floors are a triangle mesh like the floors of the cells, where flat
+//floors at the same height are merged into rectangles and every sloped floor keeps its own two triangles
+class GP_UE_2324_API MazeCollision
+{
+public:
+    //Hulls of all the walls. WallBoxes has the box of the wall of every side relative to the corner of its cell in
+    //EDirection order, an invalid box leaves that side without collision. HeightScale converts the solved heights to
+    //world units. The hulls are relative to the maze and every box hull has its 8 corners
+    static void BuildHulls(const FMazeLayout& Layout, float CellSize, float HeightScale, TConstArrayView<FBox> WallBoxes,
+        TArray<TArray<FVector>>& OutHulls);
+
+    //Walls are built by lines so a changed wall only builds its line again. Lines between columns come first and then
+    //the lines between rows, line B of each kind is between the cells at B - 1 and B
+    static int32 GetNumWallLines(const FMazeGrid& Grid) { return Grid.Width + 1 + Grid.Depth + 1; }
+    static int32 GetWallLine(const FMazeGrid& Grid, int32 CellIndex, EDirection Direction);
+
+    //Adds the hulls of one line of walls, every run of walls in it is one box
+    static void BuildWallLine(const FMazeLayout& Layout, float CellSize, float HeightScale, TConstArrayView<FBox> WallBoxes,
+        int32 Line, TArray<TArray<FVector>>& OutHulls);
+
+    //Adds the triangles of the floors of the rows from MinY to MaxY, exclusive, relative to the maze. The rectangles are
+    //only merged inside those rows, so floors built by bands of rows can build one band again
+    static void BuildFloorMesh(const FMazeLayout& Layout, float CellSize, float HeightScale, int32 MinY, int32 MaxY,
+        TArray<FVector>& OutVertices, TArray<int32>& OutTriangles);
+};
@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MazeGrid.h"
+
+//Connected components of the maze kept up to date while walls are opened and closed at runtime.
+//Opening a wall relabels the smaller of the two components, closing one searches from both cells at the same
+//time and stops as soon as they meet or one side runs out, so the cost is the size of the smaller side
+class GP_UE_2324_API FMazeConnectivity
+{
+public:
+    void Build(const FMazeGrid& Grid);
+    bool IsValid() const { return Components.Num() > 0; }
+
+    bool AreConnected(int32 A, int32 B) const { return Components[A] == Components[B]; }
+    int32 GetComponent(int32 Index) const { return Components[Index]; }
+    int32 GetComponentSize(int32 Component) const { return Sizes[Component]; }
+    int32 GetNumComponents() const { return Sizes.Num() - FreeComponents.Num(); }
+
+    SIZE_T GetAllocatedSize() const
+    {
+        return Components.GetAllocatedSize() + Sizes.GetAllocatedSize() + FreeComponents.GetAllocatedSize()
+            + Marks.GetAllocatedSize() + SearchA.GetAllocatedSize() + SearchB.GetAllocatedSize();
+    }
+
+    //Call after the wall between the neighbours A and B was changed in the grid, returns true when the components changed
+    bool OnWallChanged(const FMazeGrid& Grid, int32 A, int32 B, bool bOpened);
+
+private:
+    TArray<int32> Components;
+    TArray<int32> Sizes;
+    TArray<int32> FreeComponents;
+
+    //Search marks are stamps so no array has to be cleared between wall changes
+    TArray<uint32> Marks;
+    uint32 Stamp = 0;
+    TArray<int32> SearchA;
+    TArray<int32> SearchB;
+
+    int32 AddComponent(int32 Size);
+    void Relabel(const FMazeGrid& Grid, int32 Start, int32 From, int32 To);
+    bool SplitComponents(const FMazeGrid& Grid, int32 A, int32 B);
+};
+
+//Breadth search from one or more sources that is repaired in place after wall changes. A closed wall only searches
+//again the cells that were reached through it and an opened wall only the cells it brings closer, so the cost of a
+//change is the number of cells whose result changes and not the size of the maze
+struct GP_UE_2324_API FMazeDistanceField
+{
+    TArray<int32> Sources;
+
+    //Same distances and labels as PathSearch::BreadthSearch for one source and PathSearch::GetClosestVoronoids for many.
+    //Parents always form a tree of shortest paths, after a repair it can pick another parent of the same distance
+    TArray<int32> Parents;
+    TArray<int32> Distances;
+    //Lowest index of the sources closest to each cell, the one a breadth search from all of them reaches first
+    TArray<int32> Labels;
+
+    //Cells whose distance or label changed in the last update, every cell after a full search
+    TArray<int32> ChangedCells;
+
+    void SetSources(TConstArrayView<int32> NewSources);
+    bool IsDirty() const { return bDirty; }
+    void MarkDirty() { bDirty = true; }
+    //True when there are wall changes or a full search waiting for the next update
+    bool NeedsUpdate() const { return bDirty || PendingWalls.Num() > 0; }
+
+    SIZE_T GetAllocatedSize() const
+    {
+        return Sources.GetAllocatedSize() + Parents.GetAllocatedSize() + Distances.GetAllocatedSize() + Labels.GetAllocatedSize()
+            + ChangedCells.GetAllocatedSize() + PendingWalls.GetAllocatedSize() + Flags.GetAllocatedSize();
+    }
+
+    //Searches everything again if the field is dirty or repairs it from the pending wall changes, returns true when
+    //any cell changed
+    bool Update(const FMazeGrid& Grid);
+
+    //Call after the wall between the neighbours A and B was changed in the grid, the change is repaired on the next update
+    void OnWallChanged(int32 A, int32 B);
+
+private:
+    bool bDirty = true;
+    TArray<TPair<int32, int32>> PendingWalls;
+
+    //Per cell marks of a repair, cleared again on the cells it touched
+    TArray<uint8> Flags;
+
+    void Search(const FMazeGrid& Grid);
+    void Repair(const FMazeGrid& Grid);
+};
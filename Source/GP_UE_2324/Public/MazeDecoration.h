@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MazeLayout.h"
+#include "MazeDecoration.generated.h"
+
+class UStaticMesh;
+
+//One kind of prop scattered over the floor of the cells of a theme
+USTRUCT(BlueprintType)
+struct GP_UE_2324_API FMazePropType
+{
+    GENERATED_BODY()
+
+    UPROPERTY(EditAnywhere, Category = "Maze Decoration")
+    UStaticMesh* Mesh = nullptr;
+
+    //Average number of props per cell
+    UPROPERTY(EditAnywhere, Category = "Maze Decoration", meta = (ClampMin = "0.0"))
+    float Density = 0.5f;
+
+    UPROPERTY(EditAnywhere, Category = "Maze Decoration", meta = (ClampMin = "0.0"))
+    float MinScale = 0.8f;
+
+    UPROPERTY(EditAnywhere, Category = "Maze Decoration", meta = (ClampMin = "0.0"))
+    float MaxScale = 1.2f;
+
+    UPROPERTY(EditAnywhere, Category = "Maze Decoration")
+    bool bRandomYaw = true;
+
+    //Distance kept from the walls as a fraction of the cell size
+    UPROPERTY(EditAnywhere, Category = "Maze Decoration", meta = (ClampMin = "0.0", ClampMax = "0.5"))
+    float WallMargin = 0.15f;
+};
+
+//Props of the regions that take the color at the same index of the palette
+USTRUCT(BlueprintType)
+struct GP_UE_2324_API FMazeDecorationTheme
+{
+    GENERATED_BODY()
+
+    UPROPERTY(EditAnywhere, Category = "Maze Decoration")
+    TArray<FMazePropType> Props;
+};
+
+//Props of one square of cells. Instances has one array of transforms relative to the maze for every prop type,
+//the prop types of all the themes are numbered one after the other
+struct GP_UE_2324_API FMazeDecorationChunk
+{
+    FIntPoint FirstCell = FIntPoint::ZeroValue;
+    TArray<TArray<FTransform>> Instances;
+};
+
+//Scatter of the props of the voronoid regions on data only. Every chunk is computed in parallel with its own stream
+//seeded from the seed and its position, so the result does not depend on the threads or on the other chunks
+class GP_UE_2324_API MazeDecoration
+{
+public:
+    //ElevationScale converts the solved heights to world units, 0 puts every prop at the height of the start cell.
+    //The start, exit and key cells are kept clear
+    static void Scatter(const FMazeLayout& Layout, TConstArrayView<FMazeDecorationTheme> Themes, float CellSize, float ElevationScale,
+        int32 ChunkSize, int32 Seed, TArray<FMazeDecorationChunk>& OutChunks);
+
+    //Scatters only the chunks at ChunkIndices, numbered along X first like the chunks of Scatter, in that order. A chunk
+    //gets the same props as in Scatter, so the chunks of the cells that changed can be scattered again on their own
+    static void ScatterChunks(const FMazeLayout& Layout, TConstArrayView<FMazeDecorationTheme> Themes, float CellSize, float ElevationScale,
+        int32 ChunkSize, int32 Seed, TConstArrayView<int32> ChunkIndices, TArray<FMazeDecorationChunk>& OutChunks);
+
+    static int32 GetNumPropTypes(TConstArrayView<FMazeDecorationTheme> Themes);
+
+    //Height of the floor of a cell at a point given as fractions of the cell size, on the same triangles as its mesh
+    static float GetFloorHeight(const FMazeElevation& Elevation, int32 CellIndex, float U, float V);
+};
@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameEnums.h"
+#include "MazeGrid.h"
+#include "MazeElevation.generated.h"
+
+//Elevation of every cell of the maze solved as a data pass, independent from the MazeCell actors.
+//Heights are stored unscaled so the same result can be applied with any elevation ratio
+USTRUCT()
+struct GP_UE_2324_API FMazeElevation
+{
+    GENERATED_BODY()
+
+    //Cell indices in breadth first order from the start cell, the first one is the start. After SolveRegion it still has
+    //every cell but a cell can come before its parent
+    UPROPERTY()
+    TArray<int32> Order;
+
+    //Cell each cell took its elevation from. After SolveRegion a cell outside of the rectangle keeps its height even when
+    //its parent was solved again
+    UPROPERTY()
+    TArray<int32> Parents;
+
+    UPROPERTY()
+    TArray<EElevation> Levels;
+
+    //Height of each cell relative to the start cell
+    UPROPERTY()
+    TArray<float> Heights;
+
+    //Height of the four floor vertices of each cell in EVert order, relative to the cell height. Cells that open to each
+    //other always share the corners of that side, also across the loops of a braided maze
+    UPROPERTY()
+    TArray<float> Corners;
+
+    void Solve(const FMazeGrid& Grid, int32 StartIndex, int32 Seed);
+
+    //Solves again the cells of Rect but the start, Max is exclusive, from the open cells around it. The heights outside of
+    //Rect never change and a new height that does not meet them is absorbed by the corners of the cells of Rect. Only two
+    //cells around Rect that now meet at a vertex through a new opening and disagree there move their corners on it.
+    //Costs the size of Rect. OutCells gets the cells that were solved again and then the ones whose corners moved
+    void SolveRegion(const FMazeGrid& Grid, const FIntRect& Rect, int32 Seed, TArray<int32>& OutCells);
+
+    bool IsValid() const { return Order.Num() > 0; }
+
+    SIZE_T GetAllocatedSize() const
+    {
+        return Order.GetAllocatedSize() + Parents.GetAllocatedSize() + Levels.GetAllocatedSize() + Heights.GetAllocatedSize() + Corners.GetAllocatedSize();
+    }
+
+    TConstArrayView<float> GetCorners(int32 CellIndex) const { return MakeArrayView(Corners.GetData() + CellIndex * 4, 4); }
+    static EElevation GetNextElevation(EElevation CurrentElev, FRandomStream& Stream);
+    static float GetElevationOffset(EElevation Elevation, FRandomStream& Stream);
+
+private:
+    void SolveCell(int32 CurrentIndex, int32 NextIndex, EDirection Direction, FRandomStream& Stream);
+    void JoinCorners(const FMazeGrid& Grid, const FIntRect& Rect, int32 KeptIndex, TArray<int32>& OutMovedCells);
+};
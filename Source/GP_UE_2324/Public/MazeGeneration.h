@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MazeLayout.h"
+#include "MazePipeline.h"
+
+//Generation of maze layouts on data only, shared by the MazeGenerator actor and the offline tools
+class GP_UE_2324_API MazeGeneration
+{
+public:
+    //Runs every stage: Ellers, braid, start, exit and key, voronoid regions and elevation. The stages after the start
+    //only need the maze and the start, so they run at the same time unless bParallel is false. OutTimings gets the time
+    //of every stage
+    static void BuildLayout(const FMazeSettings& Settings, FMazeLayout& OutLayout, FMazePipelineTimings* OutTimings = nullptr, bool bParallel = true);
+
+    //Builds Settings.NumLayers layers, each one carved in parallel with its own stream and joined by stairs
+    static void BuildTower(const FMazeSettings& Settings, FMazeTower& OutTower);
+
+    static void GenerateEllers(FMazeGrid& Grid, FRandomStream& Stream, float MergeProb);
+    static void Braid(FMazeGrid& Grid, FRandomStream& Stream, float BraidFactor);
+
+    //Carves the cells inside Rect again, Max is exclusive. Parents is a tree of the whole maze towards the start like the
+    //one of PathSearch::BreadthSearch, it is only read and no longer matches the maze afterwards. Every part of the maze
+    //outside the rectangle keeps one opening into it, so the maze stays connected and a perfect maze stays perfect. Costs
+    //the size of the rectangle plus the walk along Parents from its first cell to the start, which is as long as that way
+    //through the maze. OutChangedWalls gets every wall that was opened or closed once, from a cell of the rectangle
+    static bool RegenerateRegion(FMazeGrid& Grid, TConstArrayView<int32> Parents, const FIntRect& Rect, int32 Seed, float MergeProb,
+        TArray<TPair<int32, EDirection>>& OutChangedWalls);
+    //Does not set the exit and key regions, they need the exit and the key
+    static void SetVoronoidRegions(const FMazeSettings& Settings, FRandomStream& Stream, FMazeLayout& Layout);
+    static void ComputeMetrics(const FMazeLayout& Layout, FMazeMetrics& OutMetrics);
+};
@@ -5,10 +5,39 @@
 #include "CoreMinimal.h"
 #include "Camera/CameraComponent.h"
 #include "GameFramework/Actor.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "ProceduralMeshComponent.h"
 #include "MazeCell.h"
 #include "GameEnums.h"
+#include "MazeLayout.h"
+#include "MazeBitboard.h"
+#include "MazeConnectivity.h"
+#include "MazeDecoration.h"
+#include "MazeSeedSearch.h"
+#include "MazePlacement.h"
+#include "MazeSimulation.h"
+#include "MazeMemory.h"
 #include "MazeGenerator.generated.h"
 
+class AMazeNavigationData;
+
+//Actors of one spawned layer of a tower. A layer is spawned and destroyed over several frames, the cells below
+//NumSpawned exist
+USTRUCT()
+struct FMazeLayerActors
+{
+    GENERATED_BODY()
+
+    UPROPERTY()
+    TArray<AMazeCell*> Cells;
+
+    UPROPERTY()
+    AActor* Stairs = nullptr;
+
+    int32 NumSpawned = 0;
+    bool bStreamed = false;
+};
+
 UCLASS()
 class GP_UE_2324_API AMazeGenerator : public AActor
 {
@@ -19,6 +48,7 @@ public:
 
 protected:
     virtual void BeginPlay() override;
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:
     UPROPERTY(EditAnywhere, Category = "Maze Configuration")
@@ -30,6 +60,10 @@ public:
     UPROPERTY(EditAnywhere, Category = "Maze Configuration")
     AActor* Key;
 
+    //Seed of the maze, 0 picks a random seed on BeginPlay
+    UPROPERTY(EditAnywhere, Category = "Maze Configuration")
+    int32 Seed;
+
     UPROPERTY(EditAnywhere, Category = "Maze Configuration")
     int MazeWidth;
 
@@ -39,19 +73,180 @@ public:
     UPROPERTY(EditAnywhere, Category = "Maze Configuration")
     float EllersMergeProb;
 
+    //Fraction of the dead ends opened into loops after carving, 0 keeps a perfect maze
+    UPROPERTY(EditAnywhere, Category = "Maze Configuration", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+    float BraidFactor;
+
     UPROPERTY(EditAnywhere, Category = "Maze Configuration")
     float ElevationRatioIn;
 
     UPROPERTY(EditAnywhere, Category = "Maze Configuration")
     int CellSizeIn;
 
-    static void GenerateCellMesh(AMazeCell* CurrentCell, AMazeCell* NextCell);
+    //Seed of the elevation pass, 0 derives it from Seed
+    UPROPERTY(EditAnywhere, Category = "Maze Configuration")
+    int32 ElevationSeed;
+
+    //Layers of the maze stacked on top of each other and joined by stairs
+    UPROPERTY(EditAnywhere, Category = "Maze Layers")
+    int32 NumLayers;
+
+    UPROPERTY(EditAnywhere, Category = "Maze Layers")
+    float LayerHeight;
+
+    //Spawned at the exit of every layer below the top one, leading to the start of the layer above
+    UPROPERTY(EditAnywhere, Category = "Maze Layers")
+    TSubclassOf<AActor> BPStairs;
+
+    //Layers above and below the player that are kept spawned
+    UPROPERTY(EditAnywhere, Category = "Maze Layers")
+    int32 StreamedLayerRadius;
+
+    //Seconds between checks of the layer of the player
+    UPROPERTY(EditAnywhere, Category = "Maze Layers")
+    float LayerStreamingInterval;
+
+    //Cells of the streamed layers spawned or destroyed per frame, the layer of the player is spawned at once on BeginPlay
+    UPROPERTY(EditAnywhere, Category = "Maze Layers", meta = (ClampMin = "1"))
+    int32 LayerCellsPerFrame;
+
+    //Cells per side of each baked floor section, and rows of each band of floors of the server collision
+    UPROPERTY(EditAnywhere, Category = "Maze Bake")
+    int32 BakeChunkSize;
+
+    //Props of the voronoid regions, a region uses the theme at the index of its color in PossibleColors
+    UPROPERTY(EditAnywhere, Category = "Maze Decoration")
+    TArray<FMazeDecorationTheme> DecorationThemes;
+
+    //Cells per side of each square of props that shares instanced components
+    UPROPERTY(EditAnywhere, Category = "Maze Decoration", meta = (ClampMin = "1"))
+    int32 DecorationChunkSize;
+
+    //Distance from the camera where the props stop being drawn, 0 always draws them
+    UPROPERTY(EditAnywhere, Category = "Maze Decoration", meta = (ClampMin = "0.0"))
+    float DecorationCullDistance;
+
+    //Objects spawned on the cells of the maze every time it is generated, the rules run in order
+    UPROPERTY(EditAnywhere, Category = "Maze Placement")
+    TArray<FMazePlacementRule> PlacementRules;
+
+    //Loads mazes that were already generated with the same settings and colors from Saved/MazeCache instead of
+    //running the algorithms, new mazes are added to it
+    UPROPERTY(EditAnywhere, Category = "Maze Cache")
+    bool bUseGenerationCache;
+
+    //The least recently used mazes are deleted when the cache grows over this size
+    UPROPERTY(EditAnywhere, Category = "Maze Cache", meta = (ClampMin = "1"))
+    int32 GenerationCacheSizeMB;
+
+    //A warning is logged when the maze takes more memory than this once it is built, 0 never checks.
+    //Maze.Memory logs the memory of every maze of the world at any time
+    UPROPERTY(EditAnywhere, Category = "Maze Memory", meta = (ClampMin = "0"))
+    int32 MemoryBudgetMB;
+
+    //Metrics the mazes picked by FindSeed have to meet
+    UPROPERTY(EditAnywhere, Category = "Maze Seed Search")
+    FMazeSeedConstraints SeedConstraints;
+
+    UPROPERTY(EditAnywhere, Category = "Maze Seed Search", meta = (ClampMin = "1"))
+    int32 SeedSearchCandidates;
+
+    //Bots SimulateAgents runs on the maze of the current settings
+    UPROPERTY(EditAnywhere, Category = "Maze Simulation")
+    FMazeSimulationSettings SimulationSettings;
+
+    //Agents path on the cells of the maze through AMazeNavigationData, so the walls and floors never affect navigation
+    //and no navmesh is built for them. Off leaves navigation to the recast navmesh of the Default agent of the project,
+    //which is built in the NavMeshBoundsVolume of the level
+    UPROPERTY(EditAnywhere, Category = "Maze Navigation")
+    bool bUseMazeNavigation;
+
+    //On a dedicated server a flat maze only builds its data and one component with the merged collision of the walls
+    //and floors, without cells, meshes, materials, colors, props or minimap
+    UPROPERTY(EditAnywhere, Category = "Maze Server")
+    bool bServerCollisionOnly;
+
+    //Moves the exit and the key when a wall change alters the paths from the start cell
+    UPROPERTY(EditAnywhere, Category = "Maze Walls")
+    bool bUpdateExitAndKeyOnWallChange;
+
+    //Solves the elevation again without searching the maze, a new seed gives new terrain
+    //and the current ElevationRatioIn is applied to every cell
+    UFUNCTION(BlueprintCallable, Category = "Maze Configuration")
+    void RefreshElevation(bool bNewSeed);
+
+    //Number of steps between two cells of the maze, -1 if they are not connected
+    UFUNCTION(BlueprintCallable, Category = "Maze Queries")
+    int32 GetCellDistance(int32 FromIndex, int32 ToIndex);
+
+    //Opens or closes one wall at runtime, like a door. Connectivity is updated incrementally, distances,
+    //regions and colors are only searched again if the change affects them and at most once per frame
+    UFUNCTION(BlueprintCallable, Category = "Maze Walls")
+    void SetWallOpen(int32 CellIndex, EDirection Direction, bool bOpen);
+
+    UFUNCTION(BlueprintCallable, Category = "Maze Walls")
+    bool IsWallOpen(int32 CellIndex, EDirection Direction) const;
+
+    //Carves the cells from Min up to Max, exclusive, into a new maze from RegionSeed while the players are in it.
+    //The maze stays connected and a perfect maze stays perfect, only the changed walls are updated like with SetWallOpen.
+    //The elevation of the region is solved again against the heights around it, which stay, and only its floors, the
+    //decoration chunks it overlaps and the placed actors on it are updated. Besides the region this walks from it to the
+    //start and repairs the distances to the start, which changes every cell whose way to the start crosses the region
+    UFUNCTION(BlueprintCallable, Category = "Maze Walls")
+    void RegenerateRegion(FIntPoint Min, FIntPoint Max, int32 RegionSeed);
+
+    UFUNCTION(BlueprintCallable, Category = "Maze Queries")
+    bool AreCellsConnected(int32 A, int32 B);
+
+    //Number of steps from the start cell, -1 if it cannot be reached
+    UFUNCTION(BlueprintCallable, Category = "Maze Queries")
+    int32 GetDistanceFromStart(int32 CellIndex);
+
+    //Cell under a world location through the generator transform, -1 outside of the maze
+    UFUNCTION(BlueprintCallable, Category = "Maze Queries")
+    int32 GetCellAtLocation(const FVector& WorldLocation) const;
+
+    //World location of the center of a cell on its floor
+    UFUNCTION(BlueprintCallable, Category = "Maze Queries")
+    FVector GetCellWorldLocation(int32 CellIndex) const;
+
+    float GetCellSize() const { return CellSize; }
+
+    //The bitboard is built on first use so baked levels do not pay for it on BeginPlay
+    const FMazeBitboard& GetBitboard();
+    const FMazeLayout& GetLayout() const { return Layout; }
+
+    //Memory of the maze by subsystem, measured on the data, actors and components it owns.
+    //Visits every cell actor, so it is meant for reports and not for every frame
+    void GetMemoryStats(FMazeMemoryStats& OutStats) const;
+    bool IsBaked() const { return bBaked; }
+
+#if WITH_EDITOR
+    virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+
+    //Generates the maze once in the editor and stores it in the level as instanced walls, chunked floors and the layout,
+    //BeginPlay of a baked maze only moves the player to the start
+    UFUNCTION(CallInEditor, Category = "Maze Bake")
+    void BakeMaze();
+
+    UFUNCTION(CallInEditor, Category = "Maze Bake")
+    void ClearBakedMaze();
+
+    //Sets Seed to the best of the SeedSearchCandidates seeds after it that meet SeedConstraints with the current settings,
+    //so every call moves on to new seeds
+    UFUNCTION(CallInEditor, Category = "Maze Seed Search")
+    void FindSeed();
+
+    //Logs how many steps the agents of SimulationSettings take to solve the maze of the current settings
+    UFUNCTION(CallInEditor, Category = "Maze Simulation")
+    void SimulateAgents();
+#endif
 
 private:
     USceneComponent* Root;
 
-    static float ElevationRatio;
-    static int CellSize;
+    float ElevationRatio;
+    int CellSize;
 
     UPROPERTY(EditAnywhere, Category = "Maze Configuration")
     int VoronoidCellSize;
@@ -66,19 +261,120 @@ private:
     FColor AreaPlant;
 
     TArray<AMazeCell*> MazeGrid;
-    TMap<int, TArray<int>> CellSets;
-    TArray<AMazeCell*> VoronoidGrid;
-    int VoronoidGridWidth;
-    int VoronoidGridDepth;
+    FMazeBitboard Bitboard;
     AMazeCell* StartCell;
 
-    void GenerateMaze();
-    int32 FindSet(int32 CellIndex);
-    void MergeSets(int32 SetFrom, int32 SetTo);
-    void SetExitAndKey();
+    //Runtime wall state, built on the first wall change or query
+    FMazeConnectivity Connectivity;
+    FMazeDistanceField StartField;
+    FMazeDistanceField RegionField;
+    bool bWallChangesPending;
 
-    static EDirection GetDirection(const AMazeCell* CurrentCell, const AMazeCell* NextCell);
-    AMazeCell* GetCellInDirection(AMazeCell* CurrentCell, EDirection Direction);
+    //Only used by mazes of more than one layer, they do not support baking or runtime wall changes
+    FMazeTower Tower;
+    UPROPERTY(Transient)
+    TArray<FMazeLayerActors> LayerActors;
+    int32 CurrentLayer;
+    FTimerHandle LayerStreamingTimer;
+    bool bLayerCellsPending;
+
+    //Saved with the level when the maze is baked
+    UPROPERTY()
+    FMazeLayout Layout;
+
+    UPROPERTY(VisibleAnywhere, Category = "Maze Bake")
+    bool bBaked;
+
+    UPROPERTY()
+    TArray<UInstancedStaticMeshComponent*> BakedWalls;
 
-    void SetColorVoronoid();
+    UPROPERTY()
+    TArray<FColor> BakedWallColors;
+
+    //Index in BakedWalls and instance of the wall of every cell side, X is INDEX_NONE for sides without a wall
+    UPROPERTY()
+    TArray<FIntPoint> BakedWallInstances;
+
+    UPROPERTY()
+    TArray<UProceduralMeshComponent*> BakedFloors;
+
+    //Component of every prop type in every decoration chunk at ChunkIndex * NumPropTypes + PropType, null when the chunk
+    //has no props of that type. Also saved with the level when the maze is baked
+    UPROPERTY()
+    TArray<UInstancedStaticMeshComponent*> DecorationComponents;
+
+    UPROPERTY(Transient)
+    AMazeNavigationData* NavigationData;
+
+    UPROPERTY(Transient)
+    TArray<AActor*> PlacedActors;
+
+    //Cell of every placed actor
+    TArray<int32> PlacedActorCells;
+
+    //Walls and floors are separate components so each keeps the collision profile of its part of the MazeCell blueprint
+    UPROPERTY(Transient)
+    UProceduralMeshComponent* ServerCollision;
+
+    UPROPERTY(Transient)
+    UProceduralMeshComponent* ServerFloorCollision;
+
+    //Hulls of the server collision by line of walls. The dirty hulls are lines of walls and then bands of floor rows,
+    //band B is mesh section B of the floor collision. A wall change only builds its line again and a change of elevation
+    //the lines and bands of its cells
+    TArray<TArray<TArray<FVector>>> ServerHulls;
+    TArray<FBox> ServerWallBoxes;
+    TArray<int32> DirtyServerHulls;
+
+    FMazeSettings ValidateSettings();
+    void BuildMaze(const FMazeSettings& Settings);
+    void GenerateLayouts(const FMazeSettings& Settings);
+    void SpawnCells(const FMazeLayout& CellsLayout, TArray<AMazeCell*>& Cells, const FVector& Offset);
+    void SpawnCell(const FMazeLayout& CellsLayout, TArray<AMazeCell*>& Cells, int32 CellIndex, const FVector& Offset);
+    void ApplyElevation(const FMazeLayout& CellsLayout, const TArray<AMazeCell*>& Cells, const FVector& Offset);
+    void ApplyCellElevation(const FMazeLayout& CellsLayout, AMazeCell* Cell, int32 CellIndex, const FVector& Offset);
+    void UpdateRegionElevation(TConstArrayView<int32> Cells);
+    void UpdateRegionProps(TConstArrayView<int32> Cells);
+    void MovePlayerToStart();
+    void PlaceExitAndKey();
+    void PlaceObjects();
+    void ApplyColors(const FMazeLayout& CellsLayout, const TArray<AMazeCell*>& Cells);
+    FVector GetCellLocation(int32 CellIndex) const;
+    FVector GetCellLocation(const FMazeLayout& CellsLayout, int32 CellIndex) const;
+
+    FVector GetLayerOffset(int32 Layer) const;
+    void UpdateStreamedLayers();
+    void StreamLayerCells();
+    void UpdateLayerCells(int32 MaxCells);
+    bool SpawnLayerCells(int32 Layer, int32& InOutBudget);
+    bool DestroyLayerCells(int32 Layer, int32& InOutBudget);
+
+    void BuildBakedGeometry();
+    void BuildInstancedWalls();
+    void BuildFloorChunks();
+    void BuildFloorChunk(int32 ChunkX, int32 ChunkY, UProceduralMeshComponent* Floor);
+    void DestroyBakedGeometry();
+    void AddBakedWall(int32 CellIndex, EDirection Direction, const FColor& Color);
+    void SetBakedWallOpen(int32 CellIndex, EDirection Direction, bool bOpen, const FColor& Color);
+    FTransform GetBakedWallTransform(int32 CellIndex, const UStaticMeshComponent* Wall) const;
+
+    void BuildDecoration();
+    void SetDecorationChunks(TConstArrayView<int32> ChunkIndices, TConstArrayView<FMazeDecorationChunk> Chunks);
+    void DestroyDecoration();
+
+    bool IsServerMaze() const;
+    void BuildServerCollision();
+    void UpdateServerCollision();
+
+    void InitWallState();
+    void ResetWallState();
+    void OnWallChanged(int32 CellIndex, EDirection Direction, bool bOpen);
+    void ScheduleWallChanges();
+    void ApplyWallChanges();
+    void UpdateCellColor(int32 CellIndex);
+    void UpdateMinimap();
+    void UpdateNavigation();
+    void CheckMemoryBudget() const;
+
+    AMazeCell* GetCellInDirection(AMazeCell* CurrentCell, EDirection Direction);
 };
\ No newline at end of file
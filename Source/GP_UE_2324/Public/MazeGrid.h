@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameEnums.h"
+#include "MazeGrid.generated.h"
+
+//Compact topology of the maze with one byte per cell and a bit for every open side of the cell.
+//Directions follow the MazeCell walls: Left is +X, Right is -X, Bottom is -Y and Top is +Y
+USTRUCT()
+struct GP_UE_2324_API FMazeGrid
+{
+    GENERATED_BODY()
+
+    UPROPERTY()
+    int32 Width = 0;
+
+    UPROPERTY()
+    int32 Depth = 0;
+
+    UPROPERTY()
+    TArray<uint8> Cells;
+
+    static constexpr int32 NumDirections = 4;
+
+    void Init(int32 InWidth, int32 InDepth);
+
+    int32 Num() const { return Cells.Num(); }
+    bool IsValidIndex(int32 Index) const { return Cells.IsValidIndex(Index); }
+    int32 GetIndex(int32 X, int32 Y) const { return Y * Width + X; }
+    int32 GetX(int32 Index) const { return Index % Width; }
+    int32 GetY(int32 Index) const { return Index / Width; }
+
+    static uint8 GetMask(EDirection Direction) { return (uint8)(1 << (uint8)Direction); }
+    static EDirection GetOpposite(EDirection Direction);
+
+    bool IsOpen(int32 Index, EDirection Direction) const { return (Cells[Index] & GetMask(Direction)) != 0; }
+    int32 GetOpenCount(int32 Index) const { return FMath::CountBits(Cells[Index]); }
+    int32 GetNeighbourIndex(int32 Index, EDirection Direction) const;
+
+    //Opening and closing always updates both cells that share the wall
+    void OpenWall(int32 Index, EDirection Direction);
+    void CloseWall(int32 Index, EDirection Direction);
+
+    //Walks the cells crossed by the segment between two points measured in cells, (0.5, 0.5) is the center of the first cell.
+    //False as soon as the segment crosses a closed wall or starts or ends outside of the grid
+    bool HasLineOfSight(const FVector2D& From, const FVector2D& To) const;
+
+    //Calls Function(NeighbourIndex, Direction) for every side of the cell without a wall
+    template<typename FunctionType>
+    void ForEachOpenNeighbour(int32 Index, FunctionType&& Function) const
+    {
+        const uint8 Open = Cells[Index];
+        for (int32 Dir = 0; Dir < NumDirections; Dir++)
+        {
+            if (Open & (1 << Dir))
+            {
+                Function(GetNeighbourIndex(Index, (EDirection)Dir), (EDirection)Dir);
+            }
+        }
+    }
+};
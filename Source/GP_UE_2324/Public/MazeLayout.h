@@ -0,0 +1,145 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MazeGrid.h"
+#include "MazeElevation.h"
+#include "MazeLayout.generated.h"
+
+//Inputs of a maze, the same settings and seed always give the same layout
+USTRUCT()
+struct GP_UE_2324_API FMazeSettings
+{
+    GENERATED_BODY()
+
+    UPROPERTY()
+    int32 Width = 5;
+
+    UPROPERTY()
+    int32 Depth = 5;
+
+    UPROPERTY()
+    int32 Seed = 0;
+
+    UPROPERTY()
+    float EllersMergeProb = 0.5f;
+
+    //Fraction of the dead ends removed after carving by opening one of their walls, 0 keeps a perfect maze
+    UPROPERTY()
+    float BraidFactor = 0.f;
+
+    UPROPERTY()
+    int32 VoronoidCellSize = 1;
+
+    //Number of colors the voronoid regions pick from
+    UPROPERTY()
+    int32 NumColors = 1;
+
+    //Seed of the elevation pass, 0 derives it from Seed
+    UPROPERTY()
+    int32 ElevationSeed = 0;
+
+    UPROPERTY()
+    bool bSolveElevation = true;
+
+    //Stacked layers of Width x Depth cells joined by stairs, 1 is a flat maze
+    UPROPERTY()
+    int32 NumLayers = 1;
+
+    //Fixes invalid values the same way the generator always did, logging every change
+    void Validate();
+    int32 GetElevationSeed() const;
+};
+
+//Result of generating a maze without any actors: topology, start, exit and key, voronoid regions and elevation
+USTRUCT()
+struct GP_UE_2324_API FMazeLayout
+{
+    GENERATED_BODY()
+
+    //Increase when the generation algorithms or the serialized data change
+    static constexpr int32 Version = 1;
+
+    UPROPERTY()
+    FMazeGrid Grid;
+
+    UPROPERTY()
+    int32 StartIndex = INDEX_NONE;
+
+    UPROPERTY()
+    int32 ExitIndex = INDEX_NONE;
+
+    UPROPERTY()
+    int32 KeyIndex = INDEX_NONE;
+
+    //Cell index of the voronoid point of each region
+    UPROPERTY()
+    TArray<int32> VoronoidPoints;
+
+    //Index into the color palette for each region
+    UPROPERTY()
+    TArray<int32> RegionColors;
+
+    //Region of each cell
+    UPROPERTY()
+    TArray<int32> Regions;
+
+    //Regions closest to the exit and to the key, they take the area colors
+    UPROPERTY()
+    int32 ExitRegion = INDEX_NONE;
+
+    UPROPERTY()
+    int32 KeyRegion = INDEX_NONE;
+
+    UPROPERTY()
+    FMazeElevation Elevation;
+
+    bool IsValid() const { return Grid.Num() > 0 && Grid.IsValidIndex(StartIndex); }
+
+    //Bytes of the arrays of the layout, not counting the struct itself
+    SIZE_T GetAllocatedSize() const;
+
+    //Sets ExitRegion and KeyRegion from the current exit, key and regions
+    void UpdateExitAndKeyRegions();
+
+    //Color of the walls of a cell, the exit and key cells and their regions use the area colors over the palette
+    FColor GetCellColor(int32 CellIndex, TConstArrayView<FColor> Palette, const FColor& AreaExit, const FColor& AreaKey) const;
+
+    //Top down image of the maze with one pixel per cell and one per wall, (2 * Width + 1) x (2 * Depth + 1) pixels
+    void Rasterize(TConstArrayView<FColor> Palette, const FColor& AreaExit, const FColor& AreaKey, const FColor& WallColor, TArray<FColor>& OutPixels, int32& OutWidth, int32& OutHeight) const;
+
+    friend FArchive& operator<<(FArchive& Ar, FMazeLayout& Layout);
+};
+
+//Maze of stacked layers where consecutive layers share exactly one stair cell, so the whole tower is a perfect maze
+//when its layers are not braided. The stairs of a layer are its exit and the start of the layer above
+USTRUCT()
+struct GP_UE_2324_API FMazeTower
+{
+    GENERATED_BODY()
+
+    UPROPERTY()
+    TArray<FMazeLayout> Layers;
+
+    //Cell index of the stairs from layer I to layer I + 1, the same cell in both layers
+    UPROPERTY()
+    TArray<int32> Links;
+
+    int32 NumLayers() const { return Layers.Num(); }
+    bool IsValid() const { return Layers.Num() > 0 && Links.Num() == Layers.Num() - 1; }
+    SIZE_T GetAllocatedSize() const;
+
+    friend FArchive& operator<<(FArchive& Ar, FMazeTower& Tower);
+};
+
+//Measurements of a generated maze used to compare layouts
+struct GP_UE_2324_API FMazeMetrics
+{
+    int32 NumCells = 0;
+    int32 SolutionLength = 0;
+    int32 DeadEnds = 0;
+    float DeadEndRatio = 0.f;
+    int32 KeyDistance = 0;
+    int32 KeyExitDistance = 0;
+};
@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/LowLevelMemTracker.h"
+
+class UObject;
+class AActor;
+class UActorComponent;
+
+//Tags of the low level memory tracker under Maze/, allocations made in an LLM_SCOPE_BYTAG of one of them show up
+//in the LLM stats and in memreport. Run with -llm to enable the tracker
+LLM_DECLARE_TAG_API(Maze, GP_UE_2324_API);
+LLM_DECLARE_TAG_API(Maze_Topology, GP_UE_2324_API);
+LLM_DECLARE_TAG_API(Maze_Search, GP_UE_2324_API);
+LLM_DECLARE_TAG_API(Maze_Geometry, GP_UE_2324_API);
+LLM_DECLARE_TAG_API(Maze_Materials, GP_UE_2324_API);
+LLM_DECLARE_TAG_API(Maze_Collision, GP_UE_2324_API);
+
+//Bytes of one maze by subsystem
+struct GP_UE_2324_API FMazeMemoryStats
+{
+    //Layouts, bitboard and the links between cell actors
+    int64 Topology = 0;
+    //Connectivity, distance fields and the navigation data
+    int64 Search = 0;
+    //Actors, components, mesh data and the render buffers of the procedural meshes
+    int64 Geometry = 0;
+    //Dynamic material instances
+    int64 Materials = 0;
+    //Body instances and body setups
+    int64 Collision = 0;
+
+    int32 NumCells = 0;
+    int32 NumObjects = 0;
+
+    int64 GetTotal() const { return Topology + Search + Geometry + Materials + Collision; }
+    double GetBytesPerCell() const { return NumCells > 0 ? (double)GetTotal() / NumCells : 0.0; }
+
+    //One line with the total, the bytes per cell and every subsystem in MB
+    FString ToString() const;
+};
+
+//Measures the objects of a maze the way "obj list" does, so the numbers match the engine tools
+class GP_UE_2324_API MazeMemory
+{
+public:
+    //The object itself, the containers it serializes and its exclusive resources
+    static int64 GetObjectBytes(UObject* Object);
+
+    //The actor under geometry and every one of its components
+    static void AddActor(AActor* Actor, FMazeMemoryStats& Stats);
+
+    //The body instance goes under collision, the render buffers of a procedural mesh under geometry, and the objects
+    //the component owns by type: dynamic materials, body setups and the rest under geometry.
+    //bCollision puts everything under collision, for components that only exist to collide
+    static void AddComponent(UActorComponent* Component, FMazeMemoryStats& Stats, bool bCollision = false);
+};
@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/Texture2D.h"
+#include "MazeLayout.h"
+#include "MazeMinimapSubsystem.generated.h"
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnMazeMinimapReady, UTexture2D*, Texture);
+
+//Minimap of the whole maze as a texture with one pixel per cell and one per wall, rasterized from the layout on a worker.
+//Cells are hidden by fog until they are revealed, and only the rectangles that changed are uploaded on the next tick
+UCLASS()
+class GP_UE_2324_API UMazeMinimapSubsystem : public UTickableWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    UPROPERTY(BlueprintAssignable, Category = "Maze Minimap")
+    FOnMazeMinimapReady OnMinimapReady;
+
+    UPROPERTY(BlueprintReadWrite, Category = "Maze Minimap")
+    FColor FogColor = FColor(24, 24, 24);
+
+    UPROPERTY(BlueprintReadWrite, Category = "Maze Minimap")
+    FColor WallColor = FColor::Black;
+
+    //Reveals the cells around the local player every time it enters a new cell
+    UPROPERTY(BlueprintReadWrite, Category = "Maze Minimap")
+    bool bRevealAroundPlayer = true;
+
+    UPROPERTY(BlueprintReadWrite, Category = "Maze Minimap")
+    int32 RevealRadius = 1;
+
+    //Starts rasterizing the layout on a worker, the texture is created or updated on the game thread when it is done.
+    //The revealed cells are kept while the size of the maze does not change
+    void BuildMinimap(const FMazeLayout& Layout, TConstArrayView<FColor> Palette, const FColor& AreaExit, const FColor& AreaKey,
+        const FTransform& MazeTransform, float CellSize, bool bFogOfWar = true);
+
+    //Redraws the pixel of one wall after it was opened or closed
+    void UpdateWall(const FMazeLayout& Layout, int32 CellIndex, EDirection Direction);
+
+    //Redraws cells whose color changed, with the open walls drawn in their color
+    void UpdateCells(const FMazeLayout& Layout, TConstArrayView<int32> Cells);
+
+    UFUNCTION(BlueprintCallable, Category = "Maze Minimap")
+    UTexture2D* GetMinimapTexture() const { return Texture; }
+
+    //Reveals the square of cells at most Radius cells away from the cell
+    UFUNCTION(BlueprintCallable, Category = "Maze Minimap")
+    void RevealArea(int32 CellIndex, int32 Radius);
+
+    UFUNCTION(BlueprintCallable, Category = "Maze Minimap")
+    bool IsCellRevealed(int32 CellIndex) const;
+
+    //Texture coordinates of the center of a cell, to draw markers over the minimap
+    UFUNCTION(BlueprintCallable, Category = "Maze Minimap")
+    FVector2D GetCellUV(int32 CellIndex) const;
+
+    //Dedicated servers have nobody to show the minimap to
+    virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+    virtual void Deinitialize() override;
+    virtual void Tick(float DeltaTime) override;
+    virtual TStatId GetStatId() const override;
+
+private:
+    UPROPERTY()
+    UTexture2D* Texture = nullptr;
+
+    int32 GridWidth = 0;
+    int32 GridDepth = 0;
+    int32 PixelWidth = 0;
+    int32 PixelHeight = 0;
+
+    //Fully drawn maze and what the texture shows, the same until cells are revealed when there is fog
+    TArray<FColor> MapPixels;
+    TArray<FColor> DisplayPixels;
+    TBitArray<> Revealed;
+    TArray<FIntRect> DirtyRects;
+    bool bFog = true;
+
+    TArray<FColor> Palette;
+    FColor AreaExit;
+    FColor AreaKey;
+    FTransform MazeTransform;
+    float CellSize = 1.f;
+    int32 PlayerCell = INDEX_NONE;
+
+    //Results of older builds that finish late are ignored
+    uint32 BuildSerial = 0;
+
+    void OnRasterized(uint32 Serial, TArray<FColor>&& Pixels, int32 Width, int32 Height);
+    void CopyCellBlock(int32 X, int32 Y);
+    void AddDirtyRect(const FIntRect& Rect);
+    void FlushDirtyRects();
+    void RevealAroundPlayer();
+};
@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NavigationData.h"
+#include "MazeGrid.h"
+#include "MazePathfinder.h"
+#include "MazeNavigationData.generated.h"
+
+//Navigation data built straight from the maze grid instead of a navmesh, so nothing is generated when a maze is created
+//or a wall changes. Paths are found on the cells with A* and pulled tight through the sides between consecutive cells.
+//Agents use it when it is the NavDataClass of their entry in the SupportedAgents of the navigation system settings.
+//The generator keeps a copy of the grid here because the navigation system can query from other threads
+UCLASS()
+class GP_UE_2324_API AMazeNavigationData : public ANavigationData
+{
+    GENERATED_BODY()
+
+public:
+    AMazeNavigationData(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+    //CellHeights is the floor height of every cell relative to the maze
+    void SetMaze(const FMazeGrid& InGrid, TConstArrayView<float> InCellHeights, const FTransform& InMazeTransform, float InCellSize);
+    void ClearMaze();
+
+    //Moves the floor of the given cells to new heights, the paths over them are searched again
+    void SetCellHeights(TConstArrayView<int32> InCells, TConstArrayView<float> InHeights);
+
+    //Closing a wall invalidates the active paths so their agents search again
+    void SetWallOpen(int32 CellIndex, EDirection Direction, bool bOpen);
+
+    //Bytes of the copy of the maze and of the search state
+    SIZE_T GetAllocatedSize() const;
+
+    virtual FBox GetBounds() const override;
+    virtual FNavLocation GetRandomPoint(FSharedConstNavQueryFilter Filter = nullptr, const UObject* Querier = nullptr) const override;
+    virtual bool GetRandomReachablePointInRadius(const FVector& Origin, float Radius, FNavLocation& OutResult, FSharedConstNavQueryFilter Filter = nullptr, const UObject* Querier = nullptr) const override;
+    virtual bool GetRandomPointInNavigableRadius(const FVector& Origin, float Radius, FNavLocation& OutResult, FSharedConstNavQueryFilter Filter = nullptr, const UObject* Querier = nullptr) const override;
+    virtual bool ProjectPoint(const FVector& Point, FNavLocation& OutLocation, const FVector& Extent, FSharedConstNavQueryFilter Filter = nullptr, const UObject* Querier = nullptr) const override;
+    virtual void BatchProjectPoints(TArray<FNavigationProjectionWork>& Workload, const FVector& Extent, FSharedConstNavQueryFilter Filter = nullptr, const UObject* Querier = nullptr) const override;
+    virtual void BatchProjectPoints(TArray<FNavigationProjectionWork>& Workload, FSharedConstNavQueryFilter Filter = nullptr, const UObject* Querier = nullptr) const override;
+    virtual ENavigationQueryResult::Type CalcPathCost(const FVector& PathStart, const FVector& PathEnd, FVector::FReal& OutPathCost, FSharedConstNavQueryFilter QueryFilter = nullptr, const UObject* Querier = nullptr) const override;
+    virtual ENavigationQueryResult::Type CalcPathLength(const FVector& PathStart, const FVector& PathEnd, FVector::FReal& OutPathLength, FSharedConstNavQueryFilter QueryFilter = nullptr, const UObject* Querier = nullptr) const override;
+    virtual ENavigationQueryResult::Type CalcPathLengthAndCost(const FVector& PathStart, const FVector& PathEnd, FVector::FReal& OutPathLength, FVector::FReal& OutPathCost, FSharedConstNavQueryFilter QueryFilter = nullptr, const UObject* Querier = nullptr) const override;
+    virtual bool DoesNodeContainLocation(NavNodeRef NodeRef, const FVector& WorldSpaceLocation) const override;
+    virtual void BatchRaycast(TArray<FNavigationRaycastWork>& Workload, FSharedConstNavQueryFilter QueryFilter, const UObject* Querier = nullptr) const override;
+    virtual bool FindMoveAlongSurface(const FNavLocation& StartLocation, const FVector& TargetPosition, FNavLocation& OutLocation, FSharedConstNavQueryFilter Filter = nullptr, const UObject* Querier = nullptr) const override;
+    //The maze has no edge data for these queries, they find nothing instead of reaching the pure virtuals of the base
+    virtual bool FindOverlappingEdges(const FNavLocation& StartLocation, TConstArrayView<FVector> ConvexPolygon, TArray<FVector>& OutEdges, FSharedConstNavQueryFilter Filter = nullptr, const UObject* Querier = nullptr) const override;
+    virtual bool GetPathSegmentBoundaryEdges(const FNavigationPath& Path, const FNavPathPoint& StartPoint, const FNavPathPoint& EndPoint, const TConstArrayView<FVector> SearchArea, TArray<FVector>& OutEdges, const float MaxAreaEnterCost, FSharedConstNavQueryFilter Filter = nullptr, const UObject* Querier = nullptr) const override;
+
+    static FPathFindingResult FindPath(const FNavAgentProperties& AgentProperties, const FPathFindingQuery& Query);
+    static bool TestPath(const FNavAgentProperties& AgentProperties, const FPathFindingQuery& Query, int32* NumVisitedNodes);
+    static bool Raycast(const ANavigationData* NavDataInstance, const FVector& RayStart, const FVector& RayEnd, FVector& HitLocation, FSharedConstNavQueryFilter QueryFilter, const UObject* Querier);
+
+private:
+    //Guards everything below, queries can come from any thread
+    mutable FCriticalSection MazeLock;
+    FMazeGrid Grid;
+    TArray<float> CellHeights;
+    FTransform MazeTransform;
+    float CellSize = 1.f;
+    mutable FMazePathfinder Pathfinder;
+
+    //Game thread only, takes the lock of the active paths
+    void InvalidatePaths();
+
+    //The functions below expect MazeLock to be held
+    FVector2D ToGridSpace(const FVector& WorldLocation) const;
+    FVector ToWorld(const FVector2D& GridLocation) const;
+    int32 GetCell(const FVector2D& GridLocation) const;
+    FVector GetRandomPointInCell(int32 CellIndex) const;
+    bool BuildPath(const FVector& Start, const FVector& End, float AgentRadius, TArray<FVector>& OutPoints, int32* OutNumVisited = nullptr) const;
+    bool RaycastLocked(const FVector& RayStart, const FVector& RayEnd, FVector& HitLocation) const;
+    bool ProjectPointLocked(const FVector& Point, FNavLocation& OutLocation, const FVector& Extent) const;
+    ENavigationQueryResult::Type CalcPathLocked(const FVector& PathStart, const FVector& PathEnd, FVector::FReal& OutPathLength) const;
+};
@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MazeGrid.h"
+
+//A* over the open walls of a maze that may have loops, weighted by the cost of entering each cell and guided by the
+//Manhattan distance to the goal. Costs are small integers, so the open list is a ring of buckets indexed by the
+//estimated total cost. The state of every cell is kept between queries and marked with the stamp of the query that
+//wrote it, so nothing is cleared and a query only touches the cells it reaches
+class GP_UE_2324_API FMazePathfinder
+{
+public:
+    //Cost of entering each cell, values below 1 are raised to 1. Empty makes every step cost 1
+    void SetCellCosts(TConstArrayView<int32> InCellCosts);
+
+    //Cheapest path from Start to Goal with both cells included, returns its cost or -1 if Goal can't be reached
+    int32 FindPath(const FMazeGrid& Grid, int32 Start, int32 Goal, TArray<int32>& OutPath);
+
+    //Same search without building the path
+    int32 GetPathCost(const FMazeGrid& Grid, int32 Start, int32 Goal);
+
+    //Cells expanded by the last query
+    int32 GetNumExpanded() const { return NumExpanded; }
+
+    SIZE_T GetAllocatedSize() const;
+
+    //Pulls a path of neighbouring cells tight from Start to End, both measured in cells. The corridor only narrows at the
+    //sides shared by consecutive cells, which are shrunk by Margin cells at both ends to keep an agent off the corners.
+    //OutPoints has the start, every corner the path turns at and the end
+    static void PullString(const FMazeGrid& Grid, TConstArrayView<int32> PathCells, const FVector2D& Start, const FVector2D& End, float Margin, TArray<FVector2D>& OutPoints);
+
+private:
+    TArray<int32> CellCosts;
+    int32 MinCellCost = 1;
+    int32 MaxCellCost = 1;
+
+    //A cell was reached by the current query if its stamp matches, and expanded if its closed stamp does
+    TArray<uint32> Stamps;
+    TArray<uint32> ClosedStamps;
+    TArray<int32> Costs;
+    TArray<int32> Parents;
+    uint32 Stamp = 0;
+
+    //Queued cells never cost more than MaxCellCost + MinCellCost over the cheapest one, so that many buckets are enough
+    TArray<TArray<int32>> Buckets;
+    int32 NumExpanded = 0;
+
+    int32 Search(const FMazeGrid& Grid, int32 Start, int32 Goal);
+    int32 GetCellCost(int32 Index) const { return CellCosts.Num() > 0 ? CellCosts[Index] : 1; }
+};
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+//Parts of a layout the generation stages read and write
+enum class EMazeData : uint8
+{
+    None = 0,
+    Grid = 1 << 0,
+    Start = 1 << 1,
+    ExitAndKey = 1 << 2,
+    Regions = 1 << 3,
+    Elevation = 1 << 4,
+    //State of the random stream after the stages that drew from it
+    Stream = 1 << 5,
+};
+ENUM_CLASS_FLAGS(EMazeData);
+
+struct FMazeStageTiming
+{
+    const TCHAR* Name = nullptr;
+    //Both in seconds, the start is measured from the start of the pipeline
+    double Start = 0.0;
+    double Duration = 0.0;
+};
+
+struct GP_UE_2324_API FMazePipelineTimings
+{
+    TArray<FMazeStageTiming> Stages;
+
+    //Time from the start of the pipeline until every stage finished
+    double WallSeconds = 0.0;
+
+    //Longest chain of stages that wait for each other, the time the pipeline takes with enough workers
+    double CriticalPathSeconds = 0.0;
+
+    //Time of every stage added up, the time the pipeline would take one stage after another
+    double TotalStageSeconds = 0.0;
+
+    //One line with every stage in milliseconds
+    FString ToString() const;
+};
+
+//Stages that name the data they read and write. A stage waits for the earlier stages that write what it reads and
+//for the earlier stages that use what it writes, everything else runs at the same time on UE::Tasks.
+//Stages are added in the order they would run one after another, which keeps the results the same
+class GP_UE_2324_API FMazePipeline
+{
+public:
+    void AddStage(const TCHAR* Name, EMazeData Inputs, EMazeData Outputs, TUniqueFunction<void()> Work);
+
+    //Runs every stage and waits for them, the stages are removed afterwards. Without bParallel the stages run one after
+    //another on the calling thread, for callers that already keep every worker busy
+    void Run(FMazePipelineTimings* OutTimings = nullptr, bool bParallel = true);
+
+private:
+    struct FStage
+    {
+        const TCHAR* Name = nullptr;
+        EMazeData Inputs = EMazeData::None;
+        EMazeData Outputs = EMazeData::None;
+        TUniqueFunction<void()> Work;
+        TArray<int32> Prerequisites;
+    };
+
+    TArray<FStage> Stages;
+};
@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameEnums.h"
+#include "MazeLayout.h"
+#include "MazePlacement.generated.h"
+
+//Objects of one kind placed on the cells of the maze, like collectibles, spawn points or checkpoints.
+//Spread places every object as far as possible from the start, the exit, the key and everything placed before it.
+//Branches places one object at the end of each of the longest side branches off the path from the start to the exit
+USTRUCT(BlueprintType)
+struct GP_UE_2324_API FMazePlacementRule
+{
+    GENERATED_BODY()
+
+    UPROPERTY(EditAnywhere, Category = "Maze Placement")
+    TSubclassOf<AActor> ActorClass;
+
+    UPROPERTY(EditAnywhere, Category = "Maze Placement", meta = (ClampMin = "0"))
+    int32 Count = 1;
+
+    UPROPERTY(EditAnywhere, Category = "Maze Placement")
+    EMazePlacement Mode = EMazePlacement::Spread;
+
+    //Cells closer than this number of steps to the path from the start to the exit are skipped
+    UPROPERTY(EditAnywhere, Category = "Maze Placement", meta = (ClampMin = "0"))
+    int32 MinPathDistance = 0;
+};
+
+//Placement of many objects on data only. Both modes only walk the maze a few times, so hundreds of objects on mazes
+//of millions of cells stay fast. The same layout and rules always give the same cells
+class GP_UE_2324_API MazePlacement
+{
+public:
+    //Runs the rules in order, OutCells has the cells of every rule and never repeats a cell, the start, the exit or the key.
+    //A rule places fewer objects than its count when there are not enough cells that meet it
+    static void Place(const FMazeLayout& Layout, TConstArrayView<FMazePlacementRule> Rules, TArray<TArray<int32>>& OutCells);
+};
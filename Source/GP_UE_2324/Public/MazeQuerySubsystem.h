@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MazeGrid.h"
+#include "MazePathfinder.h"
+#include "MazeQuerySubsystem.generated.h"
+
+class AMazeGenerator;
+
+//Spatial queries on the maze of the world for gameplay and AI. Locations are mapped to cells through the generator
+//transform in constant time and line of sight walks the wall data of the grid instead of tracing against the walls
+UCLASS()
+class GP_UE_2324_API UMazeQuerySubsystem : public UWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    //Called by the generator at the end of its BeginPlay, once its layout exists, and when it is removed
+    void RegisterMaze(AMazeGenerator* Maze);
+    void UnregisterMaze(AMazeGenerator* Maze);
+
+    UFUNCTION(BlueprintCallable, Category = "Maze Queries")
+    AMazeGenerator* GetMaze() const { return ActiveMaze.Get(); }
+
+    //Cell under a world location, -1 outside of the maze
+    UFUNCTION(BlueprintCallable, Category = "Maze Queries")
+    int32 WorldToCell(const FVector& WorldLocation) const;
+
+    //World location of the center of a cell on its floor
+    UFUNCTION(BlueprintCallable, Category = "Maze Queries")
+    FVector CellToWorld(int32 CellIndex) const;
+
+    //Cells of many locations with a single inverse of the maze transform
+    void WorldToCells(TConstArrayView<FVector> WorldLocations, TArray<int32>& OutCells) const;
+
+    UFUNCTION(BlueprintCallable, Category = "Maze Queries")
+    void GetActorCells(const TArray<AActor*>& Actors, TArray<int32>& OutCells) const;
+
+    //Line of sight on the plane of the maze, blocked by closed walls and by leaving the maze
+    UFUNCTION(BlueprintCallable, Category = "Maze Queries")
+    bool HasLineOfSight(const FVector& From, const FVector& To) const;
+
+    //Line of sight between the centers of two cells
+    UFUNCTION(BlueprintCallable, Category = "Maze Queries")
+    bool HasCellLineOfSight(int32 FromCell, int32 ToCell) const;
+
+    UFUNCTION(BlueprintCallable, Category = "Maze Queries")
+    bool CanActorSee(const AActor* Viewer, const AActor* Target) const;
+
+    //Line of sight from one location to many targets, OutVisible is indexed like Targets
+    void HasLineOfSightBatch(const FVector& From, TConstArrayView<FVector> Targets, TBitArray<>& OutVisible) const;
+
+    //Cheapest path between two cells including both, also through the loops of braided mazes. Returns its cost,
+    //the number of steps unless cell costs were set, or -1 if the cells are not connected
+    UFUNCTION(BlueprintCallable, Category = "Maze Queries")
+    int32 FindPath(int32 FromCell, int32 ToCell, TArray<int32>& OutPath);
+
+    //Cost of entering each cell for FindPath, for example to make chasers avoid some areas. Empty makes every step cost 1
+    UFUNCTION(BlueprintCallable, Category = "Maze Queries")
+    void SetPathCellCosts(const TArray<int32>& CellCosts);
+
+private:
+    TWeakObjectPtr<AMazeGenerator> ActiveMaze;
+
+    //Search state is reused by every path query
+    FMazePathfinder Pathfinder;
+
+    //Location in cells on the plane of the maze, (0.5, 0.5) is the center of the first cell
+    FVector2D ToGridSpace(const FMatrix& WorldToMaze, const FVector& WorldLocation) const;
+    FMatrix GetWorldToMaze() const;
+    static int32 GridSpaceToCell(const FMazeGrid& Grid, const FVector2D& Location);
+};
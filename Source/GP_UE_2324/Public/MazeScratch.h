@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/MemStack.h"
+
+//Temporary containers of the generation and search stages take their memory from the linear allocator of the thread
+//that runs the stage. Allocating only moves a pointer inside pages that are reused from stage to stage, and everything
+//is released at once when the scope of the stage ends
+using FMazeScratchAllocator = TMemStackAllocator<>;
+
+template<typename ElementType>
+using TMazeScratchArray = TArray<ElementType, FMazeScratchAllocator>;
+
+using FMazeScratchBitArray = TBitArray<FMazeScratchAllocator>;
+
+//Frees everything allocated as scratch on this thread since the scope started. Scratch containers must be declared
+//after the scope they belong to, and they should be reserved to their final size because growing them leaves the old
+//memory in the stack until the scope ends
+class FMazeScratchScope
+{
+public:
+    FMazeScratchScope() : Mark(FMemStack::Get()) {}
+
+private:
+    FMemMark Mark;
+};
@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MazeLayout.h"
+#include "MazeSeedSearch.generated.h"
+
+//Ranges of metrics a maze has to fall in, a maximum of 0 leaves that metric without an upper limit.
+//Among the mazes that fall in every range, the best ones are closest to the middle of the bounded ranges
+USTRUCT(BlueprintType)
+struct GP_UE_2324_API FMazeSeedConstraints
+{
+    GENERATED_BODY()
+
+    //Steps from the start to the exit
+    UPROPERTY(EditAnywhere, Category = "Maze Seed Search", meta = (ClampMin = "0"))
+    int32 MinSolutionLength = 0;
+
+    UPROPERTY(EditAnywhere, Category = "Maze Seed Search", meta = (ClampMin = "0"))
+    int32 MaxSolutionLength = 0;
+
+    //Fraction of the cells with a single open side
+    UPROPERTY(EditAnywhere, Category = "Maze Seed Search", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+    float MinDeadEndRatio = 0.f;
+
+    UPROPERTY(EditAnywhere, Category = "Maze Seed Search", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+    float MaxDeadEndRatio = 0.f;
+
+    //Steps from the key to the exit
+    UPROPERTY(EditAnywhere, Category = "Maze Seed Search", meta = (ClampMin = "0"))
+    int32 MinKeyExitDistance = 0;
+
+    UPROPERTY(EditAnywhere, Category = "Maze Seed Search", meta = (ClampMin = "0"))
+    int32 MaxKeyExitDistance = 0;
+
+    bool IsSatisfied(const FMazeMetrics& Metrics) const;
+
+    //0 in the middle of every bounded range up to 1 at their ends, lower is better
+    float GetScore(const FMazeMetrics& Metrics) const;
+};
+
+struct GP_UE_2324_API FMazeSeedCandidate
+{
+    int32 Seed = 0;
+    float Score = 0.f;
+    FMazeMetrics Metrics;
+};
+
+//Search of seeds whose mazes meet some constraints. Candidates are only carved and measured on data, without voronoid
+//regions or elevation, in batches spread over the worker threads that each reuse their own search state.
+//The candidates are the seeds from Settings.Seed upwards, skipping 0, and the results do not depend on the threads
+class GP_UE_2324_API MazeSeedSearch
+{
+public:
+    //Lowest candidate that meets the constraints, false if none of NumCandidates does
+    static bool FindFirstSeed(const FMazeSettings& Settings, const FMazeSeedConstraints& Constraints, int32 NumCandidates, FMazeSeedCandidate& OutResult);
+
+    //Up to NumBest candidates that meet the constraints sorted from the best score, ties keep the lower seed first
+    static void FindBestSeeds(const FMazeSettings& Settings, const FMazeSeedConstraints& Constraints, int32 NumCandidates, int32 NumBest, TArray<FMazeSeedCandidate>& OutResults);
+
+    //Same metrics as MazeGeneration::ComputeMetrics on the layout of the settings
+    static void EvaluateSeed(const FMazeSettings& Settings, FMazeMetrics& OutMetrics);
+};
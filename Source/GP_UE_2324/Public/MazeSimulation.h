@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameEnums.h"
+#include "MazeLayout.h"
+#include "MazeSimulation.generated.h"
+
+//Bots that start on the start cell, look for the key and then for the exit, moving one cell per step.
+//RandomWalk picks a random open side and only turns back in dead ends. WallFollower keeps its left hand on the wall,
+//which can loop forever in braided mazes. Explorer remembers the cells it visited, goes on to random unvisited cells and
+//backtracks when there are none. Once it has the key it takes the shortest way it knows to the exit if it already saw it
+USTRUCT(BlueprintType)
+struct GP_UE_2324_API FMazeSimulationSettings
+{
+    GENERATED_BODY()
+
+    UPROPERTY(EditAnywhere, Category = "Maze Simulation")
+    EMazeAgentPolicy Policy = EMazeAgentPolicy::Explorer;
+
+    UPROPERTY(EditAnywhere, Category = "Maze Simulation", meta = (ClampMin = "1"))
+    int32 NumAgents = 1000;
+
+    //Steps after which an agent gives up, 0 allows 100 steps per cell
+    UPROPERTY(EditAnywhere, Category = "Maze Simulation", meta = (ClampMin = "0"))
+    int32 MaxSteps = 0;
+
+    //Agent I uses the same stream on every maze, so mazes are compared on the same random choices
+    UPROPERTY(EditAnywhere, Category = "Maze Simulation")
+    int32 Seed = 1;
+};
+
+//Steps the agents took on one maze
+struct GP_UE_2324_API FMazeSolveStats
+{
+    int32 NumAgents = 0;
+    int32 NumSolved = 0;
+
+    //Steps the agents moved one cell at a time, including the ones that gave up before they did. The way the explorer
+    //takes to the exit once it saw it is found by one search, so it is part of its solve steps but not of these
+    int64 SimulatedSteps = 0;
+
+    //Distribution of the steps of the agents that reached the exit with the key, all 0 when none did
+    float MeanSteps = 0.f;
+    int32 MinSteps = 0;
+    int32 P10Steps = 0;
+    int32 MedianSteps = 0;
+    int32 P90Steps = 0;
+    int32 MaxSteps = 0;
+
+    float GetSolvedRatio() const { return NumAgents > 0 ? (float)NumSolved / NumAgents : 0.f; }
+};
+
+//Agent runs on the layout data only, without a world or any actors. The agents of every maze are split in blocks
+//that run in parallel, and an agent only reads the maze, so any number of mazes can be simulated at once
+class GP_UE_2324_API MazeSimulation
+{
+public:
+    //Without bParallel every agent runs on the calling thread, for callers that already keep every worker busy
+    static void Simulate(const FMazeLayout& Layout, const FMazeSimulationSettings& Settings, FMazeSolveStats& OutStats, bool bParallel = true);
+
+    //All the agents of all the layouts share the workers, OutStats has the stats of every layout in order.
+    //Layouts without a start, exit or key are skipped and get stats without agents
+    static void Simulate(TConstArrayView<const FMazeLayout*> Layouts, const FMazeSimulationSettings& Settings, TArray<FMazeSolveStats>& OutStats);
+
+    //Steps one agent takes to reach the exit with the key, INDEX_NONE when it gives up. The stream of the agent is seeded
+    //with AgentSeed and a MaxSteps of 0 allows 100 steps per cell
+    static int32 RunAgent(const FMazeLayout& Layout, EMazeAgentPolicy Policy, int32 AgentSeed, int32 MaxSteps);
+};
@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "MazeCell.h"
+#include "MazeGrid.h"
+#include "MazeScratch.h"
 
 class AMazeCell;
 
@@ -14,6 +16,13 @@ public:
     static TPair<TArray<AMazeCell*>, AMazeCell*> BreadthSearchExit(AMazeCell* StartCell);
     static AMazeCell* GetKeyCell(const TArray<AMazeCell*>& MazeGrid, const TArray<AMazeCell*>& ExitPath);
     static AMazeCell* GetClosestVoronoid(const TArray<AMazeCell*>& MazeGrid, AMazeCell* Start, const TSet<AMazeCell*>& VoronoidPoints);
-    
+
+    //Same searches on the compact grid, cells are grid indices. They also work on braided mazes with loops
+    static void BreadthSearch(const FMazeGrid& Grid, int32 StartIndex, TArray<int32>& OutOrder, TArray<int32>& OutParents, TArray<int32>& OutDistances);
+    static void BreadthSearch(const FMazeGrid& Grid, int32 StartIndex, TMazeScratchArray<int32>& OutOrder, TMazeScratchArray<int32>& OutParents, TMazeScratchArray<int32>& OutDistances);
+    static TPair<int32, int32> GetExitAndKey(const FMazeGrid& Grid, int32 StartIndex);
+    static TPair<int32, int32> GetExitAndKey(const FMazeGrid& Grid, TConstArrayView<int32> Order, TConstArrayView<int32> Parents);
+    static void GetClosestVoronoids(const FMazeGrid& Grid, TConstArrayView<int32> VoronoidPoints, TArray<int32>& OutRegions);
+
 };
 